@@ -0,0 +1,235 @@
+/*
+A small self-contained benchmark harness: calibrated timing loops, repetitions and a report
+printed as a table and, on request, written as JSON so results can be tracked over time.
+
+The JSON layout follows Google Benchmark's, a "context" object and a "benchmarks" array:
+{
+  "context": { "date": ..., "executable": ..., "num_cpus": ..., "build_type": ... },
+  "benchmarks": [ { "name": ..., "iterations": ..., "real_time": ..., "min_time": ...,
+                    "time_unit": "ns", "items_per_second": ..., <counters> }, ... ]
+}
+*/
+#ifndef __BENCH_HARNESS_HPP__
+#define __BENCH_HARNESS_HPP__
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+// Keep the compiler from optimizing a computed value away
+template <typename T>
+inline void
+do_not_optimize(const T &value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
+
+struct Options {
+    const char *json_path = nullptr; // --json FILE, "-" for stdout
+    const char *filter = nullptr;    // --filter SUBSTRING
+    double min_time = 0.2;           // --min-time SECONDS, per repetition
+    int repetitions = 5;             // --repetitions N
+};
+
+struct Result {
+    std::string name;
+    long long iterations = 0;
+    double ns_per_op = 0.0;     // median over the repetitions
+    double min_ns_per_op = 0.0; // best repetition
+    double items_per_second = 0.0;
+    std::vector<std::pair<std::string, double>> counters;
+};
+
+// Parse the harness options, returns the index of the first remaining argument or -1 on error
+inline int
+parse_options(int argc, char *argv[], Options &options) {
+    int i = 1;
+    for (; i < argc && std::strncmp(argv[i], "--", 2) == 0; i++) {
+        const char *arg = argv[i];
+        if (std::strcmp(arg, "--") == 0)
+            return i + 1;
+        if (i + 1 >= argc)
+            return -1;
+        if (std::strcmp(arg, "--json") == 0)
+            options.json_path = argv[++i];
+        else if (std::strcmp(arg, "--filter") == 0)
+            options.filter = argv[++i];
+        else if (std::strcmp(arg, "--min-time") == 0)
+            options.min_time = std::atof(argv[++i]);
+        else if (std::strcmp(arg, "--repetitions") == 0)
+            options.repetitions = std::atoi(argv[++i]);
+        else
+            return -1;
+    }
+    if (options.min_time <= 0.0 || options.repetitions <= 0)
+        return -1;
+    return i;
+}
+
+inline const char *
+options_usage() {
+    return "[--json FILE|-] [--filter SUBSTRING] [--min-time SECONDS] [--repetitions N]";
+}
+
+class Runner {
+  public:
+    Runner(const Options &options, const char *executable)
+        : options_(options), executable_(executable) {}
+
+    bool enabled(const std::string &name) const {
+        return !options_.filter || name.find(options_.filter) != std::string::npos;
+    }
+
+    const Options &options() const { return options_; }
+
+    /*
+    Time body(iterations), which must perform `iterations` operations of items_per_op items
+    each. The iteration count is grown until one call lasts min_time, then the call is repeated
+    and the median kept. counters are reported along (e.g. a compression ratio).
+    */
+    template <typename Body>
+    void run(const std::string &name, Body body, double items_per_op = 1.0,
+             const std::vector<std::pair<std::string, double>> &counters = {}) {
+        if (!enabled(name))
+            return;
+
+        long long iterations = 1;
+        double seconds = time(body, iterations);
+        while (seconds < options_.min_time && iterations < (1LL << 40)) {
+            double scale = (seconds > 0.0) ? options_.min_time / seconds * 1.2 : 10.0;
+            iterations = (long long)((double)iterations * std::min(std::max(scale, 2.0), 100.0));
+            seconds = time(body, iterations);
+        }
+
+        std::vector<double> samples;
+        for (int r = 0; r < options_.repetitions; r++)
+            samples.push_back(time(body, iterations) * 1e9 / (double)iterations);
+        std::sort(samples.begin(), samples.end());
+
+        Result result;
+        result.name = name;
+        result.iterations = iterations;
+        result.ns_per_op = samples[samples.size() / 2];
+        result.min_ns_per_op = samples.front();
+        result.items_per_second = items_per_op * 1e9 / result.ns_per_op;
+        result.counters = counters;
+        add(result);
+    }
+
+    // Record a result measured by the caller (e.g. a multi-threaded run)
+    void add(const Result &result) {
+        results_.push_back(result);
+        print_row(result);
+    }
+
+    // Write the JSON report if requested, returns false if the file could not be written
+    bool finish() const {
+        if (!options_.json_path)
+            return true;
+
+        bool to_stdout = std::strcmp(options_.json_path, "-") == 0;
+        FILE *out = to_stdout ? stdout : std::fopen(options_.json_path, "w");
+        if (!out) {
+            std::fprintf(stderr, "Failed to open %s\n", options_.json_path);
+            return false;
+        }
+        write_json(out);
+        if (!to_stdout)
+            std::fclose(out);
+        return true;
+    }
+
+  private:
+    template <typename Body>
+    static double time(Body &body, long long iterations) {
+        auto begin = std::chrono::steady_clock::now();
+        body(iterations);
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(end - begin).count();
+    }
+
+    // The table goes to stderr when the JSON report takes stdout
+    FILE *table_stream() const {
+        return (options_.json_path && std::strcmp(options_.json_path, "-") == 0) ? stderr
+                                                                                 : stdout;
+    }
+
+    void print_row(const Result &result) {
+        FILE *out = table_stream();
+        if (!header_printed_) {
+            std::fprintf(out, "%-44s %12s %12s %14s\n", "benchmark", "ns/op", "min ns/op",
+                         "items/s");
+            header_printed_ = true;
+        }
+        std::fprintf(out, "%-44s %12.2f %12.2f %14.4g", result.name.c_str(), result.ns_per_op,
+                     result.min_ns_per_op, result.items_per_second);
+        for (const auto &counter : result.counters)
+            std::fprintf(out, " %s=%.4g", counter.first.c_str(), counter.second);
+        std::fprintf(out, "\n");
+    }
+
+    static void write_string(FILE *out, const std::string &value) {
+        std::fputc('"', out);
+        for (char c : value) {
+            if (c == '"' || c == '\\')
+                std::fputc('\\', out);
+            std::fputc(c, out);
+        }
+        std::fputc('"', out);
+    }
+
+    void write_json(FILE *out) const {
+        char date[32];
+        std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+        std::fprintf(out, "{\n  \"context\": {\n    \"date\": \"%s\",\n    \"executable\": ", date);
+        write_string(out, executable_);
+        std::fprintf(out, ",\n    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+#ifdef NDEBUG
+        std::fprintf(out, "    \"build_type\": \"release\",\n");
+#else
+        std::fprintf(out, "    \"build_type\": \"debug\",\n");
+#endif
+        std::fprintf(out, "    \"repetitions\": %d\n  },\n  \"benchmarks\": [", options_.repetitions);
+        for (size_t i = 0; i < results_.size(); i++) {
+            const Result &result = results_[i];
+            std::fprintf(out, "%s\n    {\"name\": ", i ? "," : "");
+            write_string(out, result.name);
+            std::fprintf(out,
+                         ", \"iterations\": %lld, \"real_time\": %.3f, \"min_time\": %.3f, "
+                         "\"time_unit\": \"ns\", \"items_per_second\": %.6g",
+                         result.iterations, result.ns_per_op, result.min_ns_per_op,
+                         result.items_per_second);
+            for (const auto &counter : result.counters) {
+                std::fprintf(out, ", ");
+                write_string(out, counter.first);
+                std::fprintf(out, ": %.6g", counter.second);
+            }
+            std::fprintf(out, "}");
+        }
+        std::fprintf(out, "\n  ]\n}\n");
+    }
+
+    Options options_;
+    std::string executable_;
+    std::vector<Result> results_;
+    bool header_printed_ = false;
+};
+
+} // namespace bench
+
+#endif // __BENCH_HARNESS_HPP__
@@ -0,0 +1,137 @@
+/*
+Compressed history benchmark: compression ratio and encode/decode throughput of the block codec
+(items = samples) on generated and recorded heart rate streams:
+* uniform  - hr_generate_batch, independent uniform samples, the worst case for the codec
+* walk     - a random walk of -2..2 beats per sample within the heart rate range
+* <file>   - each recording given on the command line, decimal samples as replayed by --replay
+
+The ratio is against int storage (32 bits per sample).
+
+usage: block_history_bench [--json FILE|-] [--filter SUBSTRING] [--min-time SECONDS]
+                           [--repetitions N] [recording ...]
+*/
+#include "bench_harness.hpp"
+#include <string>
+#include <vector>
+extern "C" {
+#include "../src/block_history.h"
+#include "../src/heart_rate_gen.h"
+#include "../src/sample_reader.h"
+}
+
+static const size_t kStreamSamples = 1 << 20;
+
+static std::vector<int>
+generate_walk(size_t n) {
+    hr_rng_t rng;
+    hr_rng_seed(&rng, 1);
+    std::vector<int> samples(n);
+    int value = 75;
+    for (size_t i = 0; i < n; i++) {
+        value += hr_generate_heart_rate_r(&rng) % 5 - 2;
+        value = std::min(std::max(value, HR_MIN_HEART_RATE), HR_MAX_HEART_RATE);
+        samples[i] = value;
+    }
+    return samples;
+}
+
+static bool
+read_recording(const char *path, std::vector<int> &samples) {
+    FILE *stream = std::fopen(path, "r");
+    if (!stream) {
+        std::fprintf(stderr, "Failed to open %s\n", path);
+        return false;
+    }
+    static sr_reader_t reader; // Holds a 64KiB chunk, keep it off the stack
+    sr_init(&reader, stream, SR_FORMAT_TEXT);
+    int chunk[4096];
+    size_t n;
+    while ((n = sr_read(&reader, chunk, 4096)) > 0)
+        samples.insert(samples.end(), chunk, chunk + n);
+    std::fclose(stream);
+    return !reader.error;
+}
+
+static void
+bench_stream(bench::Runner &runner, const std::string &stream, const std::vector<int> &samples) {
+    // Whole blocks only, as the history seals them
+    size_t blocks = samples.size() / BH_BLOCK_SAMPLES;
+    if (blocks == 0) {
+        std::fprintf(stderr, "%s: fewer than %d samples, skipped\n", stream.c_str(),
+                     BH_BLOCK_SAMPLES);
+        return;
+    }
+
+    std::vector<uint8_t> encoded(blocks * BH_MAX_ENCODED(BH_BLOCK_SAMPLES));
+    std::vector<size_t> offsets(blocks);
+    size_t encoded_size = 0;
+    for (size_t b = 0; b < blocks; b++) {
+        offsets[b] = encoded_size;
+        encoded_size +=
+            bh_encode(&samples[b * BH_BLOCK_SAMPLES], BH_BLOCK_SAMPLES, &encoded[encoded_size]);
+    }
+
+    double n = (double)(blocks * BH_BLOCK_SAMPLES);
+    std::vector<std::pair<std::string, double>> counters = {
+        { "ratio", n * sizeof(int32_t) / (double)encoded_size },
+        { "bits_per_sample", (double)encoded_size * 8.0 / n },
+    };
+
+    runner.run(
+        "encode/" + stream,
+        [&](long long iterations) {
+            for (long long i = 0; i < iterations; i++) {
+                uint8_t *out = encoded.data();
+                for (size_t b = 0; b < blocks; b++)
+                    out += bh_encode(&samples[b * BH_BLOCK_SAMPLES], BH_BLOCK_SAMPLES, out);
+                bench::do_not_optimize(encoded);
+            }
+        },
+        n, counters);
+
+    // Decoded bytes per second next to the samples, to compare with the memory bandwidth
+    std::vector<int> decoded(blocks * BH_BLOCK_SAMPLES);
+    runner.run(
+        "decode/" + stream,
+        [&](long long iterations) {
+            for (long long i = 0; i < iterations; i++) {
+                for (size_t b = 0; b < blocks; b++)
+                    bh_decode(&encoded[offsets[b]], &decoded[b * BH_BLOCK_SAMPLES]);
+                bench::do_not_optimize(decoded);
+            }
+        },
+        n, counters);
+
+    if (!std::equal(decoded.begin(), decoded.end(), samples.begin())) {
+        std::fprintf(stderr, "%s: decoded samples differ\n", stream.c_str());
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+int
+main(int argc, char *argv[]) {
+    bench::Options options;
+    int first = bench::parse_options(argc, argv, options);
+    if (first < 0) {
+        std::fprintf(stderr, "Usage: %s %s [recording ...]\n", argv[0], bench::options_usage());
+        return EXIT_FAILURE;
+    }
+
+    bench::Runner runner(options, argv[0]);
+
+    std::vector<int> uniform(kStreamSamples);
+    hr_seed(1);
+    hr_generate_batch(uniform.data(), uniform.size());
+    bench_stream(runner, "uniform", uniform);
+    bench_stream(runner, "walk", generate_walk(kStreamSamples));
+
+    for (int i = first; i < argc; i++) {
+        std::vector<int> recording;
+        if (!read_recording(argv[i], recording))
+            return EXIT_FAILURE;
+        std::string name = argv[i];
+        bench_stream(runner, name.substr(name.find_last_of('/') + 1), recording);
+    }
+
+    return runner.finish() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
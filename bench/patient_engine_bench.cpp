@@ -0,0 +1,90 @@
+/*
+Multi-patient engine benchmark: aggregate throughput (items = samples over all the patients) of
+the sharded worker pool as the number of workers grows, with generated heart rates. A speedup
+counter compares each run with a single worker; past the core count the workers only add
+contention, and on hyper-threaded cores the siblings share a cache.
+
+usage: patient_engine_bench [--json FILE|-] [--filter SUBSTRING] [--repetitions N] [ticks]
+*/
+#include "bench_harness.hpp"
+#include <algorithm>
+#include <string>
+#include <vector>
+extern "C" {
+#include "../src/patient_engine.h"
+}
+
+static const size_t kWorkerCounts[] = { 1, 2, 4, 8 };
+static const size_t kPatients = 5000;
+static const int kBufferSize = 64;
+
+// Returns the median aggregate throughput in samples per second over the repetitions
+static double
+run(size_t workers, uint64_t ticks, int repetitions, double *steals_per_tick) {
+    pe_config_t config = {};
+    config.patients = kPatients;
+    config.workers = workers;
+    config.buffer_size = kBufferSize;
+    config.pin = true;
+    config.seed = 1;
+    pe_engine_t *engine = pe_create(&config);
+    if (!engine) {
+        std::fprintf(stderr, "Engine creation failed\n");
+        std::exit(EXIT_FAILURE);
+    }
+
+    // Warm up: first touch of the patients and thread start up
+    pe_stats_t stats;
+    std::vector<double> rates;
+    uint64_t steals = 0;
+    bool ok = pe_run(engine, ticks / 10 + 1, &stats) == 0;
+    for (int r = 0; ok && r < repetitions; r++) {
+        ok = pe_run(engine, ticks, &stats) == 0;
+        rates.push_back(stats.samples_per_second);
+        steals += stats.steals;
+    }
+    pe_destroy(engine);
+    if (!ok) {
+        std::fprintf(stderr, "Engine run failed\n");
+        std::exit(EXIT_FAILURE);
+    }
+
+    *steals_per_tick = (double)steals / (double)(ticks * repetitions);
+    std::sort(rates.begin(), rates.end());
+    return rates[rates.size() / 2];
+}
+
+int
+main(int argc, char *argv[]) {
+    bench::Options options;
+    int first = bench::parse_options(argc, argv, options);
+    long long ticks = (first >= 0 && first < argc) ? std::atoll(argv[first]) : 200;
+    if (first < 0 || argc - first > 1 || ticks <= 0 || options.repetitions <= 0) {
+        std::fprintf(stderr, "Usage: %s %s [ticks]\n", argv[0], bench::options_usage());
+        return EXIT_FAILURE;
+    }
+
+    bench::Runner runner(options, argv[0]);
+    double single = 0.0;
+    for (size_t workers : kWorkerCounts) {
+        bench::Result result;
+        result.name = "engine/patients:" + std::to_string(kPatients) +
+                      "/workers:" + std::to_string(workers);
+        if (!runner.enabled(result.name))
+            continue;
+
+        double steals_per_tick;
+        double rate = run(workers, (uint64_t)ticks, options.repetitions, &steals_per_tick);
+        if (workers == 1)
+            single = rate;
+        result.iterations = ticks * (long long)(kPatients * PE_DEFAULT_BATCH);
+        result.ns_per_op = 1e9 / rate;
+        result.min_ns_per_op = result.ns_per_op;
+        result.items_per_second = rate;
+        result.counters = { { "steals_per_tick", steals_per_tick } };
+        if (single > 0.0)
+            result.counters.push_back({ "speedup", rate / single });
+        runner.add(result);
+    }
+    return runner.finish() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
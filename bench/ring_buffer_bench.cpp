@@ -0,0 +1,338 @@
+/*
+Microbenchmarks of the ring buffer and EMA hot paths:
+* add_remove     - single thread add followed by remove, the buffer never fills
+* add_overwrite  - single thread add to a full buffer, the monitor's steady state
+* scan           - rb_get_element_at over the full window (items = elements read)
+* static         - add_overwrite and scan on srb::RingBuffer, the compile time capacity buffer
+                   with inline storage and no lock, at a power of two and an odd capacity
+* ema            - hr_update_buffer + hr_calculate_ema (rb_get_last_element) per sample
+* ema_latency    - the same, timed call by call to report the latency distribution
+* ema_bank       - hr_ema_update of a bank of 1, 3 and 8 smoothing factors (items = EMAs updated)
+* ema_fixed      - hr_ema_fix_update_batch, the integer only EMA, against hr_ema_update_batch with
+                   the same α (items = samples); the difference matters on FPU-less targets,
+                   where double math is emulated in software
+* percentiles    - a sample added then p10, median and p90 of the window, from the window
+                   histogram (rb_percentiles_r) or by copying and sorting the window
+* contention     - one writer and N readers on one buffer, at several buffer sizes
+* snapshot       - the same with readers copying the whole window with rb_snapshot_r
+                   (reads = elements copied)
+
+usage: ring_buffer_bench [--json FILE|-] [--filter SUBSTRING] [--min-time SECONDS]
+                         [--repetitions N]
+*/
+#include "bench_harness.hpp"
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/static_ring_buffer.hpp"
+extern "C" {
+#include "../src/heart_rate_gen.h"
+#include "../src/ring_buffer.h"
+}
+
+static const int kBufferSizes[] = { 64, 1024, 65536 };
+static const int kReaderCounts[] = { 1, 2, 4 };
+
+static std::string
+label(const char *name, int size) {
+    return std::string(name) + "/size:" + std::to_string(size);
+}
+
+static void
+bench_add_remove(bench::Runner &runner, int size) {
+    rb_init_buffer(size);
+    runner.run(label("add_remove", size), [](long long iterations) {
+        int value;
+        for (long long i = 0; i < iterations; i++) {
+            rb_add_element((int)i);
+            rb_remove_element(&value);
+            bench::do_not_optimize(value);
+        }
+    });
+    rb_free_buffer();
+}
+
+static void
+bench_add_overwrite(bench::Runner &runner, int size) {
+    rb_init_buffer(size);
+    for (int i = 0; i < size; i++)
+        rb_add_element(i);
+    runner.run(label("add_overwrite", size), [](long long iterations) {
+        for (long long i = 0; i < iterations; i++)
+            rb_add_element((int)i);
+    });
+    rb_free_buffer();
+}
+
+static void
+bench_scan(bench::Runner &runner, int size) {
+    rb_init_buffer(size);
+    for (int i = 0; i < size; i++)
+        rb_add_element(i);
+    runner.run(
+        label("scan", size),
+        [size](long long iterations) {
+            long long sum = 0;
+            for (long long i = 0; i < iterations; i++) {
+                for (int index = 0; index < size; index++) {
+                    int value;
+                    rb_get_element_at(index, &value);
+                    sum += value;
+                }
+            }
+            bench::do_not_optimize(sum);
+        },
+        size);
+    rb_free_buffer();
+}
+
+template <std::size_t N>
+static void
+bench_static(bench::Runner &runner) {
+    static srb::RingBuffer<int, N> rb;
+    for (std::size_t i = 0; i < N; i++)
+        rb.add((int)i);
+    runner.run(label("static/add_overwrite", (int)N), [](long long iterations) {
+        for (long long i = 0; i < iterations; i++)
+            rb.add((int)i);
+        bench::do_not_optimize(rb);
+    });
+    runner.run(
+        label("static/scan", (int)N),
+        [](long long iterations) {
+            long long sum = 0;
+            for (long long i = 0; i < iterations; i++) {
+                for (std::size_t index = 0; index < N; index++)
+                    sum += rb[index];
+            }
+            bench::do_not_optimize(sum);
+        },
+        (double)N);
+}
+
+static void
+bench_ema(bench::Runner &runner, int size) {
+    hr_init_buffer(size, NULL);
+    hr_seed(1);
+    std::vector<int> samples(4096);
+    hr_generate_batch(samples.data(), samples.size());
+
+    runner.run(label("ema", size), [&samples](long long iterations) {
+        for (long long i = 0; i < iterations; i++) {
+            hr_update_buffer(samples[(size_t)i & 4095]);
+            double ema = hr_calculate_ema(0.1);
+            bench::do_not_optimize(ema);
+        }
+    });
+
+    // Per call latency, the clock reads dominate below ~50ns so report percentiles only
+    if (runner.enabled(label("ema_latency", size))) {
+        const size_t calls = 200000;
+        std::vector<double> latencies(calls);
+        for (size_t i = 0; i < calls; i++) {
+            auto begin = std::chrono::steady_clock::now();
+            hr_update_buffer(samples[i & 4095]);
+            double ema = hr_calculate_ema(0.1);
+            auto end = std::chrono::steady_clock::now();
+            bench::do_not_optimize(ema);
+            latencies[i] = std::chrono::duration<double, std::nano>(end - begin).count();
+        }
+        std::sort(latencies.begin(), latencies.end());
+
+        bench::Result result;
+        result.name = label("ema_latency", size);
+        result.iterations = (long long)calls;
+        result.ns_per_op = latencies[calls / 2];
+        result.min_ns_per_op = latencies.front();
+        result.items_per_second = 1e9 / result.ns_per_op;
+        result.counters = { { "p99_ns", latencies[calls * 99 / 100] },
+                            { "p999_ns", latencies[calls * 999 / 1000] },
+                            { "max_ns", latencies.back() } };
+        runner.add(result);
+    }
+    rb_free_buffer();
+}
+
+static void
+bench_ema_bank(bench::Runner &runner, size_t alphas) {
+    const double all[HR_EMA_MAX_ALPHAS] = { HR_EMA_FAST, HR_EMA_MEDIUM, HR_EMA_SLOW, 0.5,
+                                            0.2,         0.05,          0.02,        0.001 };
+    hr_ema_t ema;
+    hr_ema_init(&ema, all, alphas);
+    std::vector<int> samples(4096);
+    hr_seed(1);
+    hr_generate_batch(samples.data(), samples.size());
+
+    runner.run(
+        "ema_bank/alphas:" + std::to_string(alphas),
+        [&](long long iterations) {
+            for (long long i = 0; i < iterations; i++)
+                hr_ema_update(&ema, samples[(size_t)i & 4095]);
+            bench::do_not_optimize(ema);
+        },
+        (double)alphas);
+}
+
+static void
+bench_percentiles(bench::Runner &runner, int size) {
+    hr_init_buffer(size, NULL);
+    hr_seed(1);
+    std::vector<int> samples(4096);
+    hr_generate_batch(samples.data(), samples.size());
+    for (int i = 0; i < size; i++)
+        hr_update_buffer(samples[(size_t)i & 4095]);
+
+    static const double percentiles[] = { 10.0, 50.0, 90.0 };
+    runner.run(label("percentiles/histogram", size), [&samples](long long iterations) {
+        int values[3];
+        for (long long i = 0; i < iterations; i++) {
+            hr_update_buffer(samples[(size_t)i & 4095]);
+            rb_percentiles_r(rb_default(), percentiles, values, 3);
+            bench::do_not_optimize(values);
+        }
+    });
+
+    std::vector<int> window((size_t)size);
+    runner.run(label("percentiles/sort", size), [&](long long iterations) {
+        int values[3];
+        for (long long i = 0; i < iterations; i++) {
+            hr_update_buffer(samples[(size_t)i & 4095]);
+            size_t n = rb_snapshot(window.data(), window.size());
+            std::sort(window.begin(), window.begin() + n);
+            for (int p = 0; p < 3; p++) {
+                size_t rank = (size_t)std::ceil(percentiles[p] / 100.0 * (double)n);
+                values[p] = window[rank ? rank - 1 : 0];
+            }
+            bench::do_not_optimize(values);
+        }
+    });
+    rb_free_buffer();
+}
+
+static void
+bench_ema_fixed(bench::Runner &runner) {
+    std::vector<int> samples(4096);
+    hr_seed(1);
+    hr_generate_batch(samples.data(), samples.size());
+
+    hr_ema_fix_t fixed;
+    hr_ema_fix_init_ratio(&fixed, 1, 10);
+    runner.run(
+        "ema_fixed/q16",
+        [&](long long iterations) {
+            for (long long i = 0; i < iterations; i++)
+                hr_ema_fix_update_batch(&fixed, samples.data(), samples.size());
+            bench::do_not_optimize(fixed);
+        },
+        (double)samples.size());
+
+    const double alpha = 0.1;
+    hr_ema_t ema;
+    hr_ema_init(&ema, &alpha, 1);
+    runner.run(
+        "ema_fixed/double",
+        [&](long long iterations) {
+            for (long long i = 0; i < iterations; i++)
+                hr_ema_update_batch(&ema, samples.data(), samples.size());
+            bench::do_not_optimize(ema);
+        },
+        (double)samples.size());
+}
+
+// One writer adds as fast as it can while the readers alternate last element and window reads,
+// or copy the whole window
+static void
+bench_contention(bench::Runner &runner, int size, int readers, bool snapshot) {
+    std::string name =
+        label(snapshot ? "snapshot" : "contention", size) + "/readers:" + std::to_string(readers);
+    if (!runner.enabled(name))
+        return;
+
+    rb_t *rb = rb_create(size);
+    if (!rb) {
+        std::fprintf(stderr, "Buffer creation failed\n");
+        std::exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < size; i++)
+        rb_add_element_r(rb, i);
+
+    std::atomic<bool> start(false), stop(false);
+    std::atomic<long long> reads(0);
+    long long writes = 0;
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; r++)
+        threads.emplace_back([&, r]() {
+            while (!start.load())
+                std::this_thread::yield();
+            long long local = 0;
+            int value, index = r;
+            std::vector<int> window(snapshot ? (size_t)size : 0);
+            while (snapshot && !stop.load(std::memory_order_relaxed))
+                local += (long long)rb_snapshot_r(rb, window.data(), window.size());
+            while (!stop.load(std::memory_order_relaxed)) {
+                rb_get_last_element_r(rb, &value);
+                rb_get_element_at_r(rb, index, &value);
+                index = (index + 7) % size;
+                local += 2;
+            }
+            reads += local;
+        });
+
+    double duration = runner.options().min_time * runner.options().repetitions;
+    auto begin = std::chrono::steady_clock::now();
+    auto deadline = begin + std::chrono::duration<double>(duration);
+    start.store(true);
+    while (std::chrono::steady_clock::now() < deadline) {
+        for (int i = 0; i < 1024; i++)
+            rb_add_element_r(rb, i);
+        writes += 1024;
+    }
+    auto end = std::chrono::steady_clock::now();
+    stop.store(true);
+    for (auto &thread : threads)
+        thread.join();
+    rb_destroy(rb);
+
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    bench::Result result;
+    result.name = name;
+    result.iterations = writes;
+    result.ns_per_op = seconds * 1e9 / (double)writes;
+    result.min_ns_per_op = result.ns_per_op;
+    result.items_per_second = (double)writes / seconds;
+    result.counters = { { "reads_per_second", (double)reads.load() / seconds } };
+    runner.add(result);
+}
+
+int
+main(int argc, char *argv[]) {
+    bench::Options options;
+    int first = bench::parse_options(argc, argv, options);
+    if (first < 0 || first != argc) {
+        std::fprintf(stderr, "Usage: %s %s\n", argv[0], bench::options_usage());
+        return EXIT_FAILURE;
+    }
+
+    bench::Runner runner(options, argv[0]);
+    for (int size : kBufferSizes) {
+        bench_add_remove(runner, size);
+        bench_add_overwrite(runner, size);
+        bench_scan(runner, size);
+        bench_ema(runner, size);
+        bench_percentiles(runner, size);
+    }
+    bench_static<64>(runner);
+    bench_static<1024>(runner);
+    bench_static<1000>(runner);
+    for (size_t alphas : { 1, 3, HR_EMA_MAX_ALPHAS })
+        bench_ema_bank(runner, alphas);
+    bench_ema_fixed(runner);
+    for (int size : kBufferSizes)
+        for (int readers : kReaderCounts)
+            for (bool snapshot : { false, true })
+                bench_contention(runner, size, readers, snapshot);
+
+    return runner.finish() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
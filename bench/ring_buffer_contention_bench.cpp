@@ -0,0 +1,102 @@
+/*
+Fan-in contention benchmark: N producer threads add to one ring buffer while one consumer thread
+drains it, comparing the mutex protected mode (RB_MODE_LOCKED) with the lock-free RB_MODE_MPMC.
+
+usage: ring_buffer_contention_bench [--json FILE|-] [--filter SUBSTRING] [elements_per_producer]
+*/
+#include "bench_harness.hpp"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+extern "C" {
+#include "../src/ring_buffer.h"
+}
+
+static const int kProducerCounts[] = { 1, 2, 4, 8, 16 };
+static const int kBufferSize = 4096;
+
+// Returns the aggregate producer throughput in elements per second
+static double
+run(rb_mode_t mode, int producers, int per_producer) {
+    rb_config_t config = {};
+    config.size = kBufferSize;
+    config.mode = mode;
+    rb_t *rb = rb_create_ex(&config);
+    if (!rb) {
+        std::fprintf(stderr, "Buffer creation failed\n");
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::atomic<bool> start(false);
+    std::atomic<int> done_producers(0);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++)
+        threads.emplace_back([&, p]() {
+            while (!start.load())
+                std::this_thread::yield();
+            for (int i = 0; i < per_producer; i++)
+                rb_add_element_r(rb, p + i);
+            done_producers++;
+        });
+    std::thread consumer([&]() {
+        while (!start.load())
+            std::this_thread::yield();
+        while (done_producers.load() < producers) {
+            // The locked mode logs every empty remove, only drain what is there
+            if (!rb_is_empty_r(rb))
+                rb_remove_element_r(rb, NULL);
+        }
+    });
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true);
+    for (auto &thread : threads)
+        thread.join();
+    auto end = std::chrono::steady_clock::now();
+    consumer.join();
+    rb_destroy(rb);
+
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    return (double)producers * per_producer / seconds;
+}
+
+static bench::Result
+make_result(const char *mode, int producers, int per_producer, double per_second) {
+    bench::Result result;
+    result.name = std::string("fan_in/mode:") + mode + "/producers:" + std::to_string(producers);
+    result.iterations = (long long)producers * per_producer;
+    result.ns_per_op = 1e9 / per_second;
+    result.min_ns_per_op = result.ns_per_op;
+    result.items_per_second = per_second;
+    return result;
+}
+
+int
+main(int argc, char *argv[]) {
+    bench::Options options;
+    int first = bench::parse_options(argc, argv, options);
+    int per_producer = (first >= 0 && first < argc) ? std::atoi(argv[first]) : 200000;
+    if (first < 0 || argc - first > 1 || per_producer <= 0) {
+        std::fprintf(stderr, "Usage: %s %s [elements_per_producer]\n", argv[0],
+                     bench::options_usage());
+        return EXIT_FAILURE;
+    }
+
+    bench::Runner runner(options, argv[0]);
+    for (int producers : kProducerCounts) {
+        bench::Result locked = make_result("locked", producers, per_producer, 0.0);
+        bench::Result mpmc = make_result("mpmc", producers, per_producer, 0.0);
+        if (!runner.enabled(locked.name) && !runner.enabled(mpmc.name))
+            continue;
+
+        double locked_rate = run(RB_MODE_LOCKED, producers, per_producer);
+        double mpmc_rate = run(RB_MODE_MPMC, producers, per_producer);
+        locked = make_result("locked", producers, per_producer, locked_rate);
+        mpmc = make_result("mpmc", producers, per_producer, mpmc_rate);
+        mpmc.counters = { { "speedup", mpmc_rate / locked_rate } };
+        runner.add(locked);
+        runner.add(mpmc);
+    }
+    return runner.finish() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,113 @@
+#include "anomaly_detector.h"
+#include <math.h>
+#include <stdio.h>
+
+static const char *const ad_kind_names_g[] = { "bradycardia", "tachycardia", "jump", "outlier" };
+
+int
+ad_init(ad_detector_t *detector, const ad_config_t *config) {
+    if (!detector)
+        return -1;
+
+    ad_config_t c = { AD_DEFAULT_BRADYCARDIA_BPM, AD_DEFAULT_TACHYCARDIA_BPM, AD_DEFAULT_JUMP_BPM,
+                      AD_DEFAULT_Z_SCORE, AD_DEFAULT_Z_MIN_SAMPLES };
+    if (config && config->bradycardia_bpm)
+        c.bradycardia_bpm = config->bradycardia_bpm;
+    if (config && config->tachycardia_bpm)
+        c.tachycardia_bpm = config->tachycardia_bpm;
+    if (config && config->jump_bpm)
+        c.jump_bpm = config->jump_bpm;
+    if (config && config->z_score)
+        c.z_score = config->z_score;
+    if (config && config->z_min_samples)
+        c.z_min_samples = config->z_min_samples;
+
+    if (c.bradycardia_bpm >= c.tachycardia_bpm || !(c.jump_bpm > 0.0) || !(c.z_score > 0.0)) {
+        fprintf(stderr, "Invalid anomaly detector thresholds\n");
+        return -1;
+    }
+
+    *detector = (ad_detector_t){ .config = c };
+    return 0;
+}
+
+// z-score of the sample against the other samples of the window, false if there are too few or
+// they are all equal
+static bool
+ad_z_score(const ad_config_t *config, int heart_rate, const rb_stats_t *window, double *z) {
+    if (window->count < config->z_min_samples + 1)
+        return false;
+
+    // Take the sample out: the window mean and variance give its sum and sum of squares
+    double n = (double)window->count;
+    double x = (double)heart_rate;
+    double sum = (double)window->sum - x;
+    double squares = window->variance * n + window->mean * window->mean * n - x * x;
+    double mean = sum / (n - 1.0);
+    double variance = squares / (n - 1.0) - mean * mean;
+    if (!(variance > 1e-9))
+        return false;
+
+    *z = (x - mean) / sqrt(variance);
+    return true;
+}
+
+size_t
+ad_process(ad_detector_t *detector, int heart_rate, double ema, const rb_stats_t *window,
+           uint64_t time_ns, ad_event_t *events) {
+    if (!detector || !events)
+        return 0;
+
+    const ad_config_t *config = &detector->config;
+    size_t n = 0;
+#define AD_RAISE(k, v, t)                                                                          \
+    do {                                                                                           \
+        events[n++] = (ad_event_t){ (k), time_ns, heart_rate, ema, (v), (t) };                     \
+        detector->counts[(k)]++;                                                                   \
+    } while (0)
+
+    // Thresholds are edge triggered, one alert per episode
+    bool bradycardia = heart_rate < config->bradycardia_bpm;
+    bool tachycardia = heart_rate > config->tachycardia_bpm;
+    if (bradycardia && !detector->bradycardia)
+        AD_RAISE(AD_BRADYCARDIA, heart_rate, config->bradycardia_bpm);
+    if (tachycardia && !detector->tachycardia)
+        AD_RAISE(AD_TACHYCARDIA, heart_rate, config->tachycardia_bpm);
+    detector->bradycardia = bradycardia;
+    detector->tachycardia = tachycardia;
+
+    if (detector->has_ema) {
+        double jump = fabs((double)heart_rate - detector->last_ema);
+        if (jump > config->jump_bpm)
+            AD_RAISE(AD_JUMP, jump, config->jump_bpm);
+    }
+    detector->last_ema = ema;
+    detector->has_ema = true;
+
+    double z;
+    if (window && ad_z_score(config, heart_rate, window, &z) && fabs(z) > config->z_score)
+        AD_RAISE(AD_OUTLIER, z, config->z_score);
+#undef AD_RAISE
+
+    return n;
+}
+
+const char *
+ad_kind_name(ad_kind_t kind) {
+    if ((unsigned)kind > AD_OUTLIER)
+        return "unknown";
+    return ad_kind_names_g[kind];
+}
+
+int
+ad_format_event(const ad_event_t *event, char *buf, size_t size) {
+    if (!event || !buf)
+        return -1;
+
+    int len = snprintf(buf, size,
+                       "{\"time_ns\":%llu,\"alert\":\"%s\",\"heart_rate\":%d,\"ema\":%.2f,"
+                       "\"value\":%.2f,\"threshold\":%.2f}\n",
+                       (unsigned long long)event->time_ns, ad_kind_name(event->kind),
+                       event->heart_rate, event->ema, event->value, event->threshold);
+    return (len < 0 || (size_t)len >= size) ? -1 : len;
+}
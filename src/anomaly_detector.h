@@ -0,0 +1,117 @@
+#ifndef __ANOMALY_DETECTOR_H__
+#define __ANOMALY_DETECTOR_H__
+/*
+Streaming anomaly detection on the heart rate, run on every sample right after the buffer and
+the EMA are updated, with constant work per sample:
+* bradycardia / tachycardia - the heart rate crosses below / above a threshold. Raised once when
+  the condition starts, not on every sample while it lasts.
+* jump - the heart rate moves away from the EMA of the previous samples by more than a number of
+  beats, a sudden change the EMA has not followed yet.
+* outlier - the z-score of the heart rate against the other samples of the buffer window is
+  beyond a threshold. The mean and variance come from the O(1) window statistics of the buffer
+  (`rb_get_stats`), the sample itself is taken out of them.
+
+Alerts are returned as structured events, formatted as JSON lines by `ad_format_event` for a
+channel of their own, so consumers do not have to parse the sample output.
+
+Not thread-safe, a detector is owned by the sampling thread.
+
+this module would be prefixed with `ad_`.
+*/
+#include "ring_buffer.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define AD_DEFAULT_BRADYCARDIA_BPM 50 // Heart rates below are bradycardia
+#define AD_DEFAULT_TACHYCARDIA_BPM 120 // Heart rates above are tachycardia
+#define AD_DEFAULT_JUMP_BPM 30.0      // Distance from the previous EMA flagged as a jump
+#define AD_DEFAULT_Z_SCORE 3.0        // Absolute z-score flagged as an outlier
+#define AD_DEFAULT_Z_MIN_SAMPLES 30   // Other samples in the window before z-scores are trusted
+#define AD_MAX_EVENTS 3 // Events of one sample: a threshold crossing, a jump and an outlier
+#define AD_EVENT_JSON_SIZE 192 // Large enough for any `ad_format_event` line
+
+typedef enum {
+    AD_BRADYCARDIA = 0,
+    AD_TACHYCARDIA,
+    AD_JUMP,
+    AD_OUTLIER,
+} ad_kind_t;
+
+typedef struct {
+    int bradycardia_bpm;    // 0 for AD_DEFAULT_BRADYCARDIA_BPM
+    int tachycardia_bpm;    // 0 for AD_DEFAULT_TACHYCARDIA_BPM
+    double jump_bpm;        // 0 for AD_DEFAULT_JUMP_BPM
+    double z_score;         // 0 for AD_DEFAULT_Z_SCORE
+    size_t z_min_samples;   // 0 for AD_DEFAULT_Z_MIN_SAMPLES
+} ad_config_t;
+
+/**
+ * @brief An alert.
+ */
+typedef struct {
+    ad_kind_t kind;
+    uint64_t time_ns; // Time of the sample, as given to `ad_process`
+    int heart_rate;   // The sample
+    double ema;       // EMA including the sample
+    double value;     // What was compared to the threshold: the heart rate, its distance to the
+                      // previous EMA or its z-score
+    double threshold; // The threshold crossed
+} ad_event_t;
+
+/**
+ * @brief Detector state.
+ */
+typedef struct {
+    ad_config_t config; // With the defaults filled in
+    double last_ema;    // EMA before the current sample
+    bool has_ema;
+    bool bradycardia;   // Inside a bradycardia episode
+    bool tachycardia;   // Inside a tachycardia episode
+    uint64_t counts[AD_OUTLIER + 1]; // Events raised, per kind
+} ad_detector_t;
+
+/**
+ * @brief Initialize a detector.
+ *
+ * @param detector Detector to initialize.
+ * @param config Thresholds, NULL for the defaults.
+ * @return int 0 on success, -1 on invalid arguments (e.g. bradycardia above tachycardia).
+ */
+int ad_init(ad_detector_t *detector, const ad_config_t *config);
+
+/**
+ * @brief Check a sample, once it has been added to the buffer and folded into the EMA.
+ *
+ * @param detector Detector handle.
+ * @param heart_rate The sample.
+ * @param ema EMA including the sample.
+ * @param window Statistics of the buffer window including the sample, NULL to skip the z-score.
+ * @param time_ns Time of the sample, copied into the events.
+ * @param events Array of AD_MAX_EVENTS receiving the alerts.
+ * @return size_t Number of alerts raised by the sample.
+ */
+size_t ad_process(ad_detector_t *detector, int heart_rate, double ema, const rb_stats_t *window,
+                  uint64_t time_ns, ad_event_t *events);
+
+/**
+ * @brief Get the name of an alert kind, e.g. "tachycardia".
+ *
+ * @param kind Alert kind.
+ * @return const char* Name, "unknown" for an invalid kind.
+ */
+const char *ad_kind_name(ad_kind_t kind);
+
+/**
+ * @brief Format an alert as one line of JSON, newline included, e.g.
+ *        {"time_ns":3000000000,"alert":"jump","heart_rate":150,"ema":82.10,"value":69.50,
+ *        "threshold":30.00}
+ *
+ * @param event Alert.
+ * @param buf Destination, AD_EVENT_JSON_SIZE bytes are always enough.
+ * @param size Size of buf.
+ * @return int Length of the line, -1 if it does not fit.
+ */
+int ad_format_event(const ad_event_t *event, char *buf, size_t size);
+
+#endif // __ANOMALY_DETECTOR_H__
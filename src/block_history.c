@@ -0,0 +1,306 @@
+#include "block_history.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BH_FOR_FLAG 0x80  // Width byte flag of a frame of reference block
+#define BH_WIDTH_MASK 0x3f
+
+typedef struct {
+    uint8_t *data; // Encoded block followed by BH_PADDING bytes
+    size_t size;   // Encoded size, padding excluded
+} bh_block_t;
+
+struct bh_history {
+    bh_block_t *blocks; // Sealed blocks, oldest at head, BH_BLOCK_SAMPLES samples each
+    size_t capacity;    // Sealed blocks retained
+    size_t head;
+    size_t count;
+    uint64_t first_seq; // Sequence number of the oldest retained sample
+    size_t encoded_bytes;
+    int open[BH_BLOCK_SAMPLES]; // Block being filled, after the sealed ones
+    size_t open_count;
+    uint8_t scratch[BH_MAX_ENCODED(BH_BLOCK_SAMPLES)]; // Encoding buffer of the block being sealed
+};
+
+/*
+ * Codec.
+ */
+
+static inline uint64_t
+bh_load64(const uint8_t *p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+// Map signed differences to unsigned ones with small magnitudes first: 0, -1, 1, -2, 2...
+static inline uint32_t
+bh_zigzag(uint32_t delta) {
+    return (delta << 1) ^ (0u - (delta >> 31));
+}
+
+static inline uint32_t
+bh_unzigzag(uint32_t value) {
+    return (value >> 1) ^ (0u - (value & 1));
+}
+
+// Bits needed to hold value
+static inline unsigned
+bh_width(uint32_t value) {
+    return value ? 32u - (unsigned)__builtin_clz(value) : 0u;
+}
+
+size_t
+bh_encode(const int *values, size_t n, uint8_t *out) {
+    if (!values || !out || n == 0 || n > BH_BLOCK_SAMPLES)
+        return 0;
+
+    // Differences are taken modulo 2^32, the decoder undoes them the same way
+    uint32_t deltas = 0;
+    int lo = values[0], hi = values[0];
+    for (size_t i = 1; i < n; i++) {
+        deltas |= bh_zigzag((uint32_t)values[i] - (uint32_t)values[i - 1]);
+        if (values[i] < lo)
+            lo = values[i];
+        if (values[i] > hi)
+            hi = values[i];
+    }
+    unsigned delta_width = bh_width(deltas);
+    unsigned for_width = bh_width((uint32_t)hi - (uint32_t)lo);
+    bool use_for = for_width * n < delta_width * (n - 1);
+
+    uint32_t base = use_for ? (uint32_t)lo : (uint32_t)values[0];
+    unsigned width = use_for ? for_width : delta_width;
+    for (size_t i = 0; i < 4; i++)
+        out[i] = (uint8_t)(base >> (8 * i));
+    out[4] = (uint8_t)n;
+    out[5] = (uint8_t)(width | (use_for ? BH_FOR_FLAG : 0));
+
+    // At most 7 bits are pending before a value is added, so 39 bits fit the accumulator
+    uint8_t *p = out + BH_HEADER_SIZE;
+    uint64_t pending = 0;
+    unsigned bits = 0;
+    for (size_t i = use_for ? 0 : 1; i < n; i++) {
+        uint32_t packed = use_for ? (uint32_t)values[i] - base
+                                  : bh_zigzag((uint32_t)values[i] - (uint32_t)values[i - 1]);
+        pending |= (uint64_t)packed << bits;
+        bits += width;
+        while (bits >= 8) {
+            *p++ = (uint8_t)pending;
+            pending >>= 8;
+            bits -= 8;
+        }
+    }
+    if (bits > 0)
+        *p++ = (uint8_t)pending;
+
+    memset(p, 0, BH_PADDING);
+    return (size_t)(p - out);
+}
+
+// Unpack n values of width bits. 8 values span exactly width bytes, so once the width is a
+// constant every load offset and shift of a group is one too. Loads read at most 7 + 32 bits.
+static inline __attribute__((always_inline)) void
+bh_unpack_width(const uint8_t *packed, uint32_t *out, size_t n, unsigned width) {
+    uint64_t mask = (1ULL << width) - 1;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const uint8_t *group = packed + i / 8 * width;
+        for (unsigned j = 0; j < 8; j++) {
+            unsigned bit = j * width;
+            out[i + j] = (uint32_t)((bh_load64(group + bit / 8) >> (bit % 8)) & mask);
+        }
+    }
+    for (; i < n; i++) {
+        size_t bit = i * width;
+        out[i] = (uint32_t)((bh_load64(packed + bit / 8) >> (bit % 8)) & mask);
+    }
+}
+
+#define BH_WIDTHS(X)                                                                               \
+    X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) X(14) X(15) X(16)   \
+    X(17) X(18) X(19) X(20) X(21) X(22) X(23) X(24) X(25) X(26) X(27) X(28) X(29) X(30) X(31) X(32)
+
+static void
+bh_unpack(const uint8_t *packed, uint32_t *out, size_t n, unsigned width) {
+    switch (width) {
+#define BH_UNPACK_CASE(w)                                                                          \
+    case w:                                                                                        \
+        bh_unpack_width(packed, out, n, w);                                                        \
+        break;
+        BH_WIDTHS(BH_UNPACK_CASE)
+#undef BH_UNPACK_CASE
+    }
+}
+
+size_t
+bh_decode(const uint8_t *in, int *values) {
+    uint32_t base = (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 |
+                    (uint32_t)in[3] << 24;
+    size_t n = in[4];
+    unsigned width = in[5] & BH_WIDTH_MASK;
+    const uint8_t *packed = in + BH_HEADER_SIZE;
+    // int and uint32_t may alias, the values are unpacked in place
+    uint32_t *out = (uint32_t *)values;
+
+    if (in[5] & BH_FOR_FLAG) {
+        bh_unpack(packed, out, n, width);
+        for (size_t i = 0; i < n; i++)
+            out[i] += base;
+        return n;
+    }
+
+    out[0] = base;
+    bh_unpack(packed, out + 1, n - 1, width);
+    for (size_t i = 1; i < n; i++)
+        out[i] = out[i - 1] + bh_unzigzag(out[i]);
+    return n;
+}
+
+/*
+ * History.
+ */
+
+bh_history_t *
+bh_create(size_t capacity) {
+    size_t blocks = (capacity + BH_BLOCK_SAMPLES - 1) / BH_BLOCK_SAMPLES;
+    if (blocks == 0)
+        blocks = 1;
+
+    bh_history_t *history = calloc(1, sizeof(bh_history_t));
+    bh_block_t *ring = calloc(blocks, sizeof(bh_block_t));
+    if (!history || !ring) {
+        fprintf(stderr, "Memory allocation failed\n");
+        free(ring);
+        free(history);
+        return NULL;
+    }
+
+    history->blocks = ring;
+    history->capacity = blocks;
+    return history;
+}
+
+static void
+bh_drop_oldest(bh_history_t *history) {
+    bh_block_t *block = &history->blocks[history->head];
+    history->encoded_bytes -= block->size;
+    free(block->data);
+    block->data = NULL;
+    history->head = (history->head + 1 == history->capacity) ? 0 : history->head + 1;
+    history->count--;
+    history->first_seq += BH_BLOCK_SAMPLES;
+}
+
+void
+bh_destroy(bh_history_t *history) {
+    if (!history)
+        return;
+    while (history->count > 0)
+        bh_drop_oldest(history);
+    free(history->blocks);
+    free(history);
+}
+
+static int
+bh_seal(bh_history_t *history) {
+    size_t size = bh_encode(history->open, BH_BLOCK_SAMPLES, history->scratch);
+    history->open_count = 0;
+
+    uint8_t *data = malloc(size + BH_PADDING);
+    if (!data) {
+        // Sequence numbers of the retained samples derive from their block position, a gap would
+        // shift them, so the older blocks go with this one
+        fprintf(stderr, "Memory allocation failed, history dropped\n");
+        while (history->count > 0)
+            bh_drop_oldest(history);
+        history->first_seq += BH_BLOCK_SAMPLES;
+        return -1;
+    }
+    memcpy(data, history->scratch, size + BH_PADDING);
+
+    if (history->count == history->capacity)
+        bh_drop_oldest(history);
+
+    size_t slot = history->head + history->count;
+    if (slot >= history->capacity)
+        slot -= history->capacity;
+    history->blocks[slot] = (bh_block_t){ data, size };
+    history->count++;
+    history->encoded_bytes += size;
+    return 0;
+}
+
+int
+bh_add(bh_history_t *history, int value) {
+    if (!history)
+        return -1;
+
+    history->open[history->open_count++] = value;
+    if (history->open_count == BH_BLOCK_SAMPLES)
+        return bh_seal(history);
+    return 0;
+}
+
+size_t
+bh_read(const bh_history_t *history, uint64_t seq, int *out, size_t n) {
+    if (!history || !out)
+        return 0;
+
+    uint64_t sealed_end = history->first_seq + (uint64_t)history->count * BH_BLOCK_SAMPLES;
+    uint64_t end = sealed_end + history->open_count;
+    if (seq < history->first_seq || seq >= end)
+        return 0;
+    if (n > end - seq)
+        n = (size_t)(end - seq);
+
+    size_t copied = 0;
+    int decoded[BH_BLOCK_SAMPLES];
+    while (copied < n && seq < sealed_end) {
+        uint64_t position = seq - history->first_seq;
+        size_t slot = history->head + (size_t)(position / BH_BLOCK_SAMPLES);
+        if (slot >= history->capacity)
+            slot -= history->capacity;
+        size_t offset = (size_t)(position % BH_BLOCK_SAMPLES);
+        size_t chunk = BH_BLOCK_SAMPLES - offset;
+        if (chunk > n - copied)
+            chunk = n - copied;
+
+        // Whole blocks are decoded in place
+        if (chunk == BH_BLOCK_SAMPLES) {
+            bh_decode(history->blocks[slot].data, out + copied);
+        } else {
+            bh_decode(history->blocks[slot].data, decoded);
+            memcpy(out + copied, decoded + offset, chunk * sizeof(int));
+        }
+        copied += chunk;
+        seq += chunk;
+    }
+
+    if (copied < n) {
+        memcpy(out + copied, history->open + (seq - sealed_end), (n - copied) * sizeof(int));
+        copied = n;
+    }
+    return copied;
+}
+
+int
+bh_get_stats(const bh_history_t *history, bh_stats_t *stats) {
+    if (!history || !stats)
+        return -1;
+
+    stats->samples = (uint64_t)history->count * BH_BLOCK_SAMPLES + history->open_count;
+    stats->first_seq = history->first_seq;
+    stats->blocks = history->count;
+    stats->encoded_bytes = history->encoded_bytes;
+    stats->bits_per_sample =
+        history->count ? (double)history->encoded_bytes * 8.0 /
+                             (double)(history->count * BH_BLOCK_SAMPLES)
+                       : 0.0;
+    return 0;
+}
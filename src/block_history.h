@@ -0,0 +1,109 @@
+#ifndef __BLOCK_HISTORY_H__
+#define __BLOCK_HISTORY_H__
+/*
+Compressed raw sample history. Samples are appended to an open block of BH_BLOCK_SAMPLES values;
+a full block is sealed by encoding it, and the oldest sealed blocks are dropped beyond the
+retention. Heart rates change slowly within a small range, so a block of 128 samples takes a few
+bits per sample instead of the 32 of an int.
+
+Block encoding, little endian:
+* int32: the first value (delta) or the minimum (frame of reference)
+* uint8: the number of values, 1..BH_BLOCK_SAMPLES
+* uint8: the bit width w of the packed values, 0..32, bit 7 set for frame of reference
+* the packed values, w bits each, least significant bit first:
+  - delta: the zigzag encoded differences between consecutive values (count - 1 of them)
+  - frame of reference: every value minus the minimum (count of them)
+The encoder picks the narrower of the two per block: deltas win on slowly changing values, the
+frame of reference on noisy values in a narrow range. The decoder reads the packed values with
+unaligned 64-bit loads, so encoded blocks are followed by BH_PADDING readable bytes.
+
+Not thread-safe, the history is owned by the sampling thread.
+
+this module would be prefixed with `bh_`.
+*/
+#include <stddef.h>
+#include <stdint.h>
+
+#define BH_BLOCK_SAMPLES 128
+#define BH_HEADER_SIZE 6
+#define BH_PADDING 8
+// Bytes an encoded block of n values may take, padding included
+#define BH_MAX_ENCODED(n) (BH_HEADER_SIZE + (size_t)(n) * sizeof(int32_t) + BH_PADDING)
+
+typedef struct {
+    uint64_t samples;     // Samples retained, sealed and open
+    uint64_t first_seq;   // Sequence number (count of samples ever added) of the oldest retained
+    size_t blocks;        // Sealed blocks retained
+    size_t encoded_bytes; // Bytes of the sealed blocks, padding excluded
+    double bits_per_sample; // Over the sealed blocks, 0 if there are none
+} bh_stats_t;
+
+/**
+ * @brief Opaque history handle.
+ */
+typedef struct bh_history bh_history_t;
+
+/**
+ * @brief Encode a block of values.
+ *
+ * @param values Values to encode.
+ * @param n Number of values, 1..BH_BLOCK_SAMPLES.
+ * @param out Buffer of at least BH_MAX_ENCODED(n) bytes.
+ * @return size_t Size of the encoded block, padding excluded, 0 on invalid arguments.
+ */
+size_t bh_encode(const int *values, size_t n, uint8_t *out);
+
+/**
+ * @brief Decode a block encoded by `bh_encode`.
+ *
+ * @param in Encoded block, followed by BH_PADDING readable bytes.
+ * @param values Array of at least BH_BLOCK_SAMPLES values receiving the decoded ones.
+ * @return size_t Number of values decoded.
+ */
+size_t bh_decode(const uint8_t *in, int *values);
+
+/**
+ * @brief Create an empty history.
+ *
+ * @param capacity Samples to retain at least, rounded up to whole blocks.
+ * @return bh_history_t* History handle, NULL on failure.
+ */
+bh_history_t *bh_create(size_t capacity);
+
+/**
+ * @brief Destroy a history.
+ *
+ * @param history History handle, may be NULL.
+ */
+void bh_destroy(bh_history_t *history);
+
+/**
+ * @brief Append a sample, sealing the open block when it fills up.
+ *
+ * @param history History handle.
+ * @param value Sample value.
+ * @return int 0 on success, -1 if a sealed block could not be stored (its samples are lost).
+ */
+int bh_add(bh_history_t *history, int value);
+
+/**
+ * @brief Decode retained samples in order, starting at a sequence number.
+ *
+ * @param history History handle.
+ * @param seq Sequence number of the first sample to read, see `bh_stats_t::first_seq`.
+ * @param out Array receiving up to n samples.
+ * @param n Capacity of out.
+ * @return size_t Number of samples read, 0 if seq is not retained.
+ */
+size_t bh_read(const bh_history_t *history, uint64_t seq, int *out, size_t n);
+
+/**
+ * @brief Get the retention and compression statistics.
+ *
+ * @param history History handle.
+ * @param stats Pointer to store the statistics.
+ * @return int 0 on success, -1 on invalid arguments.
+ */
+int bh_get_stats(const bh_history_t *history, bh_stats_t *stats);
+
+#endif // __BLOCK_HISTORY_H__
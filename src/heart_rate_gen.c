@@ -1,22 +1,135 @@
 #include "heart_rate_gen.h"
 #include <math.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
-static bool is_initialized = false;
-static double previous_ema = 0.0;     // Store previous EMA value
-static bool first_measurement = true; // Flag for first measurement
+_Static_assert(HR_MIN_HEART_RATE >= 0 && HR_MAX_HEART_RATE <= UINT8_MAX,
+               "heart rates must fit the HR_ELEM_TYPE storage");
+
+// Context of hr_calculate_ema, its smoothing factor is set by each call. It belongs to one life
+// of the default buffer, identified by its generation, and restarts with the next one.
+static hr_ema_t default_ema_g = { .count = 1 };
+static uint64_t default_cursor_g = 0; // Sequence number of the next sample for default_ema_g
+static uint64_t default_generation_g = 0;
+
+// Generator of each thread for the context-less functions, seeded on first use
+static _Thread_local hr_rng_t thread_rng_g;
+static _Thread_local bool thread_rng_seeded_g = false;
+
+#define HR_RANGE ((uint32_t)(HR_MAX_HEART_RATE - HR_MIN_HEART_RATE + 1))
+
+// splitmix64, expands a seed into well mixed generator state
+static uint64_t
+hr_splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t
+hr_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+// xoshiro256** (Blackman & Vigna)
+static inline uint64_t
+hr_rng_next(hr_rng_t *rng) {
+    uint64_t *s = rng->state;
+    uint64_t result = hr_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = hr_rotl(s[3], 45);
+    return result;
+}
+
+// Unbiased value in 0..HR_RANGE-1 with Lemire's multiply-shift method, no division in the
+// common case
+static inline int
+hr_rng_heart_rate(hr_rng_t *rng) {
+    uint64_t product = (hr_rng_next(rng) >> 32) * HR_RANGE;
+    uint32_t low = (uint32_t)product;
+    if (low < HR_RANGE) {
+        uint32_t threshold = (uint32_t)(-HR_RANGE) % HR_RANGE;
+        while (low < threshold) {
+            product = (hr_rng_next(rng) >> 32) * HR_RANGE;
+            low = (uint32_t)product;
+        }
+    }
+    return HR_MIN_HEART_RATE + (int)(product >> 32);
+}
+
+static hr_rng_t *
+hr_thread_rng(void) {
+    if (!thread_rng_seeded_g) {
+        // Mix in the address of the thread local state so that threads get distinct streams
+        hr_rng_seed(&thread_rng_g, (uint64_t)time(NULL) ^ (uint64_t)(uintptr_t)&thread_rng_g);
+        thread_rng_seeded_g = true;
+    }
+    return &thread_rng_g;
+}
+
+void
+hr_rng_seed(hr_rng_t *rng, uint64_t seed) {
+    if (!rng)
+        return;
+
+    for (int i = 0; i < 4; i++)
+        rng->state[i] = hr_splitmix64(&seed);
+}
+
+int
+hr_generate_heart_rate_r(hr_rng_t *rng) {
+    if (!rng)
+        return HR_MIN_HEART_RATE;
+
+    return hr_rng_heart_rate(rng);
+}
+
+void
+hr_generate_batch_r(hr_rng_t *rng, int *out, size_t n) {
+    if (!rng || !out)
+        return;
+
+    for (size_t i = 0; i < n; i++)
+        out[i] = hr_rng_heart_rate(rng);
+}
+
+void
+hr_seed(uint64_t seed) {
+    hr_rng_seed(&thread_rng_g, seed);
+    thread_rng_seeded_g = true;
+}
 
 int
 hr_generate_heart_rate() {
-    if (!is_initialized) {
-        srand(time(NULL)); // Initialize random seed
-        is_initialized = true;
-    }
+    return hr_rng_heart_rate(hr_thread_rng());
+}
 
-    // Generate random heart rate within the range
-    int range = HR_MAX_HEART_RATE - HR_MIN_HEART_RATE + 1;
-    return HR_MIN_HEART_RATE + (rand() % range);
+void
+hr_generate_batch(int *out, size_t n) {
+    hr_generate_batch_r(hr_thread_rng(), out, n);
+}
+
+void
+hr_init_buffer(int size, const char *path) {
+    rb_config_t config = {
+        .size = size,
+        .mode = RB_MODE_LOCKED,
+        .track_stats = true,
+        .track_percentiles = true,
+        .elem_type = HR_ELEM_TYPE,
+        .path = path,
+    };
+    rb_init_buffer_ex(&config);
 }
 
 void
@@ -31,29 +144,157 @@ hr_update_buffer(int heart_rate) {
     rb_add_element(heart_rate);
 }
 
+int
+hr_ema_init(hr_ema_t *ema, const double *alphas, size_t count) {
+    if (!ema || !alphas || count == 0 || count > HR_EMA_MAX_ALPHAS)
+        return -1;
+
+    for (size_t i = 0; i < count; i++) {
+        if (!(alphas[i] > 0.0 && alphas[i] <= 1.0))
+            return -1;
+    }
+
+    memset(ema, 0, sizeof(hr_ema_t));
+    memcpy(ema->alpha, alphas, count * sizeof(double));
+    ema->count = count;
+    return 0;
+}
+
+// Fixed trip count and no branch, so the loop vectorizes; padding has alpha 0 and stays 0
+static inline void
+hr_ema_fold(hr_ema_t *ema, double sample) {
+    for (size_t i = 0; i < HR_EMA_MAX_ALPHAS; i++)
+        ema->value[i] = ema->alpha[i] * sample + (1.0 - ema->alpha[i]) * ema->value[i];
+}
+
+static inline void
+hr_ema_prime(hr_ema_t *ema, double sample) {
+    for (size_t i = 0; i < ema->count; i++)
+        ema->value[i] = sample;
+    ema->primed = true;
+}
+
+void
+hr_ema_update(hr_ema_t *ema, double sample) {
+    if (!ema)
+        return;
+
+    if (!ema->primed)
+        hr_ema_prime(ema, sample);
+    else
+        hr_ema_fold(ema, sample);
+}
+
+void
+hr_ema_update_batch(hr_ema_t *ema, const int *samples, size_t n) {
+    if (!ema || !samples || n == 0)
+        return;
+
+    size_t i = 0;
+    if (!ema->primed)
+        hr_ema_prime(ema, samples[i++]);
+    for (; i < n; i++)
+        hr_ema_fold(ema, samples[i]);
+}
+
+static void
+hr_ema_consume_chunk(const int *samples, size_t n, void *arg) {
+    hr_ema_update_batch(arg, samples, n);
+}
+
+size_t
+hr_ema_consume_r(hr_ema_t *ema, rb_t *rb, uint64_t *cursor, uint64_t *lost) {
+    if (!ema) {
+        if (lost)
+            *lost = 0;
+        return 0;
+    }
+    return rb_consume_since_r(rb, cursor, hr_ema_consume_chunk, ema, lost);
+}
+
+int
+hr_ema_fix_init_shift(hr_ema_fix_t *ema, unsigned shift) {
+    if (!ema || shift > HR_FIX_FRAC_BITS)
+        return -1;
+
+    *ema = (hr_ema_fix_t){ .alpha = HR_FIX_ONE >> shift };
+    return 0;
+}
+
+int
+hr_ema_fix_init_ratio(hr_ema_fix_t *ema, uint32_t num, uint32_t den) {
+    if (!ema || num == 0 || num > den)
+        return -1;
+
+    // Nearest fixed point value, exact integer arithmetic
+    uint64_t alpha = ((uint64_t)num * (uint64_t)HR_FIX_ONE + den / 2) / den;
+    if (alpha == 0)
+        return -1;
+
+    *ema = (hr_ema_fix_t){ .alpha = (int32_t)alpha };
+    return 0;
+}
+
+// Fixed point product >> HR_FIX_FRAC_BITS, to nearest with ties away from zero. Integer division
+// truncates toward zero on every compiler, unlike right shifts of negative values, and by a
+// constant power of two it compiles to shifts.
+static inline int32_t
+hr_fix_round(int64_t product) {
+    const int64_t half = (int64_t)1 << (HR_FIX_FRAC_BITS - 1);
+    return (int32_t)((product + (product < 0 ? -half : half)) / HR_FIX_ONE);
+}
+
+static inline void
+hr_ema_fix_fold(hr_ema_fix_t *ema, int sample) {
+    int64_t delta = (int64_t)sample * HR_FIX_ONE - ema->value;
+    ema->value += hr_fix_round(delta * ema->alpha);
+}
+
+void
+hr_ema_fix_update(hr_ema_fix_t *ema, int sample) {
+    if (!ema)
+        return;
+
+    if (!ema->primed) {
+        ema->value = sample * HR_FIX_ONE;
+        ema->primed = true;
+    } else {
+        hr_ema_fix_fold(ema, sample);
+    }
+}
+
+void
+hr_ema_fix_update_batch(hr_ema_fix_t *ema, const int *samples, size_t n) {
+    if (!ema || !samples || n == 0)
+        return;
+
+    size_t i = 0;
+    if (!ema->primed)
+        hr_ema_fix_update(ema, samples[i++]);
+    for (; i < n; i++)
+        hr_ema_fix_fold(ema, samples[i]);
+}
+
 double
 hr_calculate_ema(double smoothing_factor) {
     if (!rb_is_initialized() || rb_is_empty() || smoothing_factor <= 0.0 || smoothing_factor > 1.0)
         return -1.0;
 
-    int current_value;
-    int result = rb_get_last_element(&current_value);
-    if (result != 0)
-        return -1.0;
-
-    // For first measurement, initialize EMA with first value
-    if (first_measurement) {
-        previous_ema = current_value;
-        first_measurement = false;
-        return previous_ema;
+    // A re-initialized buffer numbers its samples from 0 again, start over from its first one
+    if (default_generation_g != rb_default_generation()) {
+        default_ema_g = (hr_ema_t){ .count = 1 };
+        default_cursor_g = 0;
+        default_generation_g = rb_default_generation();
     }
 
-    // Calculate EMA using exponential smoothing formula
-    // St = α * xt + (1 - α) * St-1
-    double new_ema = smoothing_factor * current_value + (1.0 - smoothing_factor) * previous_ema;
+    // For first measurement, the EMA is initialized with the first value
+    default_ema_g.alpha[0] = smoothing_factor;
+    uint64_t lost;
+    hr_ema_consume_r(&default_ema_g, rb_default(), &default_cursor_g, &lost);
+    if (lost > 0)
+        fprintf(stderr, "EMA missed %llu overwritten samples\n", (unsigned long long)lost);
 
-    // Store for next calculation
-    previous_ema = new_ema;
-
-    return new_ema;
+    if (!default_ema_g.primed)
+        return -1.0;
+    return default_ema_g.value[0];
 }
@@ -12,19 +12,222 @@ this module would be prefixed with `hr_`.
  */
 
 #include "ring_buffer.h"
+#include <stddef.h>
+#include <stdint.h>
 
 #define HR_MIN_HEART_RATE 44
 #define HR_MAX_HEART_RATE 185
 
+// Every valid heart rate fits in one byte, so the buffer stores them as uint8_t
+#define HR_ELEM_TYPE RB_ELEM_UINT8
+
+/**
+ * @brief Initialize the ring buffer for heart rate values, using the compact HR_ELEM_TYPE storage
+ *        and keeping the window statistics and percentiles (`rb_get_stats`, `rb_percentile`).
+ *        Same behavior as `rb_init_buffer` otherwise.
+ *
+ * @param size Size of the buffer to be initialized.
+ * @param path File keeping the buffer across restarts (see `rb_config_t.path`), NULL for none.
+ */
+void hr_init_buffer(int size, const char *path);
+
+/**
+ * @brief Random generator state (xoshiro256**). Each context is an independent, reproducible
+ *        stream, to be used by one thread at a time.
+ */
+typedef struct {
+    uint64_t state[4];
+} hr_rng_t;
+
+/**
+ * @brief Seed a generator context. The same seed always produces the same heart rates.
+ *
+ * @param rng Generator context.
+ * @param seed Any value, including 0.
+ */
+void hr_rng_seed(hr_rng_t *rng, uint64_t seed);
+
+/**
+ * @brief Generate a random heart rate value from a generator context.
+ *
+ * @param rng Generator context.
+ * @return int Random heart rate value, uniformly distributed in HR_MIN_HEART_RATE..HR_MAX_HEART_RATE.
+ */
+int hr_generate_heart_rate_r(hr_rng_t *rng);
+
+/**
+ * @brief Fill an array with random heart rate values from a generator context.
+ *        Same values as n successive calls to `hr_generate_heart_rate_r`.
+ *
+ * @param rng Generator context.
+ * @param out Array receiving the values.
+ * @param n Number of values to generate.
+ */
+void hr_generate_batch_r(hr_rng_t *rng, int *out, size_t n);
+
+/**
+ * @brief Seed the generator of the calling thread used by `hr_generate_heart_rate` and
+ *        `hr_generate_batch`. Without this call, each thread is seeded from the time.
+ *
+ * @param seed Any value, including 0.
+ */
+void hr_seed(uint64_t seed);
+
 /**
  * @brief Generate a random heart rate value.
+ *        Thread-safe, each thread uses its own generator (see `hr_seed`).
  *
  * @return int Random heart rate value.
  */
 int hr_generate_heart_rate();
 
+/**
+ * @brief Fill an array with random heart rate values, from the generator of the calling thread.
+ *
+ * @param out Array receiving the values.
+ * @param n Number of values to generate.
+ */
+void hr_generate_batch(int *out, size_t n);
+
+// Smoothing factors of the usual fast, medium and slow heart rate trends
+#define HR_EMA_FAST 0.3
+#define HR_EMA_MEDIUM 0.1
+#define HR_EMA_SLOW 0.01
+
+#define HR_EMA_MAX_ALPHAS 8 // Smoothing factors per EMA context
+
+/**
+ * @brief A bank of EMAs over the same samples, one per smoothing factor, updated together.
+ *        The arrays are padded to HR_EMA_MAX_ALPHAS with smoothing factor 0, which leaves the
+ *        padding unchanged, so an update is one branch free loop the compiler vectorizes.
+ *        Each context is independent, to be used by one thread at a time.
+ */
+typedef struct {
+    double alpha[HR_EMA_MAX_ALPHAS]; // Smoothing factors
+    double value[HR_EMA_MAX_ALPHAS]; // Current EMA of each smoothing factor
+    size_t count;                    // Smoothing factors in use
+    bool primed;                     // Whether a sample was folded in
+} hr_ema_t;
+
+/**
+ * @brief Initialize an EMA context.
+ *
+ * @param ema Context to initialize.
+ * @param alphas Smoothing factors, each in (0, 1].
+ * @param count Number of smoothing factors, 1 to HR_EMA_MAX_ALPHAS.
+ * @return int 0 on success, -1 on invalid arguments.
+ */
+int hr_ema_init(hr_ema_t *ema, const double *alphas, size_t count);
+
+/**
+ * @brief Fold one sample into every EMA of the context. The first sample initializes them.
+ *        St = α * xt + (1 - α) * St-1
+ *
+ * @param ema EMA context.
+ * @param sample New sample.
+ */
+void hr_ema_update(hr_ema_t *ema, double sample);
+
+/**
+ * @brief Fold samples into every EMA of the context, oldest first.
+ *        Same result as n successive calls to `hr_ema_update`.
+ *
+ * @param ema EMA context.
+ * @param samples Samples.
+ * @param n Number of samples.
+ */
+void hr_ema_update_batch(hr_ema_t *ema, const int *samples, size_t n);
+
+/**
+ * @brief Fold every sample added to a buffer since the cursor into an EMA context, in one locked
+ *        pass (see `rb_consume_since_r`), so no sample is skipped however rarely this is called.
+ *
+ * @param ema EMA context.
+ * @param rb Buffer handle, in locked mode.
+ * @param cursor Sequence number of the next sample, 0 to start with the oldest stored sample.
+ * @param lost Pointer to store how many samples were overwritten before they could be folded in,
+ *        may be NULL.
+ * @return size_t Number of samples folded in.
+ */
+size_t hr_ema_consume_r(hr_ema_t *ema, rb_t *rb, uint64_t *cursor, uint64_t *lost);
+
+/*
+Integer only EMA, for targets without an FPU and for results that are bit for bit the same with
+any compiler. Values are fixed point numbers with HR_FIX_FRAC_BITS fractional bits in an int32_t,
+Q16.16 by default (override with -DHR_FIX_FRAC_BITS=n), and so is the smoothing factor, given as a
+shift (α = 2^-k, exact) or as a ratio num/den (rounded to the nearest representable value).
+
+An update computes St = St-1 + α * (xt - St-1) as one 32x32 -> 64 bit multiply, whose result is
+rounded to the nearest fixed point value, ties away from zero, so rounding does not bias the EMA
+up or down. Each update rounds by at most half a unit (2^-(HR_FIX_FRAC_BITS+1)), and the EMA damps
+past errors by (1 - α), so the distance to the double EMA with the same α stays within
+2^-(HR_FIX_FRAC_BITS+1) / α, e.g. 0.0008 bpm for α = 0.01 in Q16.16. A rounded ratio α' adds up to
+|α' - α| * (max - min sample) / α'.
+*/
+
+#ifndef HR_FIX_FRAC_BITS
+#define HR_FIX_FRAC_BITS 16
+#endif
+#if HR_FIX_FRAC_BITS < 1 || HR_FIX_FRAC_BITS > 22
+#error "HR_FIX_FRAC_BITS must leave room for the heart rates, 1 to 22"
+#endif
+
+#define HR_FIX_ONE ((int32_t)1 << HR_FIX_FRAC_BITS) // 1.0 in fixed point
+#define HR_FIX_TO_DOUBLE(x) ((double)(x) / (double)HR_FIX_ONE)
+
+/**
+ * @brief A fixed point EMA. Each context is independent, to be used by one thread at a time.
+ */
+typedef struct {
+    int32_t value; // Current EMA, in fixed point
+    int32_t alpha; // Smoothing factor, in fixed point, 1 to HR_FIX_ONE
+    bool primed;   // Whether a sample was folded in
+} hr_ema_fix_t;
+
+/**
+ * @brief Initialize a fixed point EMA with smoothing factor 2^-shift.
+ *
+ * @param ema Context to initialize.
+ * @param shift 0 to HR_FIX_FRAC_BITS, e.g. 3 for α = 0.125.
+ * @return int 0 on success, -1 on invalid arguments.
+ */
+int hr_ema_fix_init_shift(hr_ema_fix_t *ema, unsigned shift);
+
+/**
+ * @brief Initialize a fixed point EMA with smoothing factor num/den, rounded to the nearest fixed
+ *        point value, e.g. 1/10 is 6554/65536 in Q16.16.
+ *
+ * @param ema Context to initialize.
+ * @param num Numerator, 1 to den.
+ * @param den Denominator.
+ * @return int 0 on success, -1 on invalid arguments or if num/den rounds to 0.
+ */
+int hr_ema_fix_init_ratio(hr_ema_fix_t *ema, uint32_t num, uint32_t den);
+
+/**
+ * @brief Fold one sample into a fixed point EMA, with integer arithmetic only. The first sample
+ *        initializes it.
+ *
+ * @param ema EMA context.
+ * @param sample New sample, |sample| < 2^(31 - HR_FIX_FRAC_BITS), e.g. any heart rate.
+ */
+void hr_ema_fix_update(hr_ema_fix_t *ema, int sample);
+
+/**
+ * @brief Fold samples into a fixed point EMA, oldest first.
+ *        Same result as n successive calls to `hr_ema_fix_update`.
+ *
+ * @param ema EMA context.
+ * @param samples Samples.
+ * @param n Number of samples.
+ */
+void hr_ema_fix_update_batch(hr_ema_fix_t *ema, const int *samples, size_t n);
+
 /**
  * @brief Calculate the Exponential Moving Average (EMA) of the heart rate values in the buffer.
+ *        Folds every value added since the previous call into a default single EMA context (see
+ *        `hr_ema_consume_r`), and logs values that were overwritten before it could see them.
+ *        Code that needs several trends or several threads should own `hr_ema_t` contexts.
  *
  * @return double Exponential Moving Average (EMA).
  *          -1.0 if the buffer is not initialized or empty.
@@ -0,0 +1,90 @@
+#include "latency_histogram.h"
+#include <string.h>
+
+#define LH_HALF (LH_SUB_BUCKETS / 2)
+
+/*
+Values below LH_SUB_BUCKETS have a bucket each. Above, a value with its highest bit at position
+LH_SUB_BUCKET_BITS - 1 + shift keeps its top LH_SUB_BUCKET_BITS bits, `value >> shift`, which is in
+[LH_HALF, LH_SUB_BUCKETS): the buckets of one shift follow those of the previous one.
+*/
+static inline size_t
+lh_bucket(uint64_t value) {
+    if (value < LH_SUB_BUCKETS)
+        return (size_t)value;
+
+    unsigned msb = 63u - (unsigned)__builtin_clzll(value);
+    unsigned shift = msb - (LH_SUB_BUCKET_BITS - 1);
+    return (size_t)shift * LH_HALF + (size_t)(value >> shift);
+}
+
+// Highest value counted in a bucket
+static inline uint64_t
+lh_bucket_high(size_t bucket) {
+    if (bucket < LH_SUB_BUCKETS)
+        return bucket;
+
+    unsigned shift = (unsigned)(bucket / LH_HALF) - 1;
+    uint64_t top = bucket % LH_HALF + LH_HALF;
+    return ((top + 1) << shift) - 1;
+}
+
+void
+lh_init(lh_histogram_t *histogram) {
+    memset(histogram, 0, sizeof(lh_histogram_t));
+    histogram->min = UINT64_MAX;
+}
+
+void
+lh_record(lh_histogram_t *histogram, uint64_t value) {
+    histogram->counts[lh_bucket(value)]++;
+    histogram->total++;
+    histogram->sum += (double)value;
+    if (value < histogram->min)
+        histogram->min = value;
+    if (value > histogram->max)
+        histogram->max = value;
+}
+
+void
+lh_merge(lh_histogram_t *dst, const lh_histogram_t *src) {
+    for (size_t i = 0; i < LH_BUCKETS; i++)
+        dst->counts[i] += src->counts[i];
+    dst->total += src->total;
+    dst->sum += src->sum;
+    if (src->min < dst->min)
+        dst->min = src->min;
+    if (src->max > dst->max)
+        dst->max = src->max;
+}
+
+uint64_t
+lh_percentile(const lh_histogram_t *histogram, double percentile) {
+    if (histogram->total == 0)
+        return 0;
+
+    if (percentile < 0.0)
+        percentile = 0.0;
+    if (percentile > 100.0)
+        percentile = 100.0;
+
+    // Rank of the value, at least the first one
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)histogram->total + 0.5);
+    if (rank == 0)
+        rank = 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LH_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if (seen >= rank) {
+            uint64_t high = lh_bucket_high(i);
+            return high < histogram->max ? high : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+double
+lh_mean(const lh_histogram_t *histogram) {
+    return histogram->total ? histogram->sum / (double)histogram->total : 0.0;
+}
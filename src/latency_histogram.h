@@ -0,0 +1,69 @@
+#ifndef __LATENCY_HISTOGRAM_H__
+#define __LATENCY_HISTOGRAM_H__
+/*
+A fixed size, HDR style latency histogram. Values (e.g. nanoseconds) are counted in log-linear
+buckets: every power of two range is split in LH_SUB_BUCKETS / 2 equal buckets, so any recorded
+value is known within 1 / (LH_SUB_BUCKETS / 2) of its magnitude (about 3%) over the whole uint64_t
+range, in a constant 15KiB and O(1) per record with no allocation.
+
+Not thread-safe, each thread records into its own histogram; histograms can then be merged.
+
+this module would be prefixed with `lh_`.
+*/
+#include <stddef.h>
+#include <stdint.h>
+
+#define LH_SUB_BUCKET_BITS 6
+#define LH_SUB_BUCKETS (1u << LH_SUB_BUCKET_BITS)
+#define LH_BUCKETS ((64 - LH_SUB_BUCKET_BITS + 1) * (LH_SUB_BUCKETS / 2) + LH_SUB_BUCKETS / 2)
+
+typedef struct {
+    uint64_t counts[LH_BUCKETS];
+    uint64_t total; // Number of recorded values
+    uint64_t min;   // Exact minimum, UINT64_MAX when empty
+    uint64_t max;   // Exact maximum
+    double sum;     // Sum of the values, for the mean
+} lh_histogram_t;
+
+/**
+ * @brief Initialize (or reset) a histogram to empty.
+ *
+ * @param histogram Histogram.
+ */
+void lh_init(lh_histogram_t *histogram);
+
+/**
+ * @brief Record one value.
+ *
+ * @param histogram Histogram.
+ * @param value Value to record.
+ */
+void lh_record(lh_histogram_t *histogram, uint64_t value);
+
+/**
+ * @brief Add the counts of src to dst.
+ *
+ * @param dst Destination histogram.
+ * @param src Source histogram.
+ */
+void lh_merge(lh_histogram_t *dst, const lh_histogram_t *src);
+
+/**
+ * @brief Get the value at a percentile, as the highest value of its bucket (never above the
+ *        recorded maximum), so at most about 3% above the exact percentile.
+ *
+ * @param histogram Histogram.
+ * @param percentile Percentile in [0, 100].
+ * @return uint64_t Value at the percentile, 0 if the histogram is empty.
+ */
+uint64_t lh_percentile(const lh_histogram_t *histogram, double percentile);
+
+/**
+ * @brief Get the mean of the recorded values.
+ *
+ * @param histogram Histogram.
+ * @return double Mean, 0 if the histogram is empty.
+ */
+double lh_mean(const lh_histogram_t *histogram);
+
+#endif // __LATENCY_HISTOGRAM_H__
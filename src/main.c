@@ -1,37 +1,458 @@
+#include "anomaly_detector.h"
+#include "block_history.h"
 #include "heart_rate_gen.h"
+#include "latency_histogram.h"
+#include "output_writer.h"
+#include "patient_engine.h"
 #include "ring_buffer.h"
+#include "rollup_store.h"
+#include "sample_clock.h"
+#include "sample_reader.h"
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <unistd.h> // For sleep
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
 #include <errno.h>
 #include <limits.h>
 
-#define SAMPLE_INTERVAL 1 // Interval in seconds to sample the heart rate
+#define DEFAULT_SAMPLE_RATE 1.0  // Heart rate samples per second
+#define REPLAY_BATCH 4096        // Samples read from the replay input at once
+#define DEFAULT_ENGINE_TICKS 1000 // Ticks of a multi-patient run
 
 static volatile int keep_running_g = 1; // Signal flag, volatile to prevent optimization
+static volatile sig_atomic_t dump_metrics_g = 0; // Set by SIGUSR1, the metrics are printed by main
+
+static rs_store_t *history_g; // Minute and hour rollups of the heart rate, since the start
+static bh_history_t *raw_history_g; // Compressed raw samples (--history), or NULL
+static ad_detector_t detector_g;     // Alerts on the heart rate
+static FILE *alerts_g;               // Alert channel, one JSON line per alert
+
+#if RB_ENABLE_METRICS
+static lh_histogram_t ema_latency_g; // Sample tick to EMA computed, in nanoseconds
+#endif
 
 void
 signal_handler(int signum) {
+    // Only set flags, stdout belongs to the output writer thread
     if (signum == SIGINT || signum == SIGTERM) {
-        printf("\nShutting down...\n");
         keep_running_g = 0;
     }
+#ifdef SIGUSR1
+    if (signum == SIGUSR1)
+        dump_metrics_g = 1;
+#endif
+}
+
+static void
+dump_metrics(void) {
+#if RB_ENABLE_METRICS
+    rb_metrics_t metrics;
+    if (rb_get_metrics(&metrics) != 0)
+        return;
+
+    fprintf(stderr,
+            "Buffer: adds %llu, removes %llu, overwrites %llu, empty reads %llu\n"
+            "Lock: acquisitions %llu, contended %llu, wait total %.3f ms, wait max %.3f us\n",
+            (unsigned long long)metrics.adds, (unsigned long long)metrics.removes,
+            (unsigned long long)metrics.overwrites, (unsigned long long)metrics.empty_reads,
+            (unsigned long long)metrics.lock_acquisitions,
+            (unsigned long long)metrics.lock_contended, (double)metrics.lock_wait_ns / 1e6,
+            (double)metrics.lock_wait_max_ns / 1e3);
+    if (ema_latency_g.total > 0)
+        fprintf(stderr,
+                "Sample to EMA latency (us): count %llu, mean %.2f, p50 %.2f, p99 %.2f, "
+                "p99.9 %.2f, max %.2f\n",
+                (unsigned long long)ema_latency_g.total, lh_mean(&ema_latency_g) / 1e3,
+                (double)lh_percentile(&ema_latency_g, 50.0) / 1e3,
+                (double)lh_percentile(&ema_latency_g, 99.0) / 1e3,
+                (double)lh_percentile(&ema_latency_g, 99.9) / 1e3,
+                (double)ema_latency_g.max / 1e3);
+#else
+    fprintf(stderr, "Metrics are compiled out (RB_ENABLE_METRICS)\n");
+#endif
+}
+
+static void
+dump_history(void) {
+    static const struct {
+        const char *name;
+        uint64_t range_ns;
+    } ranges[] = { { "minute", RS_MINUTE_NS }, { "hour", RS_HOUR_NS }, { "24 hours", 24 * RS_HOUR_NS } };
+
+    // Robust to spikes unlike the mean, from the window histogram of the buffer
+    static const double percentiles[] = { 10.0, 50.0, 90.0 };
+    int values[3];
+    rb_stats_t window;
+    if (rb_percentiles_r(rb_default(), percentiles, values, 3) == 0 && rb_get_stats(&window) == 0)
+        fprintf(stderr, "Heart rate, buffer window: median %d, p10 %d, p90 %d over %zu samples\n",
+                values[1], values[0], values[2], window.count);
+
+    for (size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+        rs_aggregate_t aggregate;
+        if (rs_query(history_g, ranges[i].range_ns, &aggregate) != 0)
+            return;
+        fprintf(stderr, "Heart rate, last %s: min %d, max %d, mean %.2f over %llu samples\n",
+                ranges[i].name, aggregate.min, aggregate.max, aggregate.mean,
+                (unsigned long long)aggregate.count);
+    }
+}
+
+static void
+dump_raw_history(void) {
+    bh_stats_t stats;
+    if (bh_get_stats(raw_history_g, &stats) != 0)
+        return;
+    fprintf(stderr, "History: %llu samples kept, %zu bytes compressed, %.2f bits per sample\n",
+            (unsigned long long)stats.samples, stats.encoded_bytes, stats.bits_per_sample);
+}
+
+static void
+print_usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options] <buffer_size> [state_file]\n"
+            "Options:\n"
+            "  -R, --rate HZ       Sample rate in Hz (default 1, up to %.0f), in replay the rate\n"
+            "                      the samples were recorded at, for the history\n"
+            "  -r, --replay FILE   Replay recorded samples from FILE ('-' for stdin) as fast as\n"
+            "                      possible instead of generating one per second\n"
+            "  -f, --format FMT    Replay format: text (default) or binary (one byte per sample)\n"
+            "  -q, --quiet         Replay without printing every sample, only the summary\n"
+            "  -o, --output FMT    Output format: text (default) or binary (%d byte records)\n"
+            "  -H, --history N     Also keep the last N raw samples, compressed\n"
+            "  -P, --patients N    Monitor N simulated patients (or replayed, with --replay) on a\n"
+            "                      pool of worker threads, as fast as possible, and report the\n"
+            "                      aggregate samples per second\n"
+            "  -W, --workers N     Worker threads of --patients (default one per core)\n"
+            "  -T, --ticks N       Ticks of --patients, %d samples per patient each (default %d)\n"
+            "  -A, --alerts FILE   Append the alerts (bradycardia, tachycardia, jumps, outliers) to\n"
+            "                      FILE as JSON lines (default stderr)\n",
+            prog, SC_MAX_RATE_HZ, OW_BINARY_RECORD_SIZE, PE_DEFAULT_BATCH, DEFAULT_ENGINE_TICKS);
+}
+
+static double
+elapsed_seconds(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/**
+ * @brief Run the anomaly detector on a sample added to the buffer and folded into the EMA, and
+ *        write its alerts to the alert channel.
+ */
+static void
+detect(int heart_rate, double ema, uint64_t time_ns) {
+    rb_stats_t window;
+    ad_event_t events[AD_MAX_EVENTS];
+    size_t n = ad_process(&detector_g, heart_rate, ema,
+                          rb_get_stats(&window) == 0 ? &window : NULL, time_ns, events);
+    if (n == 0)
+        return;
+
+    char line[AD_EVENT_JSON_SIZE];
+    for (size_t i = 0; i < n; i++)
+        if (ad_format_event(&events[i], line, sizeof(line)) > 0)
+            fputs(line, alerts_g);
+    fflush(alerts_g); // alerts are rare and wanted now
+}
+
+static void
+dump_alerts(void) {
+    fprintf(stderr, "Alerts: %llu bradycardia, %llu tachycardia, %llu jumps, %llu outliers\n",
+            (unsigned long long)detector_g.counts[AD_BRADYCARDIA],
+            (unsigned long long)detector_g.counts[AD_TACHYCARDIA],
+            (unsigned long long)detector_g.counts[AD_JUMP],
+            (unsigned long long)detector_g.counts[AD_OUTLIER]);
+}
+
+/**
+ * @brief Push recorded samples through the buffer and the EMA with no pacing.
+ *
+ * @return int EXIT_SUCCESS or EXIT_FAILURE.
+ */
+static int
+replay(const char *input, sr_format_t format, const ow_config_t *output, double smoothing_factor,
+       double sample_rate) {
+    bool use_stdin = (strcmp(input, "-") == 0);
+    FILE *stream = use_stdin ? stdin : fopen(input, format == SR_FORMAT_BINARY ? "rb" : "r");
+    if (!stream) {
+        fprintf(stderr, "Error: Failed to open %s: %s\n", input, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    // A replay must not lose output, wait for the writer rather than drop
+    ow_writer_t *writer = NULL;
+    if (output) {
+        ow_config_t config = *output;
+        config.block_when_full = true;
+        config.capacity = 1 << 16; // fewer waits on the writer
+        writer = ow_create(&config);
+        if (!writer) {
+            if (!use_stdin)
+                fclose(stream);
+            return EXIT_FAILURE;
+        }
+    }
+
+    static sr_reader_t reader; // Holds a 64KiB chunk, keep it off the stack
+    sr_init(&reader, stream, format);
+
+    int samples[REPLAY_BATCH];
+    size_t total = 0, rejected = 0;
+    double ema = -1.0;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    double period_ns = 1e9 / sample_rate; // Recording time of the samples, for the history
+
+    size_t n;
+    while (keep_running_g && (n = sr_read(&reader, samples, REPLAY_BATCH)) > 0) {
+        if (dump_metrics_g) {
+            dump_metrics_g = 0;
+            dump_metrics();
+            dump_history();
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            int heart_rate = samples[i];
+            if (heart_rate < HR_MIN_HEART_RATE || heart_rate > HR_MAX_HEART_RATE) {
+                rejected++; // would fold the previous sample into the EMA again
+                continue;
+            }
+
+            hr_update_buffer(heart_rate);
+            ema = hr_calculate_ema(smoothing_factor);
+            uint64_t time_ns = (uint64_t)((double)(total + i) * period_ns);
+            detect(heart_rate, ema, time_ns);
+            rs_add(history_g, heart_rate, time_ns);
+            bh_add(raw_history_g, heart_rate);
+            if (writer) {
+                ow_record_t record = { total + i, heart_rate, ema };
+                ow_write(writer, &record);
+            }
+        }
+        total += n;
+    }
+    ow_destroy(writer); // counted in the time, the output is part of the replay
+    double seconds = elapsed_seconds(&start);
+
+    if (!use_stdin)
+        fclose(stream);
+
+    fprintf(stderr, "Replayed %zu samples (%zu rejected) in %.3f s, %.0f samples/s\n", total,
+            rejected, seconds, seconds > 0.0 ? (double)total / seconds : 0.0);
+    if (ema != -1.0)
+        fprintf(stderr, "Final EMA: %.2f\n", ema);
+#if RB_ENABLE_METRICS
+    dump_metrics();
+#endif
+    dump_history();
+    dump_raw_history();
+    dump_alerts();
+
+    return reader.error ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * @brief Read the valid heart rates of a recording into memory, for the patients to share.
+ *
+ * @return int* Heart rates (free with free()), NULL on failure.
+ */
+static int *
+load_recording(const char *input, sr_format_t format, size_t *len) {
+    bool use_stdin = (strcmp(input, "-") == 0);
+    FILE *stream = use_stdin ? stdin : fopen(input, format == SR_FORMAT_BINARY ? "rb" : "r");
+    if (!stream) {
+        fprintf(stderr, "Error: Failed to open %s: %s\n", input, strerror(errno));
+        return NULL;
+    }
+
+    static sr_reader_t reader; // Holds a 64KiB chunk, keep it off the stack
+    sr_init(&reader, stream, format);
+
+    int *samples = NULL;
+    size_t count = 0, capacity = 0, n;
+    int chunk[REPLAY_BATCH];
+    while ((n = sr_read(&reader, chunk, REPLAY_BATCH)) > 0) {
+        if (!samples || count + n > capacity) {
+            capacity = capacity ? capacity * 2 : REPLAY_BATCH;
+            int *grown = realloc(samples, capacity * sizeof(int));
+            if (!grown) {
+                fprintf(stderr, "Memory allocation failed\n");
+                free(samples);
+                samples = NULL;
+                break;
+            }
+            samples = grown;
+        }
+        for (size_t i = 0; i < n; i++)
+            if (chunk[i] >= HR_MIN_HEART_RATE && chunk[i] <= HR_MAX_HEART_RATE)
+                samples[count++] = chunk[i];
+    }
+
+    if (!use_stdin)
+        fclose(stream);
+    if (samples && (reader.error || count == 0)) {
+        fprintf(stderr, "Error: No valid heart rate in %s\n", input);
+        free(samples);
+        samples = NULL;
+    }
+    *len = count;
+    return samples;
+}
+
+/**
+ * @brief Run the multi-patient engine and report its throughput.
+ *
+ * @return int EXIT_SUCCESS or EXIT_FAILURE.
+ */
+static int
+run_engine(pe_config_t *config, uint64_t ticks, const char *replay_input, sr_format_t format) {
+    int *recording = NULL;
+    if (replay_input) {
+        recording = load_recording(replay_input, format, &config->replay_len);
+        if (!recording)
+            return EXIT_FAILURE;
+        config->replay = recording;
+    }
+
+    pe_engine_t *engine = pe_create(config);
+    if (!engine) {
+        free(recording);
+        return EXIT_FAILURE;
+    }
+
+    pe_stats_t stats;
+    int ret = pe_run(engine, ticks, &stats);
+    if (ret == 0) {
+        fprintf(stderr,
+                "Monitored %zu patients on %zu workers, %llu ticks: %llu samples in %.3f s, "
+                "%.0f samples/s (%llu chunks stolen, %llu samples lost)\n",
+                config->patients, pe_workers(engine), (unsigned long long)stats.ticks,
+                (unsigned long long)stats.samples, stats.seconds, stats.samples_per_second,
+                (unsigned long long)stats.steals, (unsigned long long)stats.lost);
+    }
+
+    pe_destroy(engine);
+    free(recording);
+    return (ret == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Parse a positive count option.
+ *
+ * @return int 0 on success, -1 (after printing an error) otherwise.
+ */
+static int
+parse_count(const char *arg, const char *what, unsigned long long *value) {
+    char *end;
+    errno = 0;
+    *value = strtoull(arg, &end, 10);
+    if (errno != 0 || *end != '\0' || arg[0] == '-' || *value == 0 || *value > SIZE_MAX) {
+        fprintf(stderr, "Error: %s must be a positive number.\n", what);
+        return -1;
+    }
+    return 0;
 }
 
 int
 main(int argc, char *argv[]) {
-    printf("Heart Rate Exponential Moving Average Monitor\n");
+    static const struct option long_options[] = {
+        {"rate", required_argument, NULL, 'R'},
+        {"replay", required_argument, NULL, 'r'},
+        {"format", required_argument, NULL, 'f'},
+        {"quiet", no_argument, NULL, 'q'},
+        {"output", required_argument, NULL, 'o'},
+        {"history", required_argument, NULL, 'H'},
+        {"patients", required_argument, NULL, 'P'},
+        {"workers", required_argument, NULL, 'W'},
+        {"ticks", required_argument, NULL, 'T'},
+        {"alerts", required_argument, NULL, 'A'},
+        {NULL, 0, NULL, 0},
+    };
+
+    const char *replay_input = NULL;
+    sr_format_t replay_format = SR_FORMAT_TEXT;
+    bool quiet = false;
+    ow_format_t output_format = OW_FORMAT_TEXT;
+    double sample_rate = DEFAULT_SAMPLE_RATE;
+    unsigned long long raw_history = 0;
+    unsigned long long patients = 0, workers = 0, ticks = DEFAULT_ENGINE_TICKS;
+    const char *alerts_path = NULL;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "R:r:f:qo:H:P:W:T:A:", long_options, NULL)) != -1) {
+        char *end;
+        switch (opt) {
+        case 'R':
+            errno = 0;
+            sample_rate = strtod(optarg, &end);
+            if (errno != 0 || *end != '\0' || !(sample_rate > 0.0) || sample_rate > SC_MAX_RATE_HZ) {
+                fprintf(stderr, "Error: Sample rate must be a number in (0, %.0f] Hz.\n",
+                        SC_MAX_RATE_HZ);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'r':
+            replay_input = optarg;
+            break;
+        case 'f':
+            if (sr_parse_format(optarg, &replay_format) != 0) {
+                fprintf(stderr, "Error: Unknown replay format %s.\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'q':
+            quiet = true;
+            break;
+        case 'o':
+            if (ow_parse_format(optarg, &output_format) != 0) {
+                fprintf(stderr, "Error: Unknown output format %s.\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'H':
+            if (parse_count(optarg, "History size", &raw_history) != 0)
+                return EXIT_FAILURE;
+            break;
+        case 'P':
+            if (parse_count(optarg, "Number of patients", &patients) != 0)
+                return EXIT_FAILURE;
+            break;
+        case 'W':
+            if (parse_count(optarg, "Number of workers", &workers) != 0)
+                return EXIT_FAILURE;
+            break;
+        case 'T':
+            if (parse_count(optarg, "Number of ticks", &ticks) != 0)
+                return EXIT_FAILURE;
+            break;
+        case 'A':
+            alerts_path = optarg;
+            break;
+        default:
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
 
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <buffer_size>\n", argv[0]);
+    // The binary output owns stdout, messages go to stderr
+    FILE *info = (output_format == OW_FORMAT_BINARY) ? stderr : stdout;
+    fprintf(info, "Heart Rate Exponential Moving Average Monitor\n");
+
+    int positional = argc - optind;
+    if (positional != 1 && positional != 2) {
+        print_usage(argv[0]);
         return EXIT_FAILURE;
     }
 
+    // Optional file keeping the buffer content across restarts
+    const char *state_file = (positional == 2) ? argv[optind + 1] : NULL;
+
     // Parse the buffer size using strtol
     char *endptr;
     errno = 0; // Reset errno before calling strtol
-    long buffer_size = strtol(argv[1], &endptr, 10);
+    long buffer_size = strtol(argv[optind], &endptr, 10);
 
     // Check for conversion errors
     if (errno != 0 || *endptr != '\0') {
@@ -49,18 +470,109 @@ main(int argc, char *argv[]) {
 
     int buffer_size_int = (int)buffer_size;
 
+    // Every patient has its own buffer and EMAs, the single patient state below is not used
+    if (patients) {
+        fprintf(info, "Monitoring %llu patients with buffer size: %d\n", patients, buffer_size_int);
+        fflush(info);
+        pe_config_t config = {
+            .patients = (size_t)patients,
+            .workers = (size_t)workers,
+            .buffer_size = buffer_size_int,
+            .pin = true,
+            .seed = (uint64_t)time(NULL),
+        };
+        return run_engine(&config, ticks, replay_input, replay_format);
+    }
+
     // handle graceful exit
     signal(SIGINT, signal_handler);
+#ifdef SIGUSR1
+    // kill -USR1 <pid> prints the metrics
+    signal(SIGUSR1, signal_handler);
+#endif
+#if RB_ENABLE_METRICS
+    lh_init(&ema_latency_g);
+#endif
 
-    // Initialize the ring buffer
-    rb_init_buffer(buffer_size_int);
+    // Initialize the ring buffer, with compact heart rate storage
+    hr_init_buffer(buffer_size_int, state_file);
+
+    // The ring buffer keeps the recent samples, the store the long term history
+    history_g = rs_create(NULL);
+    if (raw_history)
+        raw_history_g = bh_create((size_t)raw_history);
+    if (!history_g || (raw_history && !raw_history_g)) {
+        rs_destroy(history_g);
+        rb_free_buffer();
+        return EXIT_FAILURE;
+    }
+
+    // Alerts go to a channel of their own, never mixed with the samples on stdout
+    ad_init(&detector_g, NULL);
+    alerts_g = alerts_path ? fopen(alerts_path, "a") : stderr;
+    if (!alerts_g) {
+        fprintf(stderr, "Error: Failed to open %s: %s\n", alerts_path, strerror(errno));
+        bh_destroy(raw_history_g);
+        rs_destroy(history_g);
+        rb_free_buffer();
+        return EXIT_FAILURE;
+    }
 
     // Smoothing factor for EMA calculation
     double smoothing_factor = 0.1;
 
-    printf("Starting heart rate monitor with buffer size: %d\n", buffer_size_int);
+    ow_config_t output = { .stream = stdout, .format = output_format };
+
+    if (replay_input) {
+        fprintf(info, "Replaying %s with buffer size: %d\n", replay_input, buffer_size_int);
+        fflush(info);
+        int status = replay(replay_input, replay_format, quiet ? NULL : &output, smoothing_factor,
+                            sample_rate);
+        if (alerts_g != stderr)
+            fclose(alerts_g);
+        bh_destroy(raw_history_g);
+        rs_destroy(history_g);
+        rb_free_buffer();
+        return status;
+    }
+
+    fprintf(info, "Starting heart rate monitor with buffer size: %d at %g Hz\n", buffer_size_int,
+            sample_rate);
+    fflush(info);
+
+    // Formatting and writing happen on the writer thread, the sampling thread only queues records
+    // and drops them (counted) rather than wait if the output can not keep up
+    output.timestamps = true;
+    ow_writer_t *writer = ow_create(&output);
+    if (!writer) {
+        if (alerts_g != stderr)
+            fclose(alerts_g);
+        bh_destroy(raw_history_g);
+        rs_destroy(history_g);
+        rb_free_buffer();
+        return EXIT_FAILURE;
+    }
+
+    // Sample on absolute deadlines, the work below does not stretch the period
+    sc_clock_t clock;
+    sc_init(&clock, sample_rate);
 
     while (keep_running_g) {
+        if (dump_metrics_g) {
+            dump_metrics_g = 0;
+            dump_metrics();
+            dump_history();
+        }
+
+        // Missed ticks are counted in clock.overruns and reported at exit
+        uint64_t timestamp_ns;
+        if (sc_wait(&clock, &timestamp_ns) < 0) {
+            if (errno == EINTR)
+                continue; // interrupted, keep_running_g tells if to stop
+            fprintf(stderr, "Error: Sampling clock failed: %s\n", strerror(errno));
+            break;
+        }
+
         // Generate a new random heart rate
         int heart_rate = hr_generate_heart_rate();
 
@@ -74,14 +586,36 @@ main(int argc, char *argv[]) {
             fprintf(stderr, "Error: EMA calculation failed\n");
             break;
         }
+#if RB_ENABLE_METRICS
+        lh_record(&ema_latency_g, sc_now_ns() - timestamp_ns);
+#endif
+        detect(heart_rate, ema, timestamp_ns - clock.start_ns);
+        rs_add(history_g, heart_rate, timestamp_ns - clock.start_ns);
+        bh_add(raw_history_g, heart_rate);
 
-        // Print the current heart rate and EMA
-        printf("New Heart Rate: %d, Current EMA: %.2f\n", heart_rate, ema);
-
-        // Wait for SAMPLE_INTERVAL seconds before generating the next heart rate
-        sleep(SAMPLE_INTERVAL);
+        // Queue the monotonic time of the sample since the start, the heart rate and EMA
+        ow_record_t record = { timestamp_ns - clock.start_ns, heart_rate, ema };
+        ow_write(writer, &record);
     }
 
+    uint64_t dropped = ow_dropped(writer);
+    ow_destroy(writer);
+
+    fprintf(info, "\nShutting down...\n");
+    fprintf(info, "Sampled %llu ticks, missed %llu, output dropped %llu\n",
+            (unsigned long long)clock.ticks, (unsigned long long)clock.overruns,
+            (unsigned long long)dropped);
+#if RB_ENABLE_METRICS
+    dump_metrics();
+#endif
+    dump_history();
+    dump_raw_history();
+    dump_alerts();
+
+    if (alerts_g != stderr)
+        fclose(alerts_g);
+    bh_destroy(raw_history_g);
+    rs_destroy(history_g);
     // Free the memory allocated for the ring buffer
     rb_free_buffer();
 
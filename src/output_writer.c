@@ -0,0 +1,264 @@
+#include "output_writer.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define OW_CACHE_LINE 64
+#define OW_BATCH_BYTES (64 * 1024) // Output formatted before one fwrite
+#define OW_TEXT_MAX 96             // Longest text line
+#define OW_FULL_WAIT_NS 100000L    // Producer sleep when the queue is full (block_when_full)
+
+struct ow_writer {
+    FILE *stream;
+    ow_format_t format;
+    bool timestamps;
+    bool block_when_full;
+    ow_record_t *records; // Queue storage, `mask + 1` records
+    size_t mask;
+    pthread_t thread;
+    pthread_mutex_t lock; // Only taken to sleep on, or wake, an empty queue
+    pthread_cond_t cond;
+    atomic_bool stop;
+    atomic_uint_fast64_t dropped;
+    _Alignas(OW_CACHE_LINE) atomic_size_t head; // Next record to write out (consumer)
+    _Alignas(OW_CACHE_LINE) atomic_size_t tail; // Next free slot (producer)
+    char pad[OW_CACHE_LINE - sizeof(atomic_size_t)];
+    char batch[OW_BATCH_BYTES];
+};
+
+int
+ow_parse_format(const char *name, ow_format_t *format) {
+    if (!name || !format)
+        return -1;
+
+    if (strcmp(name, "text") == 0)
+        *format = OW_FORMAT_TEXT;
+    else if (strcmp(name, "binary") == 0)
+        *format = OW_FORMAT_BINARY;
+    else
+        return -1;
+    return 0;
+}
+
+static size_t
+ow_format_record(const ow_writer_t *writer, const ow_record_t *record, char *out) {
+    if (writer->format == OW_FORMAT_BINARY) {
+        float ema = (float)record->ema;
+        uint32_t ema_bits;
+        memcpy(&ema_bits, &ema, sizeof(ema_bits));
+        for (int i = 0; i < 8; i++)
+            out[i] = (char)(record->timestamp_ns >> (8 * i));
+        for (int i = 0; i < 4; i++)
+            out[8 + i] = (char)(ema_bits >> (8 * i));
+        out[12] = (char)(uint8_t)record->heart_rate;
+        return OW_BINARY_RECORD_SIZE;
+    }
+
+    int len;
+    if (writer->timestamps)
+        len = snprintf(out, OW_TEXT_MAX, "[%.6f] New Heart Rate: %d, Current EMA: %.2f\n",
+                       (double)record->timestamp_ns / 1e9, record->heart_rate, record->ema);
+    else
+        len = snprintf(out, OW_TEXT_MAX, "New Heart Rate: %d, Current EMA: %.2f\n",
+                       record->heart_rate, record->ema);
+    if (len < 0)
+        return 0;
+    return (len < OW_TEXT_MAX) ? (size_t)len : OW_TEXT_MAX - 1;
+}
+
+/**
+ * @brief Format and write everything queued, in batches of up to OW_BATCH_BYTES.
+ *
+ * @return size_t Number of records written.
+ */
+static size_t
+ow_drain(ow_writer_t *writer) {
+    size_t head = atomic_load_explicit(&writer->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&writer->tail, memory_order_acquire);
+    size_t written = 0;
+
+    while (head != tail) {
+        size_t len = 0;
+        while (head != tail && len + OW_TEXT_MAX <= OW_BATCH_BYTES) {
+            len += ow_format_record(writer, &writer->records[head & writer->mask],
+                                    writer->batch + len);
+            head++;
+            written++;
+        }
+        // Hand the slots back before the slow write
+        atomic_store_explicit(&writer->head, head, memory_order_release);
+
+        if (fwrite(writer->batch, 1, len, writer->stream) != len)
+            fprintf(stderr, "Failed to write output\n");
+
+        tail = atomic_load_explicit(&writer->tail, memory_order_acquire);
+    }
+
+    if (written > 0)
+        fflush(writer->stream);
+    return written;
+}
+
+/**
+ * @brief Sleep until the queue is not empty or the writer is stopped.
+ *
+ * The producer signals when its record is the only one queued, i.e. the queue went from empty to
+ * non-empty. Both sides store their index, then fence, then read the other index: either this
+ * thread sees the new record, or the producer sees the queue it was drained to and signals, under
+ * the lock this thread holds until it waits.
+ */
+static void
+ow_wait(ow_writer_t *writer) {
+    pthread_mutex_lock(&writer->lock);
+    atomic_thread_fence(memory_order_seq_cst);
+    size_t head = atomic_load_explicit(&writer->head, memory_order_relaxed);
+    while (atomic_load_explicit(&writer->tail, memory_order_acquire) == head &&
+           !atomic_load_explicit(&writer->stop, memory_order_acquire))
+        pthread_cond_wait(&writer->cond, &writer->lock);
+    pthread_mutex_unlock(&writer->lock);
+}
+
+static void *
+ow_thread(void *arg) {
+    ow_writer_t *writer = arg;
+
+    while (!atomic_load_explicit(&writer->stop, memory_order_acquire)) {
+        if (ow_drain(writer) == 0)
+            ow_wait(writer);
+    }
+
+    // The producer stopped before `stop` was set, write what it left
+    ow_drain(writer);
+    return NULL;
+}
+
+ow_writer_t *
+ow_create(const ow_config_t *config) {
+    if (!config || !config->stream) {
+        fprintf(stderr, "Invalid writer configuration\n");
+        return NULL;
+    }
+
+    if (config->format != OW_FORMAT_TEXT && config->format != OW_FORMAT_BINARY) {
+        fprintf(stderr, "Invalid output format: %d\n", (int)config->format);
+        return NULL;
+    }
+
+    size_t capacity = config->capacity ? config->capacity : OW_DEFAULT_CAPACITY;
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+
+    ow_writer_t *writer = NULL;
+#ifdef _WIN32
+    writer = _aligned_malloc(sizeof(ow_writer_t), OW_CACHE_LINE);
+#else
+    if (posix_memalign((void **)&writer, OW_CACHE_LINE, sizeof(ow_writer_t)) != 0)
+        writer = NULL;
+#endif
+    ow_record_t *records = malloc(size * sizeof(ow_record_t));
+    if (!writer || !records) {
+        fprintf(stderr, "Memory allocation failed\n");
+        free(records);
+#ifdef _WIN32
+        _aligned_free(writer);
+#else
+        free(writer);
+#endif
+        return NULL;
+    }
+
+    memset(writer, 0, offsetof(ow_writer_t, batch));
+    writer->stream = config->stream;
+    writer->format = config->format;
+    writer->timestamps = config->timestamps;
+    writer->block_when_full = config->block_when_full;
+    writer->records = records;
+    writer->mask = size - 1;
+    atomic_init(&writer->stop, false);
+    atomic_init(&writer->dropped, 0);
+    atomic_init(&writer->head, 0);
+    atomic_init(&writer->tail, 0);
+
+    int ret = pthread_mutex_init(&writer->lock, NULL);
+    if (ret != 0) {
+        fprintf(stderr, "Mutex initialization failed: %s\n", strerror(ret));
+    } else if ((ret = pthread_cond_init(&writer->cond, NULL)) != 0) {
+        fprintf(stderr, "Condition variable initialization failed: %s\n", strerror(ret));
+        pthread_mutex_destroy(&writer->lock);
+    } else if ((ret = pthread_create(&writer->thread, NULL, ow_thread, writer)) != 0) {
+        fprintf(stderr, "Thread creation failed: %s\n", strerror(ret));
+        pthread_cond_destroy(&writer->cond);
+        pthread_mutex_destroy(&writer->lock);
+    }
+    if (ret != 0) {
+        free(records);
+#ifdef _WIN32
+        _aligned_free(writer);
+#else
+        free(writer);
+#endif
+        return NULL;
+    }
+    return writer;
+}
+
+bool
+ow_write(ow_writer_t *writer, const ow_record_t *record) {
+    if (!writer || !record)
+        return false;
+
+    size_t tail = atomic_load_explicit(&writer->tail, memory_order_relaxed);
+    while (tail - atomic_load_explicit(&writer->head, memory_order_acquire) > writer->mask) {
+        if (!writer->block_when_full) {
+            atomic_fetch_add_explicit(&writer->dropped, 1, memory_order_relaxed);
+            return false;
+        }
+        const struct timespec wait = { .tv_sec = 0, .tv_nsec = OW_FULL_WAIT_NS };
+        nanosleep(&wait, NULL);
+    }
+
+    writer->records[tail & writer->mask] = *record;
+    atomic_store_explicit(&writer->tail, tail + 1, memory_order_release);
+
+    // Wake the consumer only if the queue was empty, it may be asleep (see ow_wait)
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&writer->head, memory_order_relaxed) == tail) {
+        pthread_mutex_lock(&writer->lock);
+        pthread_cond_signal(&writer->cond);
+        pthread_mutex_unlock(&writer->lock);
+    }
+    return true;
+}
+
+uint64_t
+ow_dropped(const ow_writer_t *writer) {
+    if (!writer)
+        return 0;
+    return atomic_load_explicit(&writer->dropped, memory_order_relaxed);
+}
+
+void
+ow_destroy(ow_writer_t *writer) {
+    if (!writer)
+        return;
+
+    pthread_mutex_lock(&writer->lock);
+    atomic_store_explicit(&writer->stop, true, memory_order_release);
+    pthread_cond_signal(&writer->cond);
+    pthread_mutex_unlock(&writer->lock);
+    int ret = pthread_join(writer->thread, NULL);
+    if (ret != 0)
+        fprintf(stderr, "Thread join failed: %s\n", strerror(ret));
+
+    pthread_cond_destroy(&writer->cond);
+    pthread_mutex_destroy(&writer->lock);
+    free(writer->records);
+#ifdef _WIN32
+    _aligned_free(writer);
+#else
+    free(writer);
+#endif
+}
@@ -0,0 +1,92 @@
+#ifndef __OUTPUT_WRITER_H__
+#define __OUTPUT_WRITER_H__
+/*
+An asynchronous output stage. The sampling thread hands records over a lock-free single producer
+single consumer queue, and a background thread formats them and writes them in large batches, so
+formatting and write syscalls never run (nor block) on the sampling thread.
+
+Formats:
+* text: one line per record, "[<seconds>] New Heart Rate: <hr>, Current EMA: <ema>", the
+  timestamp prefix only when requested (ow_config_t::timestamps).
+* binary: OW_BINARY_RECORD_SIZE bytes per record, little endian: the timestamp in nanoseconds as
+  uint64, the EMA as IEEE 754 float32 and the heart rate as uint8.
+
+this module would be prefixed with `ow_`.
+*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define OW_BINARY_RECORD_SIZE 13
+#define OW_DEFAULT_CAPACITY 4096 // Records queued before the producer drops (or waits)
+
+typedef enum {
+    OW_FORMAT_TEXT = 0,
+    OW_FORMAT_BINARY,
+} ow_format_t;
+
+typedef struct {
+    uint64_t timestamp_ns; // Time of the sample, e.g. since the start of the sampling
+    int heart_rate;        // Heart rate, must fit uint8 for the binary format
+    double ema;            // EMA after the sample
+} ow_record_t;
+
+typedef struct {
+    FILE *stream;         // Output, not closed by the writer. Opened in binary mode for binary.
+    ow_format_t format;   // Output format
+    size_t capacity;      // Queue capacity in records, rounded up to a power of two, 0 for default
+    bool timestamps;      // Prefix text lines with the timestamp
+    bool block_when_full; // Wait for room instead of dropping the record when the queue is full
+} ow_config_t;
+
+/**
+ * @brief Opaque writer handle.
+ */
+typedef struct ow_writer ow_writer_t;
+
+/**
+ * @brief Parse a format name ("text" or "binary").
+ *
+ * @param name Format name.
+ * @param format Pointer to store the format.
+ * @return int 0 on success, -1 if the name is unknown.
+ */
+int ow_parse_format(const char *name, ow_format_t *format);
+
+/**
+ * @brief Create a writer and start its background thread.
+ *
+ * @param config Writer configuration.
+ * @return ow_writer_t* Writer handle, NULL on failure.
+ */
+ow_writer_t *ow_create(const ow_config_t *config);
+
+/**
+ * @brief Queue a record for writing. Allocation free, and lock-free unless the queue was empty:
+ *        then the background thread may be asleep and is woken. Only one thread may write to a
+ *        writer.
+ *
+ * @param writer Writer handle.
+ * @param record Record to write.
+ * @return bool true if queued, false if dropped because the queue is full.
+ */
+bool ow_write(ow_writer_t *writer, const ow_record_t *record);
+
+/**
+ * @brief Get the number of records dropped because the queue was full.
+ *
+ * @param writer Writer handle.
+ * @return uint64_t Dropped records.
+ */
+uint64_t ow_dropped(const ow_writer_t *writer);
+
+/**
+ * @brief Write the queued records, flush the stream, stop the background thread and free the
+ *        writer. No effect on NULL.
+ *
+ * @param writer Writer handle.
+ */
+void ow_destroy(ow_writer_t *writer);
+
+#endif // __OUTPUT_WRITER_H__
@@ -0,0 +1,379 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // pthread_setaffinity_np
+#endif
+#include "patient_engine.h"
+#include "heart_rate_gen.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PE_CACHE_LINE 64
+
+// State of one patient, only ever touched by the worker processing its chunk in the current tick
+typedef struct {
+    _Alignas(PE_CACHE_LINE) hr_ema_t ema;
+    hr_rng_t rng;
+    rb_t *rb;
+    uint64_t cursor;   // Next sample of the buffer to fold into the EMAs
+    size_t replay_pos; // Next recorded heart rate
+} pe_patient_t;
+
+typedef struct {
+    _Alignas(PE_CACHE_LINE) atomic_size_t next; // Next chunk to claim, by the owner or a thief
+    size_t begin;                                // Chunks owned, [begin, end)
+    size_t end;
+    size_t index;
+    pe_engine_t *engine;
+    pthread_t thread;
+    int *samples; // Batch being added, engine->batch samples in engine->samples
+    // Counters of the current run, written by this worker only
+    uint64_t processed;
+    uint64_t lost;
+    uint64_t steals;
+} pe_worker_t;
+
+struct pe_engine {
+    pe_patient_t *patients;
+    size_t patient_count;
+    pe_worker_t *workers;
+    size_t worker_count;
+    int *samples; // Batches of the workers, each one on its own cache lines
+    size_t batch;
+    size_t alpha_count;
+    bool pin;
+    const int *replay;
+    size_t replay_len;
+
+    // Tick barrier, and the gate holding the workers until they are all started
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    size_t waiting;
+    uint64_t generation;
+    bool gate_open;
+    uint64_t ticks; // Ticks of the current run
+};
+
+static void *
+pe_aligned_alloc(size_t size) {
+    void *ptr = NULL;
+#ifdef _WIN32
+    ptr = _aligned_malloc(size, PE_CACHE_LINE);
+#else
+    if (posix_memalign(&ptr, PE_CACHE_LINE, size) != 0)
+        ptr = NULL;
+#endif
+    return ptr;
+}
+
+static void
+pe_aligned_free(void *ptr) {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+static double
+pe_now_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void
+pe_barrier_wait(pe_engine_t *engine) {
+    pthread_mutex_lock(&engine->lock);
+    uint64_t generation = engine->generation;
+    if (++engine->waiting == engine->worker_count) {
+        engine->waiting = 0;
+        engine->generation++;
+        pthread_cond_broadcast(&engine->cond);
+    } else {
+        while (generation == engine->generation)
+            pthread_cond_wait(&engine->cond, &engine->lock);
+    }
+    pthread_mutex_unlock(&engine->lock);
+}
+
+static void
+pe_pin(size_t index) {
+#ifdef __linux__
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1)
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET((int)(index % (size_t)cores), &set);
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (ret != 0)
+        fprintf(stderr, "Failed to pin worker %zu: %s\n", index, strerror(ret));
+#else
+    (void)index;
+#endif
+}
+
+static void
+pe_process_chunk(pe_engine_t *engine, pe_worker_t *worker, size_t chunk) {
+    size_t first = chunk * PE_CHUNK_PATIENTS;
+    size_t last = first + PE_CHUNK_PATIENTS;
+    if (last > engine->patient_count)
+        last = engine->patient_count;
+
+    for (size_t p = first; p < last; p++) {
+        pe_patient_t *patient = &engine->patients[p];
+        if (engine->replay) {
+            for (size_t i = 0; i < engine->batch; i++) {
+                worker->samples[i] = engine->replay[patient->replay_pos];
+                if (++patient->replay_pos == engine->replay_len)
+                    patient->replay_pos = 0;
+            }
+        } else {
+            hr_generate_batch_r(&patient->rng, worker->samples, engine->batch);
+        }
+
+        rb_add_elements_r(patient->rb, worker->samples, engine->batch);
+        uint64_t lost;
+        hr_ema_consume_r(&patient->ema, patient->rb, &patient->cursor, &lost);
+        worker->processed += engine->batch;
+        worker->lost += lost;
+    }
+}
+
+static void *
+pe_worker_main(void *arg) {
+    pe_worker_t *worker = arg;
+    pe_engine_t *engine = worker->engine;
+
+    pthread_mutex_lock(&engine->lock);
+    while (!engine->gate_open)
+        pthread_cond_wait(&engine->cond, &engine->lock);
+    uint64_t ticks = engine->ticks;
+    pthread_mutex_unlock(&engine->lock);
+
+    if (engine->pin)
+        pe_pin(worker->index);
+
+    for (uint64_t tick = 0; tick < ticks; tick++) {
+        // Claims only start once every worker has reset its chunks
+        atomic_store_explicit(&worker->next, worker->begin, memory_order_relaxed);
+        pe_barrier_wait(engine);
+
+        size_t chunk;
+        while ((chunk = atomic_fetch_add_explicit(&worker->next, 1, memory_order_relaxed)) <
+               worker->end)
+            pe_process_chunk(engine, worker, chunk);
+
+        // Help the others, starting with the next worker so thieves spread over the victims
+        for (size_t k = 1; k < engine->worker_count; k++) {
+            pe_worker_t *victim = &engine->workers[(worker->index + k) % engine->worker_count];
+            while ((chunk = atomic_fetch_add_explicit(&victim->next, 1, memory_order_relaxed)) <
+                   victim->end) {
+                pe_process_chunk(engine, worker, chunk);
+                worker->steals++;
+            }
+        }
+
+        pe_barrier_wait(engine);
+    }
+    return NULL;
+}
+
+pe_engine_t *
+pe_create(const pe_config_t *config) {
+    static const double default_alphas[] = { HR_EMA_FAST, HR_EMA_MEDIUM, HR_EMA_SLOW };
+
+    if (!config || config->patients == 0 || config->buffer_size <= 0) {
+        fprintf(stderr, "Invalid engine configuration\n");
+        return NULL;
+    }
+    if (config->replay && config->replay_len == 0) {
+        fprintf(stderr, "Empty replay\n");
+        return NULL;
+    }
+
+    const double *alphas = config->alphas ? config->alphas : default_alphas;
+    size_t alpha_count = config->alphas ? config->alpha_count : 3;
+    size_t workers = config->workers;
+    if (workers == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = (cores > 0) ? (size_t)cores : 1;
+    }
+    size_t chunks = (config->patients + PE_CHUNK_PATIENTS - 1) / PE_CHUNK_PATIENTS;
+    if (workers > chunks)
+        workers = chunks; // a worker without chunks would only steal
+
+    pe_engine_t *engine = calloc(1, sizeof(pe_engine_t));
+    if (!engine) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return NULL;
+    }
+
+    int ret = pthread_mutex_init(&engine->lock, NULL);
+    if (ret != 0) {
+        fprintf(stderr, "Mutex initialization failed: %s\n", strerror(ret));
+        free(engine);
+        return NULL;
+    }
+
+    ret = pthread_cond_init(&engine->cond, NULL);
+    if (ret != 0) {
+        fprintf(stderr, "Condition variable initialization failed: %s\n", strerror(ret));
+        pthread_mutex_destroy(&engine->lock);
+        free(engine);
+        return NULL;
+    }
+
+    engine->patient_count = config->patients;
+    engine->worker_count = workers;
+    engine->batch = config->batch ? config->batch : PE_DEFAULT_BATCH;
+    engine->alpha_count = alpha_count;
+    engine->pin = config->pin;
+    engine->replay = config->replay;
+    engine->replay_len = config->replay_len;
+
+    size_t stride = (engine->batch * sizeof(int) + PE_CACHE_LINE - 1) / PE_CACHE_LINE *
+                    PE_CACHE_LINE / sizeof(int);
+    engine->patients = pe_aligned_alloc(config->patients * sizeof(pe_patient_t));
+    engine->workers = pe_aligned_alloc(workers * sizeof(pe_worker_t));
+    engine->samples = pe_aligned_alloc(workers * stride * sizeof(int));
+    if (!engine->patients || !engine->workers || !engine->samples) {
+        fprintf(stderr, "Memory allocation failed\n");
+        engine->patient_count = 0; // no buffer to destroy yet
+        pe_destroy(engine);
+        return NULL;
+    }
+    memset(engine->patients, 0, config->patients * sizeof(pe_patient_t));
+    memset(engine->workers, 0, workers * sizeof(pe_worker_t));
+
+    rb_config_t buffer = {
+        .size = config->buffer_size, .mode = RB_MODE_LOCKED, .elem_type = HR_ELEM_TYPE
+    };
+    for (size_t p = 0; p < config->patients; p++) {
+        pe_patient_t *patient = &engine->patients[p];
+        if (hr_ema_init(&patient->ema, alphas, alpha_count) != 0) {
+            fprintf(stderr, "Invalid smoothing factors\n");
+            pe_destroy(engine);
+            return NULL;
+        }
+        hr_rng_seed(&patient->rng, config->seed + p);
+        // Spread the patients over the recording, so they do not all see the same samples
+        if (config->replay)
+            patient->replay_pos = (size_t)((uint64_t)p * config->replay_len / config->patients);
+        patient->rb = rb_create_ex(&buffer);
+        if (!patient->rb) {
+            pe_destroy(engine);
+            return NULL;
+        }
+    }
+
+    for (size_t w = 0; w < workers; w++) {
+        pe_worker_t *worker = &engine->workers[w];
+        worker->begin = w * chunks / workers;
+        worker->end = (w + 1) * chunks / workers;
+        worker->index = w;
+        worker->engine = engine;
+        worker->samples = engine->samples + w * stride;
+    }
+    return engine;
+}
+
+void
+pe_destroy(pe_engine_t *engine) {
+    if (!engine)
+        return;
+
+    if (engine->patients) {
+        for (size_t p = 0; p < engine->patient_count; p++)
+            rb_destroy(engine->patients[p].rb);
+        pe_aligned_free(engine->patients);
+    }
+    pe_aligned_free(engine->workers);
+    pe_aligned_free(engine->samples);
+    pthread_cond_destroy(&engine->cond);
+    pthread_mutex_destroy(&engine->lock);
+    free(engine);
+}
+
+int
+pe_run(pe_engine_t *engine, uint64_t ticks, pe_stats_t *stats) {
+    if (!engine)
+        return -1;
+
+    for (size_t w = 0; w < engine->worker_count; w++) {
+        pe_worker_t *worker = &engine->workers[w];
+        worker->processed = 0;
+        worker->lost = 0;
+        worker->steals = 0;
+    }
+    engine->gate_open = false;
+    engine->ticks = ticks;
+
+    // Workers wait at the gate until all of them exist: if one can not be started, the others
+    // are released with no tick to run rather than left waiting for it at the barrier
+    size_t started = 0;
+    int ret = 0;
+    for (; started < engine->worker_count; started++) {
+        pe_worker_t *worker = &engine->workers[started];
+        ret = pthread_create(&worker->thread, NULL, pe_worker_main, worker);
+        if (ret != 0) {
+            fprintf(stderr, "Worker thread creation failed: %s\n", strerror(ret));
+            break;
+        }
+    }
+
+    double start = pe_now_seconds();
+    pthread_mutex_lock(&engine->lock);
+    if (ret != 0)
+        engine->ticks = 0;
+    engine->gate_open = true;
+    pthread_cond_broadcast(&engine->cond);
+    pthread_mutex_unlock(&engine->lock);
+
+    for (size_t w = 0; w < started; w++) {
+        int err = pthread_join(engine->workers[w].thread, NULL);
+        if (err != 0) {
+            fprintf(stderr, "Worker thread join failed: %s\n", strerror(err));
+            ret = err;
+        }
+    }
+    double seconds = pe_now_seconds() - start;
+
+    if (ret != 0)
+        return -1;
+
+    if (stats) {
+        memset(stats, 0, sizeof(pe_stats_t));
+        stats->ticks = ticks;
+        for (size_t w = 0; w < engine->worker_count; w++) {
+            stats->samples += engine->workers[w].processed;
+            stats->lost += engine->workers[w].lost;
+            stats->steals += engine->workers[w].steals;
+        }
+        stats->seconds = seconds;
+        stats->samples_per_second = (seconds > 0.0) ? (double)stats->samples / seconds : 0.0;
+    }
+    return 0;
+}
+
+size_t
+pe_workers(const pe_engine_t *engine) {
+    return engine ? engine->worker_count : 0;
+}
+
+int
+pe_get_ema(const pe_engine_t *engine, size_t patient, double *ema) {
+    if (!engine || !ema || patient >= engine->patient_count)
+        return -1;
+
+    const hr_ema_t *context = &engine->patients[patient].ema;
+    if (!context->primed)
+        return -1;
+    memcpy(ema, context->value, engine->alpha_count * sizeof(double));
+    return 0;
+}
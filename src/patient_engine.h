@@ -0,0 +1,99 @@
+#ifndef __PATIENT_ENGINE_H__
+#define __PATIENT_ENGINE_H__
+/*
+A multi-patient monitoring engine. Every patient has its own ring buffer and EMA context, kept in
+one cache line aligned struct so that two workers never share a line. Patients are grouped in
+chunks of PE_CHUNK_PATIENTS and the chunks sharded across worker threads, optionally pinned to
+cores, so a worker keeps processing the same patients and keeps them warm in its cache.
+
+The engine runs in ticks: in each tick every patient receives a batch of samples (generated, or
+read from a recording shared by the patients at per-patient offsets), added to its buffer in one
+call and folded into its EMAs in one pass. A worker done with its own chunks steals unclaimed
+chunks of the others, so a slow or preempted worker does not hold up the tick; all the workers
+meet at a barrier between ticks.
+
+The engine runs as fast as possible, to measure the aggregate throughput.
+
+this module would be prefixed with `pe_`.
+*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PE_CHUNK_PATIENTS 32 // Patients claimed at once by a worker
+#define PE_DEFAULT_BATCH 16  // Samples per patient per tick
+
+typedef struct {
+    size_t patients;      // Patients monitored
+    size_t workers;       // Worker threads, 0 for one per online core
+    int buffer_size;      // Samples kept in each patient's buffer
+    size_t batch;         // Samples per patient per tick, 0 for PE_DEFAULT_BATCH
+    const double *alphas; // EMA smoothing factors of every patient, NULL for the fast, medium
+                          // and slow trends (HR_EMA_FAST, HR_EMA_MEDIUM, HR_EMA_SLOW)
+    size_t alpha_count;   // Number of smoothing factors, 1 to HR_EMA_MAX_ALPHAS
+    bool pin;             // Pin worker w to core w modulo the online cores (Linux only)
+    const int *replay;    // Recorded heart rates shared by the patients, NULL to generate them.
+                          // Not copied, must stay valid while the engine runs.
+    size_t replay_len;    // Number of recorded heart rates
+    uint64_t seed;        // Seed of the generated heart rates, patient p uses seed + p
+} pe_config_t;
+
+typedef struct {
+    uint64_t ticks;            // Ticks run
+    uint64_t samples;          // Samples processed, over all the patients
+    uint64_t lost;             // Samples overwritten before they were folded into the EMAs
+    uint64_t steals;           // Chunks processed by a worker other than their owner
+    double seconds;            // Wall time of the run
+    double samples_per_second; // Aggregate throughput
+} pe_stats_t;
+
+/**
+ * @brief Opaque engine handle.
+ */
+typedef struct pe_engine pe_engine_t;
+
+/**
+ * @brief Create an engine and the state of its patients.
+ *
+ * @param config Engine configuration.
+ * @return pe_engine_t* Engine handle, NULL on failure.
+ */
+pe_engine_t *pe_create(const pe_config_t *config);
+
+/**
+ * @brief Destroy an engine.
+ *
+ * @param engine Engine handle, may be NULL.
+ */
+void pe_destroy(pe_engine_t *engine);
+
+/**
+ * @brief Run ticks on the worker threads, returning when they are all done. Runs continue where
+ *        the previous one stopped.
+ *
+ * @param engine Engine handle.
+ * @param ticks Number of ticks.
+ * @param stats Pointer to store the statistics of this run, may be NULL.
+ * @return int 0 on success, -1 if the worker threads could not be started.
+ */
+int pe_run(pe_engine_t *engine, uint64_t ticks, pe_stats_t *stats);
+
+/**
+ * @brief Get the number of worker threads.
+ *
+ * @param engine Engine handle.
+ * @return size_t Worker threads.
+ */
+size_t pe_workers(const pe_engine_t *engine);
+
+/**
+ * @brief Get the current EMAs of a patient, between runs.
+ *
+ * @param engine Engine handle.
+ * @param patient Patient index.
+ * @param ema Array receiving one EMA per smoothing factor.
+ * @return int 0 on success, -1 on invalid arguments or if the patient has no sample yet.
+ */
+int pe_get_ema(const pe_engine_t *engine, size_t patient, double *ema);
+
+#endif // __PATIENT_ENGINE_H__
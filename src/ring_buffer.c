@@ -1,234 +1,1881 @@
 #include "ring_buffer.h"
+#include "ring_buffer_storage.h"
+#include <errno.h>
+#include <math.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
+#define RB_CACHE_LINE 64 // Assumed cache line size, used to keep hot indices apart
+
+// RB_MODE_MPMC slot: `sequence` tells which lap of the ring the slot is ready for
+typedef struct {
+    atomic_size_t sequence;
+    int value;
+} rb_mpmc_slot_t;
+
+#ifdef __SIZEOF_INT128__
+typedef __int128 rb_wide_t; // Wide enough for exact sums of squares of any int element
+#else
+typedef int64_t rb_wide_t;
+#endif
+
+// Header of a file backed buffer, followed by the element storage at RB_FILE_DATA_OFFSET.
+// The fields are in host byte order, the file is not meant to move between machines.
+#define RB_FILE_MAGIC 0x31425248u // "HRB1"
+#define RB_FILE_VERSION 2u
+#define RB_FILE_DATA_OFFSET 128
+
+// Window indices as of one operation, the tail is derived as (head + count) % size
+typedef struct {
+    uint64_t head;
+    uint64_t count;
+    uint64_t first_seq;
+} rb_file_state_t;
+
+// The window is written to the slot not in use, then published by a single store of `commit`:
+// a crash in between leaves the previous window, committed in the other slot, intact.
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t elem_type;
+    uint32_t reserved;
+    uint64_t size;
+    uint64_t commit; // Number of windows published, the current one is in state[commit & 1]
+    rb_file_state_t state[2];
+} rb_file_header_t;
+
+_Static_assert(sizeof(rb_file_header_t) <= RB_FILE_DATA_OFFSET, "header overlaps the storage");
+
+// Monotonic deque of (sequence number, value), used for the window minimum and maximum
+typedef struct {
+    uint64_t seq;
+    int value;
+} rb_deque_entry_t;
+
+typedef struct {
+    rb_deque_entry_t *entries; // Same capacity as the ring buffer
+    size_t front;              // Index of the first entry
+    size_t len;                // Number of entries
+} rb_deque_t;
+
+#define RB_HIST_BLOCK 16 // Values per block of the percentile histogram
+
+// Count of every storable value in the window (rb_config_t::track_percentiles)
+typedef struct {
+    size_t *bins;   // Count of value `offset + i` at i, NULL when percentiles are not tracked
+    size_t *blocks; // Sum of the bins of each block of RB_HIST_BLOCK
+    size_t nbins;
+    int offset;     // Smallest storable value
+} rb_histogram_t;
+
+// Incrementally maintained window statistics (rb_config_t::track_stats)
 typedef struct {
-    int *buffer;  // Since size is not known at compile time, we need to use a pointer to allocate
-                  // memory dynamically
+    rb_wide_t sum;
+    rb_wide_t sum_sq;
+    rb_deque_t min_q; // Increasing values, the front is the window minimum
+    rb_deque_t max_q; // Decreasing values, the front is the window maximum
+    rb_histogram_t hist;
+} rb_window_stats_t;
+
+struct ring_buffer {
+    void *buffer; // Since size is not known at compile time, we need to use a pointer to allocate
+                  // memory dynamically. Elements are `elem_size` bytes wide.
+    rb_elem_t elem_type; // Storage type of the elements
+    size_t elem_size;    // Size in bytes of one stored element
     size_t size;  // Size of the buffer itself
     size_t head;  // Index of the first element
     size_t tail;  // Index of the last element
     size_t count; // Number of elements in the buffer
     bool is_full; // Flag to indicate if the buffer is full
     bool is_initialized;  // Flag to indicate if the buffer is initialized
-    pthread_mutex_t lock; // Mutex for thread safety
-} ring_buffer_t;
+    rb_mode_t mode;       // Concurrency mode
+    pthread_mutex_t lock; // Mutex for thread safety (RB_MODE_LOCKED)
+    pthread_cond_t cond;  // Signaled on adds and shutdown while `waiters` is not zero
+    unsigned waiters;     // Threads blocked in rb_wait_*, writers only signal when there are some
+    bool shutdown;        // Set by rb_shutdown_r, blocked and later waits return ECANCELED
+    atomic_uint write_seq; // Seqlock counter for rb_snapshot_r, odd while a writer is mutating
+    uint64_t first_seq;   // Sequence number (count of elements ever added) of the head element
+    bool track_stats;     // Whether `stats` is maintained
+    rb_window_stats_t stats;
+    rb_file_header_t *file_header; // Start of the file mapping for file backed buffers, or NULL
+    size_t file_len;               // Length of the file mapping
+    int file_fd;                   // Descriptor holding the file lock, while file_header is set
+    size_t mirror_len; // Length of one half of mirrored storage (rb_config_t::mirror), or 0
+#if RB_ENABLE_METRICS
+    // RB_MODE_LOCKED updates the counters under the lock. The lock-free modes only count the
+    // rare overwrites and empty reads, atomically; adds and removes derive from the indices.
+    rb_metrics_t metrics;
+#endif
+
+    // Lock-free (RB_MODE_SPSC/RB_MODE_MPMC) state. The indices are free running counters (the slot
+    // is `index & mask`), each one on its own cache line so producers and consumers do not false
+    // share.
+    size_t mask;
+    rb_mpmc_slot_t *slots; // RB_MODE_MPMC storage, used instead of buffer
+    _Alignas(RB_CACHE_LINE) atomic_size_t lf_head; // Next element to read
+    _Alignas(RB_CACHE_LINE) atomic_size_t lf_tail; // Next slot to write
+    char lf_pad[RB_CACHE_LINE - sizeof(atomic_size_t)];
+};
+
+typedef struct ring_buffer ring_buffer_t;
+
+// Default instance backing the global API
+static ring_buffer_t ring_buffer_g = { 0 };
+static uint64_t default_generation_g = 0; // Bumped on every init and free of ring_buffer_g
+
+#if RB_ENABLE_METRICS
+#define RB_METRIC_ADD(rb, field, n) ((rb)->metrics.field += (n))
+#define RB_METRIC_ADD_ATOMIC(rb, field, n)                                                         \
+    __atomic_fetch_add(&(rb)->metrics.field, (n), __ATOMIC_RELAXED)
+#else
+#define RB_METRIC_ADD(rb, field, n) ((void)0)
+#define RB_METRIC_ADD_ATOMIC(rb, field, n) ((void)0)
+#endif
+
+static size_t
+rb_elem_size(rb_elem_t elem_type) {
+    switch (elem_type) {
+    case RB_ELEM_INT32:
+        return sizeof(int32_t);
+    case RB_ELEM_INT16:
+        return sizeof(int16_t);
+    case RB_ELEM_UINT8:
+        return sizeof(uint8_t);
+    }
+    return 0;
+}
+
+/*
+ * Element access, the storage type is fixed at initialization so the switches are well predicted.
+ */
+
+// Whether value can be stored without loss
+static inline bool
+rb_elem_fits(const ring_buffer_t *rb, int value) {
+    switch (rb->elem_type) {
+    case RB_ELEM_INT16:
+        return value >= INT16_MIN && value <= INT16_MAX;
+    case RB_ELEM_UINT8:
+        return value >= 0 && value <= UINT8_MAX;
+    default:
+        return true;
+    }
+}
+
+static inline void *
+rb_elem_ptr(const ring_buffer_t *rb, size_t index) {
+    return (char *)rb->buffer + index * rb->elem_size;
+}
+
+// Wrap an index below 2 * size into the storage, cheaper than a modulo
+static inline size_t
+rb_wrap(const ring_buffer_t *rb, size_t index) {
+    return (index >= rb->size) ? index - rb->size : index;
+}
+
+static inline int
+rb_load(const ring_buffer_t *rb, size_t index) {
+    switch (rb->elem_type) {
+    case RB_ELEM_INT16:
+        return ((const int16_t *)rb->buffer)[index];
+    case RB_ELEM_UINT8:
+        return ((const uint8_t *)rb->buffer)[index];
+    default:
+        return ((const int32_t *)rb->buffer)[index];
+    }
+}
+
+static inline void
+rb_store(ring_buffer_t *rb, size_t index, int value) {
+    switch (rb->elem_type) {
+    case RB_ELEM_INT16:
+        ((int16_t *)rb->buffer)[index] = (int16_t)value;
+        break;
+    case RB_ELEM_UINT8:
+        ((uint8_t *)rb->buffer)[index] = (uint8_t)value;
+        break;
+    default:
+        ((int32_t *)rb->buffer)[index] = value;
+        break;
+    }
+}
+
+// Copy n elements into the storage starting at index, without wrapping
+static void
+rb_copy_in(ring_buffer_t *rb, size_t index, const int *src, size_t n) {
+    if (rb->elem_type == RB_ELEM_INT32) {
+        memcpy(rb_elem_ptr(rb, index), src, n * sizeof(int));
+        return;
+    }
+    for (size_t i = 0; i < n; i++)
+        rb_store(rb, index + i, src[i]);
+}
+
+// Copy n elements out of the storage starting at index, without wrapping
+static void
+rb_copy_out(const ring_buffer_t *rb, size_t index, int *dst, size_t n) {
+    if (rb->elem_type == RB_ELEM_INT32) {
+        memcpy(dst, rb_elem_ptr(rb, index), n * sizeof(int));
+        return;
+    }
+    for (size_t i = 0; i < n; i++)
+        dst[i] = rb_load(rb, index + i);
+}
+
+static size_t
+rb_round_up_pow2(size_t value) {
+    size_t pow2 = 1;
+    while (pow2 < value)
+        pow2 <<= 1;
+    return pow2;
+}
+
+/*
+ * Window statistics, maintained under the lock in RB_MODE_LOCKED when track_stats is set.
+ *
+ * Sums are exact integers, so removing an element undoes its contribution exactly. The minimum and
+ * maximum use monotonic deques: an element that can never become the extreme of the window (an
+ * older element not smaller than a newer one, for the minimum) is dropped on insertion, so the
+ * front is always the extreme and leaves the deque when its element is evicted from the buffer.
+ * Every element is pushed and popped at most once, so the cost is amortized O(1).
+ */
+
+static inline void
+rb_deque_evict(rb_deque_t *q, size_t capacity, uint64_t seq) {
+    if (q->len > 0 && q->entries[q->front].seq == seq) {
+        q->front = (q->front + 1) % capacity;
+        q->len--;
+    }
+}
+
+static inline void
+rb_deque_push(rb_deque_t *q, size_t capacity, uint64_t seq, int value, bool is_min) {
+    while (q->len > 0) {
+        int back = q->entries[(q->front + q->len - 1) % capacity].value;
+        if (is_min ? back < value : back > value)
+            break;
+        q->len--;
+    }
+    q->entries[(q->front + q->len) % capacity] = (rb_deque_entry_t){ seq, value };
+    q->len++;
+}
+
+// Account for the element at the head (sequence first_seq) leaving the window
+static inline void
+rb_stats_evict(ring_buffer_t *rb, int value, uint64_t seq) {
+    rb->stats.sum -= value;
+    rb->stats.sum_sq -= (rb_wide_t)value * value;
+    rb_deque_evict(&rb->stats.min_q, rb->size, seq);
+    rb_deque_evict(&rb->stats.max_q, rb->size, seq);
+    if (rb->stats.hist.bins) {
+        size_t bin = (size_t)(value - rb->stats.hist.offset);
+        rb->stats.hist.bins[bin]--;
+        rb->stats.hist.blocks[bin / RB_HIST_BLOCK]--;
+    }
+}
+
+// Account for a new element entering the window, evictions must be accounted first
+static inline void
+rb_stats_push(ring_buffer_t *rb, int value, uint64_t seq) {
+    rb->stats.sum += value;
+    rb->stats.sum_sq += (rb_wide_t)value * value;
+    rb_deque_push(&rb->stats.min_q, rb->size, seq, value, true);
+    rb_deque_push(&rb->stats.max_q, rb->size, seq, value, false);
+    if (rb->stats.hist.bins) {
+        size_t bin = (size_t)(value - rb->stats.hist.offset);
+        rb->stats.hist.bins[bin]++;
+        rb->stats.hist.blocks[bin / RB_HIST_BLOCK]++;
+    }
+}
+
+// Element of rank `rank` (1 based) in increasing order, rank must be within the window
+static int
+rb_hist_rank(const rb_histogram_t *hist, size_t rank) {
+    size_t block = 0, seen = 0;
+    while (seen + hist->blocks[block] < rank)
+        seen += hist->blocks[block++];
+    size_t bin = block * RB_HIST_BLOCK;
+    while (seen + hist->bins[bin] < rank)
+        seen += hist->bins[bin++];
+    return hist->offset + (int)bin;
+}
+
+/*
+ * File backed storage. The in-memory indices stay authoritative and are mirrored into the mapped
+ * header after every mutation, after the element stores, so a restarted process finds the window
+ * as of the last completed operation. Plain stores to a shared mapping need no system call; the
+ * window only becomes visible with the release store of the commit word, so a process killed
+ * halfway through an update reopens the previous window rather than a mix of both. An add that
+ * overwrites first commits the window without the elements it replaces, the slots it rewrites
+ * are then outside any committed window.
+ */
+
+static inline void
+rb_file_commit(ring_buffer_t *rb, size_t head, size_t count, uint64_t first_seq) {
+    rb_file_header_t *header = rb->file_header;
+    if (!header)
+        return;
+
+    uint64_t commit = header->commit + 1; // only this process writes, it holds the file lock
+    rb_file_state_t *state = &header->state[commit & 1];
+    state->head = head;
+    state->count = count;
+    state->first_seq = first_seq;
+    __atomic_store_n(&header->commit, commit, __ATOMIC_RELEASE);
+}
+
+static inline void
+rb_file_persist(ring_buffer_t *rb) {
+    rb_file_commit(rb, rb->head, rb->count, rb->first_seq);
+}
+
+// Before the n oldest elements are overwritten in place, commit the window without them: the
+// committed window must never cover a slot being rewritten
+static inline void
+rb_file_drop_oldest(ring_buffer_t *rb, size_t n) {
+    if (!rb->file_header || n == 0)
+        return;
+    rb_file_commit(rb, rb_wrap(rb, rb->head + n), rb->count - n, rb->first_seq + n);
+    atomic_thread_fence(memory_order_release); // the commit lands before the overwriting stores
+}
+
+// The committed window of a mapped header
+static inline const rb_file_state_t *
+rb_file_state(const rb_file_header_t *header) {
+    return &header->state[__atomic_load_n(&header->commit, __ATOMIC_ACQUIRE) & 1];
+}
+
+/**
+ * @brief Map the buffer file and validate its header.
+ *
+ * @return int 1 if the file holds a valid window to reattach to, 0 if it was (re)initialized
+ *             empty, -1 on failure.
+ */
+static int
+rb_file_open(ring_buffer_t *rb, const rb_config_t *config, size_t size, size_t elem_size) {
+    size_t len = RB_FILE_DATA_OFFSET + size * elem_size;
+    bool created = false;
+    int fd = -1;
+    rb_file_header_t *header = (rb_file_header_t *)rbs_map_file(config->path, len, &created, &fd);
+    if (!header)
+        return -1;
+
+    // Refuse to clobber a file that is not ours, or one of another geometry
+    if (!created && header->magic != 0 &&
+        (header->magic != RB_FILE_MAGIC || header->version != RB_FILE_VERSION ||
+         header->elem_type != (uint32_t)config->elem_type || header->size != size)) {
+        fprintf(stderr, "Buffer file %s does not match the buffer configuration\n", config->path);
+        rbs_unmap_file(header, len, fd);
+        return -1;
+    }
+
+    rb->file_header = header;
+    rb->file_len = len;
+    rb->file_fd = fd;
+
+    const rb_file_state_t *state = rb_file_state(header);
+    bool valid = !created && header->magic == RB_FILE_MAGIC && state->head < size &&
+                 state->count <= size;
+    if (valid)
+        return 1;
+
+    if (!created && header->magic != 0)
+        fprintf(stderr, "Buffer file %s is inconsistent, starting empty\n", config->path);
+
+    memset(header, 0, sizeof(rb_file_header_t));
+    header->version = RB_FILE_VERSION;
+    header->elem_type = (uint32_t)config->elem_type;
+    header->size = size;
+    header->magic = RB_FILE_MAGIC; // last, so a torn initialization is never taken as valid
+    return 0;
+}
+
+// Clock of the timed waits, the monotonic one where a condition variable can use it
+#ifdef __APPLE__
+#define RB_WAIT_CLOCK CLOCK_REALTIME
+#else
+#define RB_WAIT_CLOCK CLOCK_MONOTONIC
+#endif
+
+static int
+rb_cond_init(pthread_cond_t *cond) {
+#ifdef __APPLE__
+    return pthread_cond_init(cond, NULL);
+#else
+    pthread_condattr_t attr;
+    int ret = pthread_condattr_init(&attr);
+    if (ret != 0)
+        return ret;
+    ret = pthread_condattr_setclock(&attr, RB_WAIT_CLOCK);
+    if (ret == 0)
+        ret = pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+    return ret;
+#endif
+}
+
+/**
+ * @brief Initialize the instance pointed by rb, it must be zeroed.
+ *
+ * @return int 0 on success, -1 on failure (rb is left zeroed).
+ */
+static int
+rb_init_instance(ring_buffer_t *rb, const rb_config_t *config) {
+    if (config->size <= 0) {
+        fprintf(stderr, "Invalid buffer size: %d\n", config->size);
+        return -1;
+    }
+
+    if (config->mode != RB_MODE_LOCKED && config->mode != RB_MODE_SPSC &&
+        config->mode != RB_MODE_MPMC) {
+        fprintf(stderr, "Invalid buffer mode: %d\n", (int)config->mode);
+        return -1;
+    }
+
+    if (config->track_stats && config->mode != RB_MODE_LOCKED) {
+        fprintf(stderr, "Statistics are only supported in locked mode\n");
+        return -1;
+    }
+
+    size_t elem_size = rb_elem_size(config->elem_type);
+    if (elem_size == 0) {
+        fprintf(stderr, "Invalid element type: %d\n", (int)config->elem_type);
+        return -1;
+    }
+
+    if (config->path && config->mode != RB_MODE_LOCKED) {
+        fprintf(stderr, "File backed buffers are only supported in locked mode\n");
+        return -1;
+    }
+
+    if (config->mirror && (config->mode == RB_MODE_MPMC || config->path)) {
+        fprintf(stderr, "Mirrored storage is not supported with MPMC mode or a file\n");
+        return -1;
+    }
+
+    if (config->elem_type != RB_ELEM_INT32 && config->mode == RB_MODE_MPMC) {
+        fprintf(stderr, "Narrow elements are not supported in MPMC mode\n");
+        return -1;
+    }
+
+    // One bin per storable value, 256 or 65536
+    if (config->track_percentiles &&
+        (config->mode != RB_MODE_LOCKED || config->elem_type == RB_ELEM_INT32)) {
+        fprintf(stderr, "Percentiles are only supported in locked mode with narrow elements\n");
+        return -1;
+    }
+    bool track_stats = config->track_stats || config->track_percentiles;
+
+    size_t size = (size_t)config->size;
+    if (config->mode != RB_MODE_LOCKED)
+        size = rb_round_up_pow2(size);
+
+    // Each half of a mirror is a whole number of pages. The page size is a power of two, so a
+    // power of two capacity stays one.
+    size_t mirror_len = 0;
+    if (config->mirror) {
+        size_t page_size = rbs_page_size();
+        if (page_size == 0) {
+            fprintf(stderr, "Mirrored buffers are not supported on this platform\n");
+            return -1;
+        }
+        mirror_len = (size * elem_size + page_size - 1) / page_size * page_size;
+        size = mirror_len / elem_size;
+    }
+
+    int ret = pthread_mutex_init(&rb->lock, NULL);
+    if (ret != 0) {
+        fprintf(stderr, "Mutex initialization failed: %s\n", strerror(ret));
+        return -1;
+    }
+
+    ret = rb_cond_init(&rb->cond);
+    if (ret != 0) {
+        fprintf(stderr, "Condition variable initialization failed: %s\n", strerror(ret));
+        pthread_mutex_destroy(&rb->lock);
+        return -1;
+    }
+
+    void *buffer = NULL;
+    rb_mpmc_slot_t *slots = NULL;
+    int reattach = 0;
+    if (config->path) {
+        reattach = rb_file_open(rb, config, size, elem_size);
+        if (reattach < 0) {
+            pthread_cond_destroy(&rb->cond);
+            pthread_mutex_destroy(&rb->lock);
+            return -1;
+        }
+        buffer = (char *)rb->file_header + RB_FILE_DATA_OFFSET;
+    } else if (mirror_len != 0) {
+        buffer = rbs_map_mirror(mirror_len);
+    } else if (config->mode == RB_MODE_MPMC) {
+        slots = (rb_mpmc_slot_t *)malloc(size * sizeof(rb_mpmc_slot_t));
+    } else {
+        buffer = malloc(size * elem_size);
+    }
+
+    rb_deque_entry_t *min_entries = NULL;
+    rb_deque_entry_t *max_entries = NULL;
+    if (track_stats) {
+        min_entries = (rb_deque_entry_t *)malloc(size * sizeof(rb_deque_entry_t));
+        max_entries = (rb_deque_entry_t *)malloc(size * sizeof(rb_deque_entry_t));
+    }
+    size_t nbins = (config->elem_type == RB_ELEM_UINT8) ? UINT8_MAX + 1 : UINT16_MAX + 1;
+    size_t *bins = NULL;
+    if (config->track_percentiles)
+        bins = (size_t *)calloc(nbins + nbins / RB_HIST_BLOCK, sizeof(size_t));
+
+    if ((!buffer && !slots) || (track_stats && (!min_entries || !max_entries)) ||
+        (config->track_percentiles && !bins)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        if (rb->file_header)
+            rbs_unmap_file(rb->file_header, rb->file_len, rb->file_fd);
+        else if (mirror_len != 0 && buffer)
+            rbs_unmap(buffer, 2 * mirror_len);
+        else
+            free(buffer);
+        free(slots);
+        free(min_entries);
+        free(max_entries);
+        free(bins);
+        pthread_cond_destroy(&rb->cond);
+        pthread_mutex_destroy(&rb->lock);
+        memset(rb, 0, sizeof(ring_buffer_t));
+        return -1;
+    }
+
+    if (slots) {
+        // Slot i is ready to be written for position i
+        for (size_t i = 0; i < size; i++)
+            atomic_init(&slots[i].sequence, i);
+    }
+
+    rb->buffer = buffer;
+    rb->mirror_len = mirror_len;
+    rb->elem_type = config->elem_type;
+    rb->elem_size = elem_size;
+    rb->slots = slots;
+    rb->stats.min_q.entries = min_entries;
+    rb->stats.max_q.entries = max_entries;
+    if (bins) {
+        rb->stats.hist.bins = bins;
+        rb->stats.hist.blocks = bins + nbins;
+        rb->stats.hist.nbins = nbins;
+        rb->stats.hist.offset = (config->elem_type == RB_ELEM_UINT8) ? 0 : INT16_MIN;
+    }
+    rb->size = size;
+    rb->head = 0;
+    rb->tail = 0;
+    rb->count = 0;
+    rb->is_full = false;
+    rb->mode = config->mode;
+    rb->first_seq = 0;
+    rb->track_stats = track_stats;
+    rb->mask = size - 1;
+    atomic_init(&rb->lf_head, 0);
+    atomic_init(&rb->lf_tail, 0);
+
+    if (reattach) {
+        // Resume the window left by the previous process
+        const rb_file_state_t *state = rb_file_state(rb->file_header);
+        rb->head = (size_t)state->head;
+        rb->count = (size_t)state->count;
+        rb->tail = rb_wrap(rb, rb->head + rb->count);
+        rb->first_seq = state->first_seq;
+        rb->is_full = (rb->count == rb->size);
+        if (rb->track_stats) {
+            for (size_t i = 0; i < rb->count; i++)
+                rb_stats_push(rb, rb_load(rb, rb_wrap(rb, rb->head + i)), rb->first_seq + i);
+        }
+    }
+
+    rb->is_initialized = true;
+    return 0;
+}
+
+/**
+ * @brief Release the resources held by an initialized instance and zero it.
+ */
+static void
+rb_deinit_instance(ring_buffer_t *rb) {
+    int ret = pthread_mutex_lock(&rb->lock);
+    if (ret != 0) {
+        fprintf(stderr, "Mutex lock failed: %s\n", strerror(ret));
+        return;
+    }
+
+    if (rb->file_header) {
+        rbs_unmap_file(rb->file_header, rb->file_len, rb->file_fd);
+        rb->file_header = NULL;
+        rb->buffer = NULL;
+    } else if (rb->mirror_len != 0) {
+        rbs_unmap(rb->buffer, 2 * rb->mirror_len);
+        rb->buffer = NULL;
+    } else if (rb->buffer) {
+        free(rb->buffer);
+        rb->buffer = NULL;
+    }
+
+    if (rb->slots) {
+        free(rb->slots);
+        rb->slots = NULL;
+    }
+
+    free(rb->stats.min_q.entries);
+    free(rb->stats.max_q.entries);
+    free(rb->stats.hist.bins); // blocks share the allocation
+
+    ret = pthread_mutex_unlock(&rb->lock);
+    if (ret != 0)
+        fprintf(stderr, "Mutex unlock failed: %s\n", strerror(ret));
+
+    ret = pthread_cond_destroy(&rb->cond);
+    if (ret != 0)
+        fprintf(stderr, "Condition variable destroy failed: %s\n", strerror(ret));
+
+    ret = pthread_mutex_destroy(&rb->lock);
+    if (ret != 0)
+        fprintf(stderr, "Mutex destroy failed: %s\n", strerror(ret));
+
+    memset(rb, 0, sizeof(ring_buffer_t));
+}
+
+static inline bool
+rb_is_valid(const ring_buffer_t *rb) {
+    if (!rb || !rb->is_initialized) {
+        fprintf(stderr, "Buffer not initialized\n");
+        return false;
+    }
+    return true;
+}
+
+#if RB_ENABLE_METRICS
+static inline uint64_t
+rb_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+#endif
+
+/**
+ * @brief Take the buffer lock. With metrics, the wait is only timed when the lock is contended,
+ *        an uncontended acquisition costs one trylock.
+ */
+static inline int
+rb_lock(ring_buffer_t *rb) {
+#if RB_ENABLE_METRICS
+    if (pthread_mutex_trylock(&rb->lock) == 0) {
+        rb->metrics.lock_acquisitions++;
+        return 0;
+    }
+
+    uint64_t start = rb_now_ns();
+    int ret = pthread_mutex_lock(&rb->lock);
+    if (ret == 0) {
+        uint64_t wait = rb_now_ns() - start;
+        rb->metrics.lock_acquisitions++;
+        rb->metrics.lock_contended++;
+        rb->metrics.lock_wait_ns += wait;
+        if (wait > rb->metrics.lock_wait_max_ns)
+            rb->metrics.lock_wait_max_ns = wait;
+    }
+    return ret;
+#else
+    return pthread_mutex_lock(&rb->lock);
+#endif
+}
+
+/*
+ * Seqlock write side, RB_MODE_LOCKED writers bracket every change of the window (head, count and
+ * the element storage) with these, under the lock so they never race each other. Readers of
+ * rb_snapshot_r take no lock: they retry when the counter was odd or changed while they copied.
+ */
+
+static inline void
+rb_write_begin(ring_buffer_t *rb) {
+    unsigned seq = atomic_load_explicit(&rb->write_seq, memory_order_relaxed);
+    atomic_store_explicit(&rb->write_seq, seq + 1, memory_order_relaxed);
+    // Keep the stores to the window from moving above the odd counter
+    atomic_thread_fence(memory_order_release);
+}
+
+static inline void
+rb_write_end(ring_buffer_t *rb) {
+    unsigned seq = atomic_load_explicit(&rb->write_seq, memory_order_relaxed);
+    atomic_store_explicit(&rb->write_seq, seq + 1, memory_order_release);
+}
+
+/*
+ * RB_MODE_SPSC implementation.
+ *
+ * The producer owns lf_tail and the consumer owns lf_head. A slot is published by the release
+ * store of lf_tail and released back to the producer by the release update of lf_head.
+ * When the buffer is full the producer discards the oldest element by advancing lf_head with a
+ * CAS, so the consumer also advances lf_head with a CAS: a failed CAS means the slot it just read
+ * was overwritten and it retries with the new head. Slots are accessed with relaxed atomics because
+ * the consumer may read a slot the producer is overwriting (the value is then discarded).
+ */
+
+static inline int
+rb_slot_load(const ring_buffer_t *rb, size_t index) {
+    index &= rb->mask;
+    switch (rb->elem_type) {
+    case RB_ELEM_INT16:
+        return __atomic_load_n(&((const int16_t *)rb->buffer)[index], __ATOMIC_RELAXED);
+    case RB_ELEM_UINT8:
+        return __atomic_load_n(&((const uint8_t *)rb->buffer)[index], __ATOMIC_RELAXED);
+    default:
+        return __atomic_load_n(&((const int32_t *)rb->buffer)[index], __ATOMIC_RELAXED);
+    }
+}
+
+static inline void
+rb_slot_store(ring_buffer_t *rb, size_t index, int element) {
+    index &= rb->mask;
+    switch (rb->elem_type) {
+    case RB_ELEM_INT16:
+        __atomic_store_n(&((int16_t *)rb->buffer)[index], (int16_t)element, __ATOMIC_RELAXED);
+        break;
+    case RB_ELEM_UINT8:
+        __atomic_store_n(&((uint8_t *)rb->buffer)[index], (uint8_t)element, __ATOMIC_RELAXED);
+        break;
+    default:
+        __atomic_store_n(&((int32_t *)rb->buffer)[index], element, __ATOMIC_RELAXED);
+        break;
+    }
+}
+
+static void
+rb_spsc_add(ring_buffer_t *rb, int element) {
+    size_t tail = atomic_load_explicit(&rb->lf_tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&rb->lf_head, memory_order_acquire);
+
+    // Full, drop the oldest element unless the consumer beats us to it
+    while (tail - head >= rb->size) {
+        if (atomic_compare_exchange_weak_explicit(&rb->lf_head, &head, head + 1,
+                                                  memory_order_acq_rel, memory_order_acquire)) {
+            // Readers that see the new slot value must also see the head that invalidated it
+            atomic_thread_fence(memory_order_release);
+            RB_METRIC_ADD_ATOMIC(rb, overwrites, 1);
+            break;
+        }
+    }
+
+    rb_slot_store(rb, tail, element);
+    atomic_store_explicit(&rb->lf_tail, tail + 1, memory_order_release);
+}
+
+static bool
+rb_spsc_remove(ring_buffer_t *rb, int *element) {
+    size_t head = atomic_load_explicit(&rb->lf_head, memory_order_acquire);
+    for (;;) {
+        size_t tail = atomic_load_explicit(&rb->lf_tail, memory_order_acquire);
+        if (head == tail)
+            return false;
+
+        int value = rb_slot_load(rb, head);
+        if (atomic_compare_exchange_weak_explicit(&rb->lf_head, &head, head + 1,
+                                                  memory_order_acq_rel, memory_order_acquire)) {
+            if (element != NULL)
+                *element = value;
+            return true;
+        }
+        // head was reloaded by the failed CAS, the element was overwritten meanwhile
+    }
+}
+
+static size_t
+rb_lf_count(const ring_buffer_t *rb) {
+    // Load head first: tail only grows, so the difference can not underflow. It can exceed the
+    // size if a producer overwrote elements between the two loads.
+    size_t head = atomic_load_explicit(&rb->lf_head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&rb->lf_tail, memory_order_acquire);
+    size_t count = tail - head;
+    return count > rb->size ? rb->size : count;
+}
+
+/**
+ * @brief Read the element at position `index` counted from the oldest (from_tail false) or from
+ *        the newest (from_tail true) element, retrying if the producer overwrote it while reading.
+ */
+static int
+rb_spsc_peek(const ring_buffer_t *rb, size_t index, bool from_tail, int *element) {
+    for (;;) {
+        size_t head = atomic_load_explicit(&rb->lf_head, memory_order_acquire);
+        size_t tail = atomic_load_explicit(&rb->lf_tail, memory_order_acquire);
+        if (tail - head > rb->size)
+            continue; // raced with an overwrite, reload both
+
+        if (index >= tail - head)
+            return -1;
+
+        size_t position = from_tail ? tail - 1 - index : head + index;
+        int value = rb_slot_load(rb, position);
+
+        // The producer advances head past a slot before overwriting it, so the value is valid if
+        // head did not move past it while we were reading
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&rb->lf_head, memory_order_relaxed) <= position) {
+            *element = value;
+            return 0;
+        }
+    }
+}
+
+/*
+ * RB_MODE_MPMC implementation, a bounded queue with per-slot sequence numbers (D. Vyukov).
+ *
+ * Slot `pos & mask` is writable for position pos when its sequence equals pos, and readable when it
+ * equals pos + 1. Producers claim positions by CAS on lf_tail and consumers by CAS on lf_head, the
+ * slot sequence then hands the slot over with release/acquire ordering, so no locks are needed.
+ * A producer that finds the buffer full (a whole lap of unread elements between lf_head and its
+ * position) dequeues (discards) the oldest element and retries, which keeps the overwrite-oldest
+ * semantics of the locked mode.
+ */
+
+static bool
+rb_mpmc_remove(ring_buffer_t *rb, int *element) {
+    size_t pos = atomic_load_explicit(&rb->lf_head, memory_order_relaxed);
+    for (;;) {
+        rb_mpmc_slot_t *slot = &rb->slots[pos & rb->mask];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&rb->lf_head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                int value = __atomic_load_n(&slot->value, __ATOMIC_RELAXED);
+                // Hand the slot over to the producer of the next lap
+                atomic_store_explicit(&slot->sequence, pos + rb->mask + 1, memory_order_release);
+                if (element != NULL)
+                    *element = value;
+                return true;
+            }
+        } else if (diff < 0) {
+            return false; // empty, or the producer of this position did not publish yet
+        } else {
+            pos = atomic_load_explicit(&rb->lf_head, memory_order_relaxed);
+        }
+    }
+}
+
+static void
+rb_mpmc_add(ring_buffer_t *rb, int element) {
+    size_t pos = atomic_load_explicit(&rb->lf_tail, memory_order_relaxed);
+    for (;;) {
+        rb_mpmc_slot_t *slot = &rb->slots[pos & rb->mask];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&rb->lf_tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                // Release so that peeking readers that see the value also see the slot lap
+                __atomic_store_n(&slot->value, element, __ATOMIC_RELEASE);
+                atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+                return;
+            }
+        } else if (diff < 0) {
+            // The slot still holds the element of the previous lap. Only discard the oldest element
+            // if that one is unread: if a consumer already claimed it and did not hand the slot
+            // back yet, the buffer has room and the slot is about to be free.
+            size_t head = atomic_load_explicit(&rb->lf_head, memory_order_acquire);
+            if (pos - head > rb->mask && rb_mpmc_remove(rb, NULL))
+                RB_METRIC_ADD_ATOMIC(rb, overwrites, 1);
+            pos = atomic_load_explicit(&rb->lf_tail, memory_order_relaxed);
+        } else {
+            pos = atomic_load_explicit(&rb->lf_tail, memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * @brief Same as `rb_spsc_peek`, the slot sequence tells whether the value is still the one at
+ *        the requested position.
+ */
+static int
+rb_mpmc_peek(const ring_buffer_t *rb, size_t index, bool from_tail, int *element) {
+    for (;;) {
+        size_t head = atomic_load_explicit(&rb->lf_head, memory_order_acquire);
+        size_t tail = atomic_load_explicit(&rb->lf_tail, memory_order_acquire);
+        if (tail - head > rb->size)
+            continue;
+
+        if (index >= tail - head)
+            return -1;
+
+        size_t position = from_tail ? tail - 1 - index : head + index;
+        const rb_mpmc_slot_t *slot = &rb->slots[position & rb->mask];
+        if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != position + 1)
+            continue; // claimed but not published yet, or already consumed
+
+        int value = __atomic_load_n(&slot->value, __ATOMIC_RELAXED);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->sequence, memory_order_relaxed) == position + 1) {
+            *element = value;
+            return 0;
+        }
+    }
+}
+
+static int
+rb_lf_peek(const ring_buffer_t *rb, size_t index, bool from_tail, int *element) {
+    if (rb->mode == RB_MODE_MPMC)
+        return rb_mpmc_peek(rb, index, from_tail, element);
+    return rb_spsc_peek(rb, index, from_tail, element);
+}
+
+/*
+ * The instance holds cache line aligned members, so it can not come from a plain malloc.
+ */
+static ring_buffer_t *
+rb_alloc_instance(void) {
+    void *memory = NULL;
+#ifdef _WIN32
+    memory = _aligned_malloc(sizeof(ring_buffer_t), RB_CACHE_LINE);
+#else
+    if (posix_memalign(&memory, RB_CACHE_LINE, sizeof(ring_buffer_t)) != 0)
+        memory = NULL;
+#endif
+    if (memory)
+        memset(memory, 0, sizeof(ring_buffer_t));
+    return (ring_buffer_t *)memory;
+}
+
+static void
+rb_free_instance(ring_buffer_t *rb) {
+#ifdef _WIN32
+    _aligned_free(rb);
+#else
+    free(rb);
+#endif
+}
+
+rb_t *
+rb_create(int size) {
+    rb_config_t config = { .size = size, .mode = RB_MODE_LOCKED };
+    return rb_create_ex(&config);
+}
+
+rb_t *
+rb_create_ex(const rb_config_t *config) {
+    if (!config)
+        return NULL;
+
+    ring_buffer_t *rb = rb_alloc_instance();
+    if (!rb) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return NULL;
+    }
+
+    if (rb_init_instance(rb, config) != 0) {
+        rb_free_instance(rb);
+        return NULL;
+    }
+    return rb;
+}
+
+void
+rb_destroy(rb_t *rb) {
+    if (!rb)
+        return;
+
+    if (rb->is_initialized)
+        rb_deinit_instance(rb);
+    rb_free_instance(rb);
+}
+
+void
+rb_add_element_r(rb_t *rb, int element) {
+    if (!rb_is_valid(rb))
+        return;
+
+    if (!rb_elem_fits(rb, element)) {
+        fprintf(stderr, "Element out of range: %d\n", element);
+        return;
+    }
+
+    if (rb->mode == RB_MODE_SPSC) {
+        rb_spsc_add(rb, element);
+        return;
+    }
+
+    if (rb->mode == RB_MODE_MPMC) {
+        rb_mpmc_add(rb, element);
+        return;
+    }
+
+    int ret = rb_lock(rb);
+    if (ret != 0) {
+        fprintf(stderr, "Mutex lock failed: %s\n", strerror(ret));
+        return;
+    }
+
+    if (rb->track_stats) {
+        if (rb->is_full)
+            rb_stats_evict(rb, rb_load(rb, rb->head), rb->first_seq);
+        rb_stats_push(rb, element, rb->first_seq + rb->count);
+    }
+
+    if (rb->is_full)
+        rb_file_drop_oldest(rb, 1); // the tail slot is the head one
+    rb_write_begin(rb);
+    rb_store(rb, rb->tail, element);
+    rb->tail = rb_wrap(rb, rb->tail + 1);
+
+    if (rb->is_full) {
+        rb->head = rb_wrap(rb, rb->head + 1);
+        rb->first_seq++;
+        RB_METRIC_ADD(rb, overwrites, 1);
+    } else {
+        rb->count++;
+    }
+    RB_METRIC_ADD(rb, adds, 1);
+
+    rb->is_full = (rb->tail == rb->head);
+    rb_write_end(rb);
+
+    rb_file_persist(rb);
+    if (rb->waiters)
+        pthread_cond_broadcast(&rb->cond);
+
+    ret = pthread_mutex_unlock(&rb->lock);
+    if (ret != 0)
+        fprintf(stderr, "Mutex unlock failed: %s\n", strerror(ret));
+}
+
+bool
+rb_remove_element_r(rb_t *rb, int *element) {
+    if (!rb_is_valid(rb))
+        return false;
+
+    // Polling an empty lock-free buffer is the normal consumer pattern, so no error log
+    if (rb->mode != RB_MODE_LOCKED) {
+        bool removed = (rb->mode == RB_MODE_SPSC) ? rb_spsc_remove(rb, element)
+                                                  : rb_mpmc_remove(rb, element);
+        if (!removed)
+            RB_METRIC_ADD_ATOMIC(rb, empty_reads, 1);
+        return removed;
+    }
+
+    int ret = rb_lock(rb);
+    if (ret != 0) {
+        fprintf(stderr, "Mutex lock failed: %s\n", strerror(ret));
+        return false;
+    }
+
+    if (rb->count == 0) {
+        RB_METRIC_ADD(rb, empty_reads, 1);
+        pthread_mutex_unlock(&rb->lock);
+        fprintf(stderr, "Buffer is empty\n");
+        return false;
+    }
+
+    if (element != NULL)
+        *element = rb_load(rb, rb->head);
+    if (rb->track_stats)
+        rb_stats_evict(rb, rb_load(rb, rb->head), rb->first_seq);
+    rb_write_begin(rb);
+    rb->head = rb_wrap(rb, rb->head + 1);
+    rb->first_seq++;
+    rb->count--;
+    rb->is_full = false;
+    rb_write_end(rb);
+    RB_METRIC_ADD(rb, removes, 1);
+
+    rb_file_persist(rb);
+
+    ret = pthread_mutex_unlock(&rb->lock);
+    if (ret != 0)
+        fprintf(stderr, "Mutex unlock failed: %s\n", strerror(ret));
+
+    return true;
+}
+
+bool
+rb_is_full_r(rb_t *rb) {
+    if (!rb_is_valid(rb))
+        return false;
+
+    if (rb->mode != RB_MODE_LOCKED)
+        return rb_lf_count(rb) == rb->size;
+
+    rb_lock(rb);
+
+    bool is_full = rb->is_full;
+
+    pthread_mutex_unlock(&rb->lock);
+    return is_full;
+}
+
+bool
+rb_is_empty_r(rb_t *rb) {
+    if (!rb_is_valid(rb))
+        return false;
+
+    if (rb->mode != RB_MODE_LOCKED)
+        return rb_lf_count(rb) == 0;
+
+    rb_lock(rb);
+
+    bool is_empty = (!rb->is_full && (rb->head == rb->tail));
+
+    pthread_mutex_unlock(&rb->lock);
+    return is_empty;
+}
+
+int
+rb_get_element_at_r(rb_t *rb, int index, int *element) {
+    if (!rb_is_valid(rb))
+        return -1;
+
+    if (!element)
+        return -1;
+
+    if (rb->mode != RB_MODE_LOCKED) {
+        int ret = (index < 0) ? -1 : rb_lf_peek(rb, (size_t)index, false, element);
+        if (ret != 0) {
+            fprintf(stderr, "Index out of bounds: %d\n", index);
+            return -1;
+        }
+        return 0;
+    }
+
+    rb_lock(rb);
+
+    if (index < 0 || (size_t)index >= rb->count) {
+        pthread_mutex_unlock(&rb->lock);
+        fprintf(stderr, "Index out of bounds: %d\n", index);
+        return -1;
+    }
+
+    // A mirrored storage is readable past its end, no wrap needed
+    size_t actual_index = rb->mirror_len ? rb->head + index : rb_wrap(rb, rb->head + index);
+    *element = rb_load(rb, actual_index);
+
+    pthread_mutex_unlock(&rb->lock);
+    return 0;
+}
+
+int
+rb_get_last_element_r(rb_t *rb, int *element) {
+    if (!rb_is_valid(rb))
+        return -1;
+
+    if (!element)
+        return -1;
+
+    if (rb->mode != RB_MODE_LOCKED) {
+        if (rb_lf_peek(rb, 0, true, element) != 0) {
+            RB_METRIC_ADD_ATOMIC(rb, empty_reads, 1);
+            fprintf(stderr, "Buffer is empty\n");
+            return -1;
+        }
+        return 0;
+    }
+
+    rb_lock(rb);
+
+    if (rb->count == 0) {
+        RB_METRIC_ADD(rb, empty_reads, 1);
+        fprintf(stderr, "Buffer is empty\n");
+        pthread_mutex_unlock(&rb->lock);
+        return -1;
+    }
+
+    size_t last_index = (rb->tail == 0) ? (rb->size - 1) : (rb->tail - 1);
+    *element = rb_load(rb, last_index);
+
+    pthread_mutex_unlock(&rb->lock);
+    return 0;
+}
+
+size_t
+rb_count_r(rb_t *rb) {
+    if (!rb_is_valid(rb))
+        return 0;
+
+    if (rb->mode != RB_MODE_LOCKED)
+        return rb_lf_count(rb);
+
+    rb_lock(rb);
 
-static ring_buffer_t ring_buffer_g = { 0 };
+    size_t count = rb->count;
 
-void
-rb_init_buffer(int size) {
-    if (ring_buffer_g.is_initialized) {
-        fprintf(stderr, "Buffer already initialized\n");
-        return;
+    pthread_mutex_unlock(&rb->lock);
+    return count;
+}
+
+size_t
+rb_size_r(rb_t *rb) {
+    if (!rb_is_valid(rb))
+        return 0;
+
+    // size is immutable after initialization, no need to lock
+    return rb->size;
+}
+
+size_t
+rb_add_elements_r(rb_t *rb, const int *elements, size_t n) {
+    if (!rb_is_valid(rb))
+        return 0;
+
+    if (!elements || n == 0)
+        return 0;
+
+    // All or nothing, a batch with an element the storage can not hold is rejected
+    if (rb->elem_type != RB_ELEM_INT32) {
+        for (size_t i = 0; i < n; i++) {
+            if (!rb_elem_fits(rb, elements[i])) {
+                fprintf(stderr, "Element out of range: %d\n", elements[i]);
+                return 0;
+            }
+        }
     }
 
-    int ret = pthread_mutex_init(&ring_buffer_g.lock, NULL);
-    if (ret != 0) {
-        fprintf(stderr, "Mutex initialization failed: %s\n", strerror(ret));
-        exit(EXIT_FAILURE);
+    if (rb->mode != RB_MODE_LOCKED) {
+        for (size_t i = 0; i < n; i++)
+            rb_add_element_r(rb, elements[i]);
+        return n;
     }
 
-    ret = pthread_mutex_lock(&ring_buffer_g.lock);
+    int ret = rb_lock(rb);
     if (ret != 0) {
         fprintf(stderr, "Mutex lock failed: %s\n", strerror(ret));
-        pthread_mutex_destroy(&ring_buffer_g.lock);
-        exit(EXIT_FAILURE);
+        return 0;
     }
 
-    ring_buffer_g.buffer = (int *)malloc(size * sizeof(int));
-    if (!ring_buffer_g.buffer) {
-        fprintf(stderr, "Memory allocation failed\n");
-        pthread_mutex_unlock(&ring_buffer_g.lock);
-        pthread_mutex_destroy(&ring_buffer_g.lock);
-        exit(EXIT_FAILURE);
+    // Only the newest `size` elements would survive, skip the ones that would be overwritten
+    const int *src = elements;
+    size_t remaining = n;
+    if (remaining > rb->size) {
+        src += remaining - rb->size;
+        remaining = rb->size;
     }
+    size_t skipped = n - remaining;
 
-    ring_buffer_g.size = size;
-    ring_buffer_g.head = 0;
-    ring_buffer_g.tail = 0;
-    ring_buffer_g.is_full = false;
-    ring_buffer_g.is_initialized = true;
+    size_t overwritten = (rb->count + remaining > rb->size) ? rb->count + remaining - rb->size : 0;
 
-    ret = pthread_mutex_unlock(&ring_buffer_g.lock);
-    if (ret != 0) {
-        fprintf(stderr, "Mutex unlock failed: %s\n", strerror(ret));
-        pthread_mutex_destroy(&ring_buffer_g.lock);
-        exit(EXIT_FAILURE);
+    if (rb->track_stats) {
+        for (size_t i = 0; i < overwritten; i++)
+            rb_stats_evict(rb, rb_load(rb, rb_wrap(rb, rb->head + i)), rb->first_seq + i);
+        uint64_t seq = rb->first_seq + rb->count + skipped;
+        for (size_t i = 0; i < remaining; i++)
+            rb_stats_push(rb, src[i], seq + i);
     }
+
+    // Copy in at most two chunks: up to the end of the storage, then from its start. A mirrored
+    // storage takes the whole batch in one chunk.
+    size_t first = rb->mirror_len ? remaining : rb->size - rb->tail;
+    if (first > remaining)
+        first = remaining;
+    rb_file_drop_oldest(rb, overwritten);
+    rb_write_begin(rb);
+    rb_copy_in(rb, rb->tail, src, first);
+    rb_copy_in(rb, 0, src + first, remaining - first);
+
+    rb->tail = rb_wrap(rb, rb->tail + remaining);
+    rb->count += remaining - overwritten;
+    rb->head = rb_wrap(rb, rb->head + overwritten);
+    rb->first_seq += overwritten + skipped;
+    rb->is_full = (rb->count == rb->size);
+    rb_write_end(rb);
+    RB_METRIC_ADD(rb, adds, n);
+    RB_METRIC_ADD(rb, overwrites, overwritten + skipped);
+
+    rb_file_persist(rb);
+    if (rb->waiters)
+        pthread_cond_broadcast(&rb->cond);
+
+    ret = pthread_mutex_unlock(&rb->lock);
+    if (ret != 0)
+        fprintf(stderr, "Mutex unlock failed: %s\n", strerror(ret));
+
+    return n;
 }
 
-void
-rb_add_element(int element) {
-    if (!ring_buffer_g.is_initialized) {
-        fprintf(stderr, "Buffer not initialized\n");
-        return;
+size_t
+rb_remove_elements_r(rb_t *rb, int *elements, size_t n) {
+    if (!rb_is_valid(rb))
+        return 0;
+
+    if (rb->mode != RB_MODE_LOCKED) {
+        size_t removed = 0;
+        while (removed < n && rb_remove_element_r(rb, elements ? &elements[removed] : NULL))
+            removed++;
+        return removed;
     }
 
-    int ret = pthread_mutex_lock(&ring_buffer_g.lock);
+    int ret = rb_lock(rb);
     if (ret != 0) {
         fprintf(stderr, "Mutex lock failed: %s\n", strerror(ret));
-        return;
+        return 0;
+    }
+
+    size_t removed = (n < rb->count) ? n : rb->count;
+    if (elements != NULL) {
+        size_t first = rb->mirror_len ? removed : rb->size - rb->head;
+        if (first > removed)
+            first = removed;
+        rb_copy_out(rb, rb->head, elements, first);
+        rb_copy_out(rb, 0, elements + first, removed - first);
     }
 
-    ring_buffer_g.buffer[ring_buffer_g.tail] = element;
-    ring_buffer_g.tail = (ring_buffer_g.tail + 1) % ring_buffer_g.size;
+    if (rb->track_stats) {
+        for (size_t i = 0; i < removed; i++)
+            rb_stats_evict(rb, rb_load(rb, rb_wrap(rb, rb->head + i)), rb->first_seq + i);
+    }
 
-    if (ring_buffer_g.is_full)
-        ring_buffer_g.head = (ring_buffer_g.head + 1) % ring_buffer_g.size;
-    else
-        ring_buffer_g.count++;
+    rb_write_begin(rb);
+    rb->head = rb_wrap(rb, rb->head + removed);
+    rb->first_seq += removed;
+    rb->count -= removed;
+    rb->is_full = (rb->count == rb->size);
+    rb_write_end(rb);
+    RB_METRIC_ADD(rb, removes, removed);
 
-    ring_buffer_g.is_full = (ring_buffer_g.tail == ring_buffer_g.head);
+    rb_file_persist(rb);
 
-    ret = pthread_mutex_unlock(&ring_buffer_g.lock);
+    ret = pthread_mutex_unlock(&rb->lock);
     if (ret != 0)
         fprintf(stderr, "Mutex unlock failed: %s\n", strerror(ret));
+
+    return removed;
 }
 
-bool
-rb_remove_element(int *element) {
-    if (!ring_buffer_g.is_initialized) {
-        fprintf(stderr, "Buffer not initialized\n");
-        return false;
+int
+rb_peek_r(rb_t *rb, rb_span_t spans[2]) {
+    if (!rb_is_valid(rb))
+        return -1;
+
+    if (!spans)
+        return -1;
+
+    if (rb->mode != RB_MODE_LOCKED) {
+        fprintf(stderr, "Peek is only supported in locked mode\n");
+        return -1;
     }
 
-    int ret = pthread_mutex_lock(&ring_buffer_g.lock);
+    int ret = rb_lock(rb);
     if (ret != 0) {
         fprintf(stderr, "Mutex lock failed: %s\n", strerror(ret));
-        return false;
+        return -1;
     }
 
-    if (ring_buffer_g.count == 0) {
-        pthread_mutex_unlock(&ring_buffer_g.lock);
-        fprintf(stderr, "Buffer is empty\n");
-        return false;
+    spans[0] = (rb_span_t){ NULL, 0 };
+    spans[1] = (rb_span_t){ NULL, 0 };
+    if (rb->count == 0)
+        return 0;
+
+    size_t first = rb->mirror_len ? rb->count : rb->size - rb->head;
+    if (first >= rb->count) {
+        spans[0] = (rb_span_t){ rb_elem_ptr(rb, rb->head), rb->count };
+        return 1;
     }
 
-    if (element != NULL)
-        *element = ring_buffer_g.buffer[ring_buffer_g.head];
-    ring_buffer_g.head = (ring_buffer_g.head + 1) % ring_buffer_g.size;
-    ring_buffer_g.count--;
-    ring_buffer_g.is_full = false;
+    spans[0] = (rb_span_t){ rb_elem_ptr(rb, rb->head), first };
+    spans[1] = (rb_span_t){ rb->buffer, rb->count - first };
+    return 2;
+}
 
-    ret = pthread_mutex_unlock(&ring_buffer_g.lock);
+void
+rb_peek_done_r(rb_t *rb) {
+    if (!rb_is_valid(rb))
+        return;
+
+    int ret = pthread_mutex_unlock(&rb->lock);
     if (ret != 0)
         fprintf(stderr, "Mutex unlock failed: %s\n", strerror(ret));
+}
 
-    return true;
+size_t
+rb_snapshot_r(rb_t *rb, int *out, size_t max) {
+    if (!rb_is_valid(rb))
+        return 0;
+
+    if (!out || max == 0)
+        return 0;
+
+    if (rb->mode != RB_MODE_LOCKED) {
+        fprintf(stderr, "Snapshot is only supported in locked mode\n");
+        return 0;
+    }
+
+    for (unsigned attempt = 1;; attempt++) {
+        unsigned begin = atomic_load_explicit(&rb->write_seq, memory_order_acquire);
+        if ((begin & 1) == 0) {
+            // head and count may be mid-update, but each is a value a writer stored so the
+            // indices stay within the storage; a mismatched pair is caught by the check below
+            size_t head = __atomic_load_n(&rb->head, __ATOMIC_RELAXED);
+            size_t count = __atomic_load_n(&rb->count, __ATOMIC_RELAXED);
+            size_t n = (count < max) ? count : max;
+            size_t start = rb_wrap(rb, head + count - n);
+
+            size_t first = rb->mirror_len ? n : rb->size - start;
+            if (first > n)
+                first = n;
+            rb_copy_out(rb, start, out, first);
+            rb_copy_out(rb, 0, out + first, n - first);
+
+            // The copy must complete before the counter is checked again
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&rb->write_seq, memory_order_relaxed) == begin)
+                return n;
+        }
+
+        // A writer holding the lock may have been preempted mid-write, let it run
+        if (attempt % 64 == 0)
+            sched_yield();
+    }
 }
 
-bool
-rb_is_full() {
-    if (!ring_buffer_g.is_initialized) {
-        fprintf(stderr, "Buffer not initialized\n");
-        return false;
+/**
+ * @brief Wait with the lock held until the buffer holds at least n elements, the timeout expires
+ *        or the buffer is shut down.
+ *
+ * @return int 0 when the count is reached, ETIMEDOUT, ECANCELED, or the error of a failed
+ *             condition variable wait.
+ */
+static int
+rb_wait_locked(ring_buffer_t *rb, size_t n, int timeout_ms) {
+    struct timespec deadline;
+    if (timeout_ms > 0) {
+        clock_gettime(RB_WAIT_CLOCK, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
     }
-    pthread_mutex_lock(&ring_buffer_g.lock);
 
-    bool is_full = ring_buffer_g.is_full;
+    int ret = 0;
+    rb->waiters++;
+    while (rb->count < n && !rb->shutdown && ret == 0) {
+        if (timeout_ms == 0)
+            ret = ETIMEDOUT;
+        else if (timeout_ms < 0)
+            ret = pthread_cond_wait(&rb->cond, &rb->lock);
+        else
+            ret = pthread_cond_timedwait(&rb->cond, &rb->lock, &deadline);
+    }
+    rb->waiters--;
 
-    pthread_mutex_unlock(&ring_buffer_g.lock);
-    return is_full;
+    // The count wins over a timeout or a shutdown that raced with the last add
+    if (rb->count >= n)
+        return 0;
+    if (rb->shutdown)
+        return ECANCELED;
+    if (ret != 0 && ret != ETIMEDOUT) {
+        fprintf(stderr, "Condition variable wait failed: %s\n", strerror(ret));
+        return ret;
+    }
+    return ETIMEDOUT;
 }
 
-bool
-rb_is_empty() {
-    if (!ring_buffer_g.is_initialized) {
-        fprintf(stderr, "Buffer not initialized\n");
-        return false;
+int
+rb_wait_remove_r(rb_t *rb, int *element, int timeout_ms) {
+    if (!rb_is_valid(rb))
+        return EINVAL;
+
+    if (rb->mode != RB_MODE_LOCKED) {
+        fprintf(stderr, "Blocking waits are only supported in locked mode\n");
+        return EINVAL;
     }
 
-    pthread_mutex_lock(&ring_buffer_g.lock);
+    int ret = rb_lock(rb);
+    if (ret != 0) {
+        fprintf(stderr, "Mutex lock failed: %s\n", strerror(ret));
+        return ret;
+    }
 
-    bool is_empty = (!ring_buffer_g.is_full && (ring_buffer_g.head == ring_buffer_g.tail));
+    ret = rb_wait_locked(rb, 1, timeout_ms);
+    if (ret == 0) {
+        if (element != NULL)
+            *element = rb_load(rb, rb->head);
+        if (rb->track_stats)
+            rb_stats_evict(rb, rb_load(rb, rb->head), rb->first_seq);
+        rb_write_begin(rb);
+        rb->head = rb_wrap(rb, rb->head + 1);
+        rb->first_seq++;
+        rb->count--;
+        rb->is_full = false;
+        rb_write_end(rb);
+        RB_METRIC_ADD(rb, removes, 1);
+        rb_file_persist(rb);
+    }
 
-    pthread_mutex_unlock(&ring_buffer_g.lock);
-    return is_empty;
+    pthread_mutex_unlock(&rb->lock);
+    return ret;
+}
+
+int
+rb_wait_for_count_r(rb_t *rb, size_t n, int timeout_ms) {
+    if (!rb_is_valid(rb))
+        return EINVAL;
+
+    if (rb->mode != RB_MODE_LOCKED) {
+        fprintf(stderr, "Blocking waits are only supported in locked mode\n");
+        return EINVAL;
+    }
+
+    if (n > rb->size) {
+        fprintf(stderr, "Count out of bounds: %zu\n", n);
+        return EINVAL;
+    }
+
+    int ret = rb_lock(rb);
+    if (ret != 0) {
+        fprintf(stderr, "Mutex lock failed: %s\n", strerror(ret));
+        return ret;
+    }
+
+    ret = rb_wait_locked(rb, n, timeout_ms);
+
+    pthread_mutex_unlock(&rb->lock);
+    return ret;
 }
 
 void
-rb_free_buffer() {
-    if (!ring_buffer_g.is_initialized) {
-        fprintf(stderr, "Buffer not initialized\n");
+rb_shutdown_r(rb_t *rb) {
+    if (!rb_is_valid(rb))
         return;
-    }
 
-    int ret = pthread_mutex_lock(&ring_buffer_g.lock);
+    int ret = rb_lock(rb);
     if (ret != 0) {
         fprintf(stderr, "Mutex lock failed: %s\n", strerror(ret));
         return;
     }
 
-    if (ring_buffer_g.buffer) {
-        free(ring_buffer_g.buffer);
-        ring_buffer_g.buffer = NULL;
+    rb->shutdown = true;
+    pthread_cond_broadcast(&rb->cond);
+
+    pthread_mutex_unlock(&rb->lock);
+}
+
+size_t
+rb_consume_since_r(rb_t *rb, uint64_t *cursor, rb_consume_fn_t fn, void *arg, uint64_t *lost) {
+    if (lost)
+        *lost = 0;
+
+    if (!rb_is_valid(rb))
+        return 0;
+
+    if (!cursor || !fn)
+        return 0;
+
+    if (rb->mode != RB_MODE_LOCKED) {
+        fprintf(stderr, "Consume is only supported in locked mode\n");
+        return 0;
     }
 
-    ret = pthread_mutex_unlock(&ring_buffer_g.lock);
-    if (ret != 0)
-        fprintf(stderr, "Mutex unlock failed: %s\n", strerror(ret));
+    int ret = rb_lock(rb);
+    if (ret != 0) {
+        fprintf(stderr, "Mutex lock failed: %s\n", strerror(ret));
+        return 0;
+    }
 
-    ret = pthread_mutex_destroy(&ring_buffer_g.lock);
-    if (ret != 0)
-        fprintf(stderr, "Mutex destroy failed: %s\n", strerror(ret));
+    uint64_t next_seq = rb->first_seq + rb->count;
+    uint64_t from = *cursor;
+    if (from > next_seq) {
+        from = rb->first_seq; // a cursor of a previous life of the buffer
+    } else if (from < rb->first_seq) {
+        if (lost)
+            *lost = rb->first_seq - from;
+        from = rb->first_seq;
+    }
 
-    memset(&ring_buffer_g, 0, sizeof(ring_buffer_t));
-}
+    // Elements are converted to int in chunks on the stack, whatever their storage type
+    int chunk[256];
+    size_t offset = (size_t)(from - rb->first_seq);
+    size_t consumed = 0;
+    while (offset < rb->count) {
+        size_t index = rb_wrap(rb, rb->head + offset);
+        size_t n = rb->count - offset;
+        if (n > sizeof(chunk) / sizeof(chunk[0]))
+            n = sizeof(chunk) / sizeof(chunk[0]);
+        if (!rb->mirror_len && n > rb->size - index)
+            n = rb->size - index;
 
-bool
-rb_is_initialized() {
-    // no need to lock since this is a read-only operation
-    return ring_buffer_g.is_initialized;
+        rb_copy_out(rb, index, chunk, n);
+        fn(chunk, n, arg);
+        offset += n;
+        consumed += n;
+    }
+    *cursor = next_seq;
+
+    pthread_mutex_unlock(&rb->lock);
+    return consumed;
 }
 
 int
-rb_get_element_at(int index, int *element) {
-    if (!ring_buffer_g.is_initialized) {
-        fprintf(stderr, "Buffer not initialized\n");
+rb_get_stats_r(rb_t *rb, rb_stats_t *stats) {
+    if (!rb_is_valid(rb))
         return -1;
-    }
 
-    if (!element)
+    if (!stats || !rb->track_stats)
         return -1;
 
-    if (index < 0 || (size_t)index >= ring_buffer_g.count) {
-        fprintf(stderr, "Index out of bounds: %d\n", index);
+    int ret = rb_lock(rb);
+    if (ret != 0) {
+        fprintf(stderr, "Mutex lock failed: %s\n", strerror(ret));
+        return -1;
+    }
+
+    if (rb->count == 0) {
+        pthread_mutex_unlock(&rb->lock);
         return -1;
     }
 
-    pthread_mutex_lock(&ring_buffer_g.lock);
+    size_t count = rb->count;
+    rb_wide_t sum = rb->stats.sum;
+    rb_wide_t sum_sq = rb->stats.sum_sq;
+    stats->min = rb->stats.min_q.entries[rb->stats.min_q.front].value;
+    stats->max = rb->stats.max_q.entries[rb->stats.max_q.front].value;
 
-    int actual_index = (ring_buffer_g.head + index) % ring_buffer_g.size;
-    *element = ring_buffer_g.buffer[actual_index];
+    pthread_mutex_unlock(&rb->lock);
 
-    pthread_mutex_unlock(&ring_buffer_g.lock);
+    // Population variance from exact sums: (n * sum(x^2) - sum(x)^2) / n^2
+    stats->count = count;
+    stats->sum = (int64_t)sum;
+    stats->mean = (double)sum / (double)count;
+    stats->variance =
+        (double)((rb_wide_t)count * sum_sq - sum * sum) / ((double)count * (double)count);
+    stats->stddev = sqrt(stats->variance);
     return 0;
 }
 
 int
-rb_get_last_element(int *element) {
-    if (!ring_buffer_g.is_initialized) {
-        fprintf(stderr, "Buffer not initialized\n");
+rb_percentiles_r(rb_t *rb, const double *p, int *values, size_t n) {
+    if (!rb_is_valid(rb))
         return -1;
+
+    if (!p || !values || !rb->stats.hist.bins)
+        return -1;
+    for (size_t i = 0; i < n; i++) {
+        if (!(p[i] >= 0.0 && p[i] <= 100.0))
+            return -1;
     }
 
-    if (!element)
+    int ret = rb_lock(rb);
+    if (ret != 0) {
+        fprintf(stderr, "Mutex lock failed: %s\n", strerror(ret));
+        return -1;
+    }
+
+    if (rb->count == 0) {
+        pthread_mutex_unlock(&rb->lock);
         return -1;
+    }
 
-    pthread_mutex_lock(&ring_buffer_g.lock);
+    // Nearest rank: ceil(p / 100 * count), at least the first element
+    for (size_t i = 0; i < n; i++) {
+        size_t rank = (size_t)ceil(p[i] / 100.0 * (double)rb->count);
+        rank = (rank == 0) ? 1 : (rank > rb->count) ? rb->count : rank;
+        values[i] = rb_hist_rank(&rb->stats.hist, rank);
+    }
 
-    if (ring_buffer_g.count == 0) {
-        fprintf(stderr, "Buffer is empty\n");
-        pthread_mutex_unlock(&ring_buffer_g.lock);
+    pthread_mutex_unlock(&rb->lock);
+    return 0;
+}
+
+int
+rb_percentile_r(rb_t *rb, double p, int *value) {
+    return rb_percentiles_r(rb, &p, value, 1);
+}
+
+int
+rb_sync_r(rb_t *rb) {
+    if (!rb_is_valid(rb))
+        return -1;
+
+    if (!rb->file_header)
+        return 0;
+
+    rb_lock(rb);
+
+    int ret = rbs_sync_file(rb->file_header, rb->file_len);
+
+    pthread_mutex_unlock(&rb->lock);
+    return ret;
+}
+
+int
+rb_get_metrics_r(rb_t *rb, rb_metrics_t *metrics) {
+    if (!rb_is_valid(rb))
+        return -1;
+
+    if (!metrics)
+        return -1;
+
+#if RB_ENABLE_METRICS
+    if (rb->mode != RB_MODE_LOCKED) {
+        memset(metrics, 0, sizeof(rb_metrics_t));
+        metrics->overwrites = __atomic_load_n(&rb->metrics.overwrites, __ATOMIC_RELAXED);
+        metrics->empty_reads = __atomic_load_n(&rb->metrics.empty_reads, __ATOMIC_RELAXED);
+        // Every position below lf_tail was added, and every one below lf_head left the buffer,
+        // either removed or overwritten
+        metrics->adds = atomic_load_explicit(&rb->lf_tail, memory_order_acquire);
+        size_t left = atomic_load_explicit(&rb->lf_head, memory_order_acquire);
+        metrics->removes = (left > metrics->overwrites) ? left - metrics->overwrites : 0;
+        return 0;
+    }
+
+    // Not rb_lock, reading the metrics should not count as a use of the buffer
+    int ret = pthread_mutex_lock(&rb->lock);
+    if (ret != 0) {
+        fprintf(stderr, "Mutex lock failed: %s\n", strerror(ret));
         return -1;
     }
 
-    int last_index =
-        (ring_buffer_g.tail == 0) ? (ring_buffer_g.size - 1) : (ring_buffer_g.tail - 1);
-    *element = ring_buffer_g.buffer[last_index];
+    *metrics = rb->metrics;
 
-    pthread_mutex_unlock(&ring_buffer_g.lock);
+    pthread_mutex_unlock(&rb->lock);
     return 0;
+#else
+    fprintf(stderr, "Metrics are compiled out (RB_ENABLE_METRICS)\n");
+    return -1;
+#endif
+}
+
+rb_t *
+rb_default(void) {
+    return ring_buffer_g.is_initialized ? &ring_buffer_g : NULL;
+}
+
+uint64_t
+rb_default_generation(void) {
+    return default_generation_g;
+}
+
+/* Global API, kept for compatibility, forwards to the default instance */
+
+void
+rb_init_buffer(int size) {
+    rb_config_t config = { .size = size, .mode = RB_MODE_LOCKED };
+    rb_init_buffer_ex(&config);
+}
+
+void
+rb_init_buffer_ex(const rb_config_t *config) {
+    if (ring_buffer_g.is_initialized) {
+        fprintf(stderr, "Buffer already initialized\n");
+        return;
+    }
+
+    if (!config || rb_init_instance(&ring_buffer_g, config) != 0)
+        exit(EXIT_FAILURE);
+    default_generation_g++;
+}
+
+void
+rb_add_element(int element) {
+    rb_add_element_r(&ring_buffer_g, element);
+}
+
+bool
+rb_remove_element(int *element) {
+    return rb_remove_element_r(&ring_buffer_g, element);
+}
+
+bool
+rb_is_full() {
+    return rb_is_full_r(&ring_buffer_g);
+}
+
+bool
+rb_is_empty() {
+    return rb_is_empty_r(&ring_buffer_g);
+}
+
+void
+rb_free_buffer() {
+    if (!rb_is_valid(&ring_buffer_g))
+        return;
+
+    rb_deinit_instance(&ring_buffer_g);
+    default_generation_g++;
+}
+
+bool
+rb_is_initialized() {
+    // no need to lock since this is a read-only operation
+    return ring_buffer_g.is_initialized;
+}
+
+int
+rb_get_element_at(int index, int *element) {
+    return rb_get_element_at_r(&ring_buffer_g, index, element);
+}
+
+int
+rb_get_last_element(int *element) {
+    return rb_get_last_element_r(&ring_buffer_g, element);
+}
+
+size_t
+rb_add_elements(const int *elements, size_t n) {
+    return rb_add_elements_r(&ring_buffer_g, elements, n);
+}
+
+size_t
+rb_remove_elements(int *elements, size_t n) {
+    return rb_remove_elements_r(&ring_buffer_g, elements, n);
+}
+
+int
+rb_peek(rb_span_t spans[2]) {
+    return rb_peek_r(&ring_buffer_g, spans);
+}
+
+void
+rb_peek_done() {
+    rb_peek_done_r(&ring_buffer_g);
+}
+
+int
+rb_get_stats(rb_stats_t *stats) {
+    return rb_get_stats_r(&ring_buffer_g, stats);
+}
+
+int
+rb_percentile(double p, int *value) {
+    return rb_percentile_r(&ring_buffer_g, p, value);
+}
+
+int
+rb_get_metrics(rb_metrics_t *metrics) {
+    return rb_get_metrics_r(&ring_buffer_g, metrics);
+}
+
+size_t
+rb_consume_since(uint64_t *cursor, rb_consume_fn_t fn, void *arg, uint64_t *lost) {
+    return rb_consume_since_r(&ring_buffer_g, cursor, fn, arg, lost);
+}
+
+int
+rb_wait_remove(int *element, int timeout_ms) {
+    return rb_wait_remove_r(&ring_buffer_g, element, timeout_ms);
+}
+
+int
+rb_wait_for_count(size_t n, int timeout_ms) {
+    return rb_wait_for_count_r(&ring_buffer_g, n, timeout_ms);
+}
+
+void
+rb_shutdown(void) {
+    rb_shutdown_r(&ring_buffer_g);
+}
+
+size_t
+rb_snapshot(int *out, size_t max) {
+    return rb_snapshot_r(&ring_buffer_g, out, max);
 }
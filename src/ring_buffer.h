@@ -14,9 +14,413 @@ Your task is to implement a circular buffer in C with the following functionalit
 this module would be prefixed with `rb_`.
 this data structure is thread-safe.
 
+Two flavours of the API are provided:
+* the handle API (`rb_create`/`rb_destroy` and the `_r` suffixed functions) works on any number of
+  independent `rb_t` instances, so many streams can live in one process.
+* the original global API (`rb_init_buffer`, `rb_add_element`, ...) is a thin compatibility layer
+  over a single default instance.
+
 */
 #include <pthread.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Per buffer metrics (rb_get_metrics_r). Build with -DRB_ENABLE_METRICS=0 to compile them out of
+// the hot paths entirely.
+#ifndef RB_ENABLE_METRICS
+#define RB_ENABLE_METRICS 1
+#endif
+
+/**
+ * @brief Opaque ring buffer handle.
+ */
+typedef struct ring_buffer rb_t;
+
+/**
+ * @brief Concurrency mode of a ring buffer, selected at creation time.
+ */
+typedef enum {
+    RB_MODE_LOCKED = 0, // Mutex protected, any number of producers and consumers (default)
+    RB_MODE_SPSC,       // Lock-free, exactly one producer thread and one consumer thread.
+                        // The capacity is rounded up to a power of two.
+    RB_MODE_MPMC,       // Lock-free, any number of producers and consumers (per-slot sequence
+                        // numbers). The capacity is rounded up to a power of two.
+} rb_mode_t;
+
+/**
+ * @brief Storage type of the elements, selected at creation time.
+ *        The API always exchanges `int` values, narrow types only reduce the memory footprint.
+ *        Adding a value that does not fit the storage type is rejected.
+ */
+typedef enum {
+    RB_ELEM_INT32 = 0, // 4 bytes per element, any int value (default)
+    RB_ELEM_INT16,     // 2 bytes per element, INT16_MIN..INT16_MAX
+    RB_ELEM_UINT8,     // 1 byte per element, 0..UINT8_MAX
+} rb_elem_t;
+
+/**
+ * @brief Creation parameters for `rb_create_ex`/`rb_init_buffer_ex`.
+ *        Zero initialize and set the fields of interest.
+ */
+typedef struct {
+    int size;       // Requested number of elements, must be positive
+    rb_mode_t mode; // Concurrency mode
+    bool track_stats; // Maintain O(1) window statistics for `rb_get_stats_r` (RB_MODE_LOCKED only)
+    rb_elem_t elem_type; // Storage type of the elements (RB_ELEM_INT32 only in RB_MODE_MPMC)
+    const char *path;    // If set, keep the buffer in this memory mapped file (RB_MODE_LOCKED only)
+    bool mirror;         // Map the storage twice back to back, see `rb_create_ex` (not with MPMC
+                         // or path)
+    bool track_percentiles; // Maintain a histogram of the window for `rb_percentile_r`, implies
+                            // track_stats (RB_ELEM_UINT8 or RB_ELEM_INT16 only)
+} rb_config_t;
+
+/**
+ * @brief Create a new, independent ring buffer.
+ *
+ * @param size Size of the buffer (number of elements), must be positive.
+ * @return rb_t* Handle to the new buffer, NULL on invalid size or allocation failure.
+ */
+rb_t *rb_create(int size);
+
+/**
+ * @brief Create a new ring buffer from a configuration.
+ *
+ * When `path` is set, the buffer indices and elements live in a memory mapped file, updated with
+ * plain memory stores (no system call per element). If the file already holds a valid buffer of
+ * the same size and element type, typically left by a previous run that exited or crashed, the
+ * buffer resumes with its content, as of the last operation completed before the exit or crash. A
+ * file with an inconsistent header is reset to an empty buffer, and a file of another geometry is
+ * refused, as is a file attached to another buffer (in this process or another one).
+ *
+ * When `mirror` is set, the storage pages are mapped twice, back to back, so the element at index
+ * `size + i` is the element at index `i`: the whole content is always one contiguous region
+ * (`rb_peek_r` returns a single span) and reads need no wrap around. The capacity is rounded up to
+ * a whole number of pages, use `rb_size_r` to get it.
+ *
+ * In RB_MODE_SPSC only one thread may add elements and only one (other) thread may remove them.
+ * In RB_MODE_MPMC any thread may add and remove. In both lock-free modes adding to a full buffer
+ * still overwrites the oldest element, and the element count is a snapshot that may be stale as
+ * soon as it is returned.
+ *
+ * @param config Creation parameters.
+ * @return rb_t* Handle to the new buffer, NULL on invalid configuration or allocation failure.
+ */
+rb_t *rb_create_ex(const rb_config_t *config);
+
+/**
+ * @brief Destroy a ring buffer created with `rb_create` and release its memory.
+ *
+ * @param rb Buffer handle, NULL is ignored.
+ */
+void rb_destroy(rb_t *rb);
+
+/**
+ * @brief Add an element to the buffer, overwriting the oldest element when full.
+ *        The element is rejected if it does not fit the buffer element type.
+ *
+ * @param rb Buffer handle.
+ * @param element Element to be added to the buffer.
+ */
+void rb_add_element_r(rb_t *rb, int element);
+
+/**
+ * @brief Remove the oldest element from the buffer.
+ *
+ * @param rb Buffer handle.
+ * @param element Pointer to store the removed element (NULL if not needed).
+ * @return true If an element was removed.
+ * @return false If the buffer is empty or invalid.
+ */
+bool rb_remove_element_r(rb_t *rb, int *element);
+
+/**
+ * @brief Check if the buffer is full.
+ *
+ * @param rb Buffer handle.
+ * @return true If the buffer is full.
+ * @return false If the buffer is not full or invalid.
+ */
+bool rb_is_full_r(rb_t *rb);
+
+/**
+ * @brief Check if the buffer is empty.
+ *
+ * @param rb Buffer handle.
+ * @return true If the buffer is empty.
+ * @return false If the buffer is not empty or invalid.
+ */
+bool rb_is_empty_r(rb_t *rb);
+
+/**
+ * @brief Get the element at a specific index (0 is the oldest element).
+ *
+ * @param rb Buffer handle.
+ * @param index Index of the element to retrieve.
+ * @param element Pointer to store the element.
+ * @return int 0 if the element was retrieved successfully, -1 otherwise.
+ */
+int rb_get_element_at_r(rb_t *rb, int index, int *element);
+
+/**
+ * @brief Get the most recently added element.
+ *
+ * @param rb Buffer handle.
+ * @param element Pointer to store the last element.
+ * @return int 0 if the last element was retrieved successfully.
+ *             -1 if the buffer is invalid or empty.
+ */
+int rb_get_last_element_r(rb_t *rb, int *element);
+
+/**
+ * @brief Get the number of elements currently stored.
+ *
+ * @param rb Buffer handle.
+ * @return size_t Number of elements, 0 if the buffer is invalid.
+ */
+size_t rb_count_r(rb_t *rb);
+
+/**
+ * @brief Get the capacity of the buffer.
+ *
+ * @param rb Buffer handle.
+ * @return size_t Capacity in elements, 0 if the buffer is invalid.
+ */
+size_t rb_size_r(rb_t *rb);
+
+/**
+ * @brief A contiguous, read-only region of the buffer storage.
+ */
+typedef struct {
+    const void *data; // First element of the region, stored as the buffer `elem_type`
+                      // (`const int *` for the default RB_ELEM_INT32)
+    size_t len;       // Number of elements in the region
+} rb_span_t;
+
+/**
+ * @brief Add several elements at once, as if `rb_add_element_r` was called for each of them in
+ *        order (the oldest elements are overwritten when the buffer is full).
+ *        In RB_MODE_LOCKED the whole batch is added under a single lock.
+ *
+ * @param rb Buffer handle.
+ * @param elements Elements to add.
+ * @param n Number of elements.
+ * @return size_t Number of elements added, 0 if the buffer is invalid or if one of the elements
+ *                does not fit the buffer element type (nothing is added then).
+ */
+size_t rb_add_elements_r(rb_t *rb, const int *elements, size_t n);
+
+/**
+ * @brief Remove up to n of the oldest elements at once.
+ *        In RB_MODE_LOCKED the whole batch is removed under a single lock.
+ *
+ * @param rb Buffer handle.
+ * @param elements Array receiving the removed elements in FIFO order (NULL if not needed).
+ * @param n Maximum number of elements to remove.
+ * @return size_t Number of elements removed, 0 if the buffer is empty or invalid.
+ */
+size_t rb_remove_elements_r(rb_t *rb, int *elements, size_t n);
+
+/**
+ * @brief Expose the stored elements, oldest first, as at most two contiguous spans of the
+ *        underlying storage, without copying (only supported in RB_MODE_LOCKED). A mirrored
+ *        buffer always uses a single span.
+ *
+ * On success the buffer stays locked so the spans can be read safely, and the caller must call
+ * `rb_peek_done_r` as soon as it is done with them. Every other operation on the buffer blocks in
+ * the meantime, and calling one of them from the same thread deadlocks.
+ *
+ * @param rb Buffer handle.
+ * @param spans Array receiving the spans, unused entries are set to {NULL, 0}.
+ * @return int Number of spans used (0 if the buffer is empty, 1 or 2), -1 on failure (the buffer
+ *             is not locked in that case).
+ */
+int rb_peek_r(rb_t *rb, rb_span_t spans[2]);
+
+/**
+ * @brief Release the lock taken by a successful `rb_peek_r`.
+ *
+ * @param rb Buffer handle.
+ */
+void rb_peek_done_r(rb_t *rb);
+
+/**
+ * @brief Copy a consistent view of the newest elements, oldest first, without taking the lock.
+ *        Writers bump a sequence counter around every change of the window and never wait for
+ *        readers; a reader retries only when its copy overlapped a write. Unlike a loop over
+ *        `rb_get_element_at_r`, the copy is never torn. Supported in locked mode only.
+ *
+ * @param rb Buffer handle.
+ * @param out Array receiving up to max elements.
+ * @param max Capacity of out; when the buffer holds more, only the newest max are copied.
+ * @return size_t Number of elements copied, 0 if the buffer is empty or on invalid arguments.
+ */
+size_t rb_snapshot_r(rb_t *rb, int *out, size_t max);
+
+/**
+ * @brief Remove the oldest element, waiting for one if the buffer is empty. The waiting thread
+ *        sleeps on a condition variable, woken by the next add (writers only signal when a thread
+ *        is waiting) or by `rb_shutdown_r`. Supported in locked mode only.
+ *
+ * @param rb Buffer handle.
+ * @param element Pointer to store the removed element (NULL if not needed).
+ * @param timeout_ms Maximum time to wait in milliseconds, 0 not to wait, negative for no limit.
+ * @return int 0 on success, ETIMEDOUT if the buffer stayed empty, ECANCELED if the buffer was
+ *         shut down and is empty, EINVAL if the buffer is invalid or not in locked mode, or the
+ *         error of a failed lock or condition variable wait.
+ */
+int rb_wait_remove_r(rb_t *rb, int *element, int timeout_ms);
+
+/**
+ * @brief Wait until the buffer holds at least n elements, see `rb_wait_remove_r`.
+ *
+ * @param rb Buffer handle.
+ * @param n Number of elements to wait for, at most the buffer size.
+ * @param timeout_ms Maximum time to wait in milliseconds, 0 not to wait, negative for no limit.
+ * @return int 0 once the buffer holds n elements, ETIMEDOUT, ECANCELED if the buffer was shut down
+ *         first, EINVAL on invalid arguments, or the error of a failed lock or condition variable
+ *         wait.
+ */
+int rb_wait_for_count_r(rb_t *rb, size_t n, int timeout_ms);
+
+/**
+ * @brief Wake every thread blocked in `rb_wait_remove_r`/`rb_wait_for_count_r` and make later
+ *        waits return immediately: the remaining elements can still be drained, then ECANCELED
+ *        is returned. Call it and join the waiting threads before `rb_destroy`.
+ *
+ * @param rb Buffer handle.
+ */
+void rb_shutdown_r(rb_t *rb);
+
+/**
+ * @brief Callback receiving elements in order, see `rb_consume_since_r`.
+ *
+ * @param elements Elements, valid during the call only.
+ * @param n Number of elements.
+ * @param arg User argument.
+ */
+typedef void (*rb_consume_fn_t)(const int *elements, size_t n, void *arg);
+
+/**
+ * @brief Hand every element added since the previous call to a callback, in one locked pass.
+ *        Elements are numbered by a sequence number counting every element ever added; the
+ *        cursor holds the sequence number of the next element to consume and is advanced past the
+ *        newest one. The callback runs with the buffer locked, possibly several times with
+ *        consecutive chunks, and must not call back into the buffer.
+ *        Supported in locked mode only.
+ *
+ * @param rb Buffer handle.
+ * @param cursor Sequence number of the next element to consume, 0 for the start of the stream.
+ *        A cursor past the newest element (the buffer was reinitialized) restarts at the oldest.
+ * @param fn Callback receiving the elements.
+ * @param arg User argument passed to the callback.
+ * @param lost Pointer to store how many elements the cursor missed because they were overwritten
+ *        or removed before it caught up, may be NULL.
+ * @return size_t Number of elements handed to the callback.
+ */
+size_t rb_consume_since_r(rb_t *rb, uint64_t *cursor, rb_consume_fn_t fn, void *arg,
+                          uint64_t *lost);
+
+/**
+ * @brief Statistics over all the elements currently stored in the buffer.
+ */
+typedef struct {
+    size_t count;    // Number of elements
+    int64_t sum;     // Sum of the elements
+    double mean;     // Arithmetic mean
+    int min;         // Smallest element
+    int max;         // Largest element
+    double variance; // Population variance
+    double stddev;   // Population standard deviation
+} rb_stats_t;
+
+/**
+ * @brief Get a consistent snapshot of the window statistics in O(1).
+ *        The statistics are kept up to date on every add, remove and overwrite, which requires
+ *        the buffer to be created with `track_stats` set.
+ *
+ * @param rb Buffer handle.
+ * @param stats Pointer to store the statistics.
+ * @return int 0 on success, -1 if the buffer is invalid, empty or does not track statistics.
+ */
+int rb_get_stats_r(rb_t *rb, rb_stats_t *stats);
+
+/**
+ * @brief Get a percentile of the window, e.g. the median for 50, by nearest rank: the smallest
+ *        element such that at least p% of the window is not larger. Every add, remove and
+ *        overwrite updates a count per storable value, grouped in blocks of 16 values, so a query
+ *        walks the blocks then one block instead of sorting the window: at most 32 steps for
+ *        RB_ELEM_UINT8. Requires the buffer to be created with `track_percentiles` set.
+ *
+ * @param rb Buffer handle.
+ * @param p Percentile, 0 (the minimum) to 100 (the maximum).
+ * @param value Pointer to store the element.
+ * @return int 0 on success, -1 if the buffer is invalid, empty or does not track percentiles,
+ *             or p is out of range.
+ */
+int rb_percentile_r(rb_t *rb, double p, int *value);
+
+/**
+ * @brief Get several percentiles of the same window, under one lock, see `rb_percentile_r`.
+ *
+ * @param rb Buffer handle.
+ * @param p Percentiles, 0 to 100 each.
+ * @param values Array receiving one element per percentile.
+ * @param n Number of percentiles.
+ * @return int 0 on success, -1 otherwise.
+ */
+int rb_percentiles_r(rb_t *rb, const double *p, int *values, size_t n);
+
+/**
+ * @brief Flush a file backed buffer to the disk, blocking until done. Not needed to survive a
+ *        process crash or restart, only to survive a crash of the whole system.
+ *
+ * @param rb Buffer handle.
+ * @return int 0 on success or if the buffer is not file backed, -1 on failure.
+ */
+int rb_sync_r(rb_t *rb);
+
+/**
+ * @brief Hot path counters of a buffer, since its creation.
+ */
+typedef struct {
+    uint64_t adds;        // Elements added
+    uint64_t removes;     // Elements removed
+    uint64_t overwrites;  // Unread elements dropped to make room for an add to a full buffer
+    uint64_t empty_reads; // Removes and last element reads that found the buffer empty
+    uint64_t lock_acquisitions; // Lock acquisitions (RB_MODE_LOCKED)
+    uint64_t lock_contended;    // Acquisitions that had to wait for another thread
+    uint64_t lock_wait_ns;      // Total time spent waiting for the lock
+    uint64_t lock_wait_max_ns;  // Longest wait for the lock
+} rb_metrics_t;
+
+/**
+ * @brief Get a snapshot of the buffer metrics.
+ *        Lock-free buffers have no lock, their lock counters are zero, and their snapshot is not
+ *        atomic while other threads use the buffer.
+ *
+ * @param rb Buffer handle.
+ * @param metrics Pointer to store the metrics.
+ * @return int 0 on success, -1 if the buffer is invalid or metrics are compiled out.
+ */
+int rb_get_metrics_r(rb_t *rb, rb_metrics_t *metrics);
+
+/**
+ * @brief Get the handle of the default instance used by the global API.
+ *        Useful to mix the global API with newer handle based functions.
+ *
+ * @return rb_t* Default instance handle, NULL if `rb_init_buffer` was not called.
+ */
+rb_t *rb_default(void);
+
+/**
+ * @brief Get the generation of the default instance, which changes whenever it is initialized
+ *        or freed. State kept about its content (e.g. a cursor) is stale once it changes, the
+ *        sequence numbers of a new buffer start again at 0.
+ *
+ * @return uint64_t Generation.
+ */
+uint64_t rb_default_generation(void);
 
 /**
  * @brief Initialize the ring buffer with a given size.
@@ -27,6 +431,14 @@ this data structure is thread-safe.
  */
 void rb_init_buffer(int size);
 
+/**
+ * @brief Initialize the default ring buffer from a configuration, see `rb_create_ex`.
+ *        If the buffer is already initialized, no effect.
+ *
+ * @param config Creation parameters.
+ */
+void rb_init_buffer_ex(const rb_config_t *config);
+
 /**
  * @brief Add an element to the ring buffer.
  *
@@ -91,4 +503,94 @@ bool rb_is_initialized();
  */
 int rb_get_last_element(int *element);
 
+/**
+ * @brief Add several elements to the ring buffer, see `rb_add_elements_r`.
+ *
+ * @param elements Elements to add.
+ * @param n Number of elements.
+ * @return size_t Number of elements added.
+ */
+size_t rb_add_elements(const int *elements, size_t n);
+
+/**
+ * @brief Remove up to n elements from the ring buffer, see `rb_remove_elements_r`.
+ *
+ * @param elements Array receiving the removed elements (NULL if not needed).
+ * @param n Maximum number of elements to remove.
+ * @return size_t Number of elements removed.
+ */
+size_t rb_remove_elements(int *elements, size_t n);
+
+/**
+ * @brief Expose the ring buffer content as at most two spans, see `rb_peek_r`.
+ *        Must be followed by `rb_peek_done()` when it succeeds.
+ *
+ * @param spans Array receiving the spans.
+ * @return int Number of spans used, -1 on failure.
+ */
+int rb_peek(rb_span_t spans[2]);
+
+/**
+ * @brief Release the lock taken by a successful `rb_peek`.
+ */
+void rb_peek_done();
+
+/**
+ * @brief Get the window statistics of the ring buffer, see `rb_get_stats_r`.
+ *
+ * @param stats Pointer to store the statistics.
+ * @return int 0 on success, -1 otherwise.
+ */
+int rb_get_stats(rb_stats_t *stats);
+
+/**
+ * @brief Get a percentile of the window of the ring buffer, see `rb_percentile_r`.
+ *
+ * @param p Percentile, 0 to 100.
+ * @param value Pointer to store the element.
+ * @return int 0 on success, -1 otherwise.
+ */
+int rb_percentile(double p, int *value);
+
+/**
+ * @brief Hand the elements added since the cursor to a callback, see `rb_consume_since_r`.
+ *
+ * @return size_t Number of elements handed to the callback.
+ */
+size_t rb_consume_since(uint64_t *cursor, rb_consume_fn_t fn, void *arg, uint64_t *lost);
+
+/**
+ * @brief Copy a consistent view of the newest elements of the buffer, see `rb_snapshot_r`.
+ *
+ * @return size_t Number of elements copied.
+ */
+size_t rb_snapshot(int *out, size_t max);
+
+/**
+ * @brief Remove the oldest element, waiting for one, see `rb_wait_remove_r`.
+ *
+ * @return int 0, ETIMEDOUT, ECANCELED, EINVAL or another error, see `rb_wait_remove_r`.
+ */
+int rb_wait_remove(int *element, int timeout_ms);
+
+/**
+ * @brief Wait until the buffer holds at least n elements, see `rb_wait_for_count_r`.
+ *
+ * @return int 0, ETIMEDOUT, ECANCELED, EINVAL or another error, see `rb_wait_for_count_r`.
+ */
+int rb_wait_for_count(size_t n, int timeout_ms);
+
+/**
+ * @brief Wake the waiting threads and cancel later waits, see `rb_shutdown_r`.
+ */
+void rb_shutdown(void);
+
+/**
+ * @brief Get the metrics of the ring buffer, see `rb_get_metrics_r`.
+ *
+ * @param metrics Pointer to store the metrics.
+ * @return int 0 on success, -1 otherwise.
+ */
+int rb_get_metrics(rb_metrics_t *metrics);
+
 #endif // __RING_BUFFER_H__
@@ -0,0 +1,206 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // memfd_create
+#endif
+
+#include "ring_buffer_storage.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+
+void *
+rbs_map_file(const char *path, size_t len, bool *created, int *fd_out) {
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    // One writer per file: the lock goes with the descriptor, kept open as long as the mapping
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        if (errno == EWOULDBLOCK)
+            fprintf(stderr, "File %s is in use by another buffer\n", path);
+        else
+            fprintf(stderr, "Failed to lock %s: %s\n", path, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        fprintf(stderr, "Failed to stat %s: %s\n", path, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    // A non-empty file shorter than the mapping can not hold a buffer of this geometry, leave it
+    // untouched. An empty file is grown and reads as zeros.
+    if (st.st_size > 0 && (size_t)st.st_size < len) {
+        fprintf(stderr, "File %s is too small for this buffer\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    *created = (st.st_size == 0);
+    if (*created && ftruncate(fd, (off_t)len) != 0) {
+        fprintf(stderr, "Failed to resize %s: %s\n", path, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    void *addr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        fprintf(stderr, "Failed to map %s: %s\n", path, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+    *fd_out = fd;
+    return addr;
+}
+
+void
+rbs_unmap_file(void *addr, size_t len, int fd) {
+    rbs_unmap(addr, len);
+    close(fd); // releases the lock
+}
+
+int
+rbs_sync_file(void *addr, size_t len) {
+    if (msync(addr, len, MS_SYNC) != 0) {
+        fprintf(stderr, "Failed to sync buffer file: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+size_t
+rbs_page_size(void) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    return (page_size > 0) ? (size_t)page_size : 4096;
+}
+
+// Anonymous shared memory object, only reachable through the returned descriptor
+static int
+rbs_anonymous_fd(void) {
+#ifdef __linux__
+    return memfd_create("ring_buffer", MFD_CLOEXEC);
+#else
+    // Short name (macOS limits them to 31 characters), unique enough with the retries
+    static unsigned counter = 0;
+    for (int attempt = 0; attempt < 16; attempt++) {
+        char name[32];
+        snprintf(name, sizeof(name), "/rb.%ld.%u", (long)getpid(), counter++);
+        int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd >= 0) {
+            shm_unlink(name);
+            return fd;
+        }
+        if (errno != EEXIST)
+            break;
+    }
+    return -1;
+#endif
+}
+
+void *
+rbs_map_mirror(size_t len) {
+    if (len == 0 || len % rbs_page_size() != 0) {
+        fprintf(stderr, "Mirror length must be a multiple of the page size: %zu\n", len);
+        return NULL;
+    }
+
+    int fd = rbs_anonymous_fd();
+    if (fd < 0) {
+        fprintf(stderr, "Failed to create shared memory: %s\n", strerror(errno));
+        return NULL;
+    }
+
+    if (ftruncate(fd, (off_t)len) != 0) {
+        fprintf(stderr, "Failed to size shared memory: %s\n", strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    // Reserve the whole range first so that both halves are guaranteed to be adjacent
+    uint8_t *base = (uint8_t *)mmap(NULL, 2 * len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "Failed to reserve mirror range: %s\n", strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    for (int half = 0; half < 2; half++) {
+        void *addr = mmap(base + half * len, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+                          fd, 0);
+        if (addr == MAP_FAILED) {
+            fprintf(stderr, "Failed to map mirror: %s\n", strerror(errno));
+            munmap(base, 2 * len);
+            close(fd);
+            return NULL;
+        }
+    }
+
+    close(fd); // the mappings keep the memory alive
+    return base;
+}
+
+void
+rbs_unmap(void *addr, size_t len) {
+    if (munmap(addr, len) != 0)
+        fprintf(stderr, "Failed to unmap buffer storage: %s\n", strerror(errno));
+}
+
+#else // _WIN32
+
+void *
+rbs_map_file(const char *path, size_t len, bool *created, int *fd_out) {
+    (void)len;
+    *created = false;
+    *fd_out = -1;
+    fprintf(stderr, "File backed buffers are not supported on this platform: %s\n", path);
+    return NULL;
+}
+
+int
+rbs_sync_file(void *addr, size_t len) {
+    (void)addr;
+    (void)len;
+    return -1;
+}
+
+size_t
+rbs_page_size(void) {
+    return 0;
+}
+
+void *
+rbs_map_mirror(size_t len) {
+    (void)len;
+    fprintf(stderr, "Mirrored buffers are not supported on this platform\n");
+    return NULL;
+}
+
+void
+rbs_unmap(void *addr, size_t len) {
+    (void)addr;
+    (void)len;
+}
+
+void
+rbs_unmap_file(void *addr, size_t len, int fd) {
+    (void)addr;
+    (void)len;
+    (void)fd;
+}
+
+#endif // _WIN32
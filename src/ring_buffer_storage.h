@@ -0,0 +1,61 @@
+#ifndef __RING_BUFFER_STORAGE_H__
+#define __RING_BUFFER_STORAGE_H__
+/*
+Platform specific memory backends of the ring buffer element storage, used by `ring_buffer.c`
+when the storage does not come from the heap.
+
+this module is internal to the ring buffer and would be prefixed with `rbs_`.
+*/
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Map the first `len` bytes of a file in shared read/write mode. A missing or empty file is
+ *        created with this length, a non-empty shorter file is refused.
+ *        Stores to the mapping reach the file without any system call, and survive a crash of
+ *        the process (they are written back by the kernel).
+ *        The file is locked exclusively (flock) until `rbs_unmap_file`, a file already mapped by
+ *        another buffer, in this process or another one, is refused.
+ *
+ * @param path Path of the file.
+ * @param len Length of the mapping in bytes.
+ * @param created Set to true if the file was created (its content is zeroed).
+ * @param fd Set to the descriptor holding the lock, to pass to `rbs_unmap_file`.
+ * @return void* Address of the mapping, NULL on failure (unsupported platform included).
+ */
+void *rbs_map_file(const char *path, size_t len, bool *created, int *fd);
+
+/**
+ * @brief Flush a file mapping to the disk, blocking until it is written.
+ *
+ * @return int 0 on success, -1 on failure.
+ */
+int rbs_sync_file(void *addr, size_t len);
+
+/**
+ * @brief Get the granularity of the mappings (the page size).
+ *
+ * @return size_t Page size in bytes, 0 if mappings are not supported on this platform.
+ */
+size_t rbs_page_size(void);
+
+/**
+ * @brief Map `len` bytes of fresh shared memory twice, back to back, so that the byte at offset
+ *        `len + i` is the byte at offset `i`. The whole `2 * len` range must be unmapped at once.
+ *
+ * @param len Length of the memory, must be a multiple of `rbs_page_size()`.
+ * @return void* Address of the first mapping, NULL on failure (unsupported platform included).
+ */
+void *rbs_map_mirror(size_t len);
+
+/**
+ * @brief Unmap a mapping created by this module.
+ */
+void rbs_unmap(void *addr, size_t len);
+
+/**
+ * @brief Unmap a mapping created by `rbs_map_file` and release the file lock.
+ */
+void rbs_unmap_file(void *addr, size_t len, int fd);
+
+#endif // __RING_BUFFER_STORAGE_H__
@@ -0,0 +1,187 @@
+#include "rollup_store.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    uint64_t index; // Bucket number, time / period
+    uint64_t count; // Samples in the bucket, 0 only for the open bucket of an empty store
+    int64_t sum;
+    int min;
+    int max;
+} rs_bucket_t;
+
+typedef struct {
+    uint64_t period_ns;
+    rs_bucket_t *ring; // Closed buckets, oldest at head, increasing indices
+    size_t capacity;
+    size_t head;
+    size_t count;
+    bool dropped;     // Whether a closed bucket was ever dropped from the ring
+    rs_bucket_t open; // Bucket being filled, the latest sample is in it
+} rs_tier_store_t;
+
+struct rs_store {
+    rs_tier_store_t tiers[RS_TIERS];
+    rs_bucket_t *buckets; // Storage of all the rings
+    uint64_t latest_ns;   // Latest sample time
+};
+
+static const uint64_t rs_periods_g[RS_TIERS] = { RS_MINUTE_NS, RS_HOUR_NS };
+
+uint64_t
+rs_tier_period_ns(rs_tier_t tier) {
+    return ((unsigned)tier < RS_TIERS) ? rs_periods_g[tier] : 0;
+}
+
+rs_store_t *
+rs_create(const rs_config_t *config) {
+    size_t capacities[RS_TIERS] = { RS_DEFAULT_MINUTES, RS_DEFAULT_HOURS };
+    if (config && config->minutes)
+        capacities[RS_TIER_MINUTE] = config->minutes;
+    if (config && config->hours)
+        capacities[RS_TIER_HOUR] = config->hours;
+
+    size_t total = 0;
+    for (size_t t = 0; t < RS_TIERS; t++)
+        total += capacities[t];
+
+    rs_store_t *store = calloc(1, sizeof(rs_store_t));
+    rs_bucket_t *buckets = malloc(total * sizeof(rs_bucket_t));
+    if (!store || !buckets) {
+        fprintf(stderr, "Memory allocation failed\n");
+        free(buckets);
+        free(store);
+        return NULL;
+    }
+
+    store->buckets = buckets;
+    for (size_t t = 0; t < RS_TIERS; t++) {
+        store->tiers[t].period_ns = rs_periods_g[t];
+        store->tiers[t].ring = buckets;
+        store->tiers[t].capacity = capacities[t];
+        buckets += capacities[t];
+    }
+    return store;
+}
+
+void
+rs_destroy(rs_store_t *store) {
+    if (!store)
+        return;
+    free(store->buckets);
+    free(store);
+}
+
+static void
+rs_push(rs_tier_store_t *tier, const rs_bucket_t *bucket) {
+    size_t slot = tier->head + tier->count;
+    if (slot >= tier->capacity)
+        slot -= tier->capacity;
+    tier->ring[slot] = *bucket;
+    if (tier->count < tier->capacity) {
+        tier->count++;
+    } else {
+        tier->head = (tier->head + 1 == tier->capacity) ? 0 : tier->head + 1;
+        tier->dropped = true;
+    }
+}
+
+void
+rs_add(rs_store_t *store, int value, uint64_t time_ns) {
+    if (!store)
+        return;
+
+    if (time_ns > store->latest_ns)
+        store->latest_ns = time_ns;
+    for (size_t t = 0; t < RS_TIERS; t++) {
+        rs_tier_store_t *tier = &store->tiers[t];
+        uint64_t index = time_ns / tier->period_ns;
+        rs_bucket_t *open = &tier->open;
+
+        if (open->count == 0 || index > open->index) {
+            if (open->count > 0)
+                rs_push(tier, open);
+            *open = (rs_bucket_t){ index, 0, 0, value, value };
+        }
+
+        open->count++;
+        open->sum += value;
+        if (value < open->min)
+            open->min = value;
+        if (value > open->max)
+            open->max = value;
+    }
+}
+
+static void
+rs_fold(rs_aggregate_t *aggregate, int64_t *sum, const rs_bucket_t *bucket) {
+    if (aggregate->count == 0 || bucket->min < aggregate->min)
+        aggregate->min = bucket->min;
+    if (aggregate->count == 0 || bucket->max > aggregate->max)
+        aggregate->max = bucket->max;
+    aggregate->count += bucket->count;
+    *sum += bucket->sum;
+}
+
+// Start of the oldest bucket from which a tier still holds every sample, 0 if it dropped none
+static uint64_t
+rs_tier_from_ns(const rs_tier_store_t *tier) {
+    return tier->dropped ? tier->ring[tier->head].index * tier->period_ns : 0;
+}
+
+// Fold the buckets of a tier with an index in [first, end)
+static void
+rs_fold_tier(const rs_tier_store_t *tier, uint64_t first, uint64_t end, rs_aggregate_t *aggregate,
+             int64_t *sum) {
+    if (tier->open.index >= first && tier->open.index < end)
+        rs_fold(aggregate, sum, &tier->open);
+    for (size_t i = tier->count; i-- > 0;) {
+        size_t slot = tier->head + i;
+        if (slot >= tier->capacity)
+            slot -= tier->capacity;
+        if (tier->ring[slot].index < first)
+            break;
+        if (tier->ring[slot].index < end)
+            rs_fold(aggregate, sum, &tier->ring[slot]);
+    }
+}
+
+int
+rs_query(const rs_store_t *store, uint64_t range_ns, rs_aggregate_t *aggregate) {
+    if (!store || range_ns == 0 || !aggregate)
+        return -1;
+
+    const rs_tier_store_t *fine = &store->tiers[RS_TIER_MINUTE];
+    const rs_tier_store_t *coarse = &store->tiers[RS_TIER_HOUR];
+    if (fine->open.count == 0)
+        return -1;
+
+    // Trailing window (start, latest], rounded out to the buckets it overlaps
+    uint64_t start = (store->latest_ns > range_ns) ? store->latest_ns - range_ns : 0;
+    uint64_t fine_from = rs_tier_from_ns(fine);
+    int64_t sum = 0;
+    *aggregate = (rs_aggregate_t){ 0 };
+
+    if (start >= fine_from || start / coarse->period_ns >= fine_from / coarse->period_ns) {
+        // The minute tier covers the window, or misses less than the hour bucket it starts in
+        uint64_t first = (start > fine_from ? start : fine_from) / fine->period_ns;
+        rs_fold_tier(fine, first, UINT64_MAX, aggregate, &sum);
+        aggregate->tier = RS_TIER_MINUTE;
+        aggregate->start_ns = first * fine->period_ns;
+    } else {
+        // Hour buckets up to the first hour the minute tier holds whole, then its minutes
+        uint64_t boundary = (fine_from + coarse->period_ns - 1) / coarse->period_ns;
+        uint64_t coarse_from = rs_tier_from_ns(coarse);
+        uint64_t first = (start > coarse_from ? start : coarse_from) / coarse->period_ns;
+        rs_fold_tier(coarse, first, boundary, aggregate, &sum);
+        rs_fold_tier(fine, boundary * (coarse->period_ns / fine->period_ns), UINT64_MAX, aggregate,
+                     &sum);
+        aggregate->tier = RS_TIER_HOUR;
+        aggregate->start_ns = first * coarse->period_ns;
+    }
+
+    aggregate->mean = (double)sum / (double)aggregate->count;
+    aggregate->end_ns = (fine->open.index + 1) * fine->period_ns;
+    return 0;
+}
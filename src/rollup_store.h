@@ -0,0 +1,104 @@
+#ifndef __ROLLUP_STORE_H__
+#define __ROLLUP_STORE_H__
+/*
+Long term history with bounded memory. The raw ring buffer only holds the last `buffer_size`
+samples; the rollup store keeps per-minute and per-hour aggregates (min, max, mean, count) of every
+sample in two small secondary rings, e.g. 48 hours in 48 hour buckets instead of 172,800 ints at
+2 Hz.
+
+Buckets are aligned on multiples of their period since time 0 of the caller's clock. Each tier
+accumulates the samples of its current bucket as they arrive, and pushes the bucket into its ring
+when a sample of a later bucket arrives, so every tier covers the recent past on its own. A query
+reads the minute tier, with hour buckets in front of it for what it no longer holds. Buckets with
+no sample (e.g. a pause of the sampling) are not stored.
+
+Not thread-safe, the store is owned by the sampling thread.
+
+this module would be prefixed with `rs_`.
+*/
+#include <stddef.h>
+#include <stdint.h>
+
+#define RS_MINUTE_NS 60000000000ULL
+#define RS_HOUR_NS (60 * RS_MINUTE_NS)
+#define RS_DEFAULT_MINUTES 120 // Closed minute buckets kept, 2 hours
+#define RS_DEFAULT_HOURS 48    // Closed hour buckets kept, 2 days
+
+typedef enum {
+    RS_TIER_MINUTE = 0,
+    RS_TIER_HOUR,
+    RS_TIERS,
+} rs_tier_t;
+
+typedef struct {
+    size_t minutes; // Closed minute buckets kept, 0 for RS_DEFAULT_MINUTES
+    size_t hours;   // Closed hour buckets kept, 0 for RS_DEFAULT_HOURS
+} rs_config_t;
+
+/**
+ * @brief Aggregate of the samples of a time range.
+ */
+typedef struct {
+    int min;
+    int max;
+    double mean;
+    uint64_t count;    // Number of samples, 0 if the range holds none
+    uint64_t start_ns; // Start of the range actually aggregated, aligned on the tier buckets
+    uint64_t end_ns;   // End (exclusive) of the range actually aggregated
+    rs_tier_t tier;    // Coarsest tier the aggregate was read from
+} rs_aggregate_t;
+
+/**
+ * @brief Opaque store handle.
+ */
+typedef struct rs_store rs_store_t;
+
+/**
+ * @brief Create an empty store.
+ *
+ * @param config Ring sizes of the tiers, NULL for the defaults.
+ * @return rs_store_t* Store handle, NULL on failure.
+ */
+rs_store_t *rs_create(const rs_config_t *config);
+
+/**
+ * @brief Destroy a store.
+ *
+ * @param store Store handle, may be NULL.
+ */
+void rs_destroy(rs_store_t *store);
+
+/**
+ * @brief Roll a sample into every tier, O(1).
+ *
+ * @param store Store handle.
+ * @param value Sample value.
+ * @param time_ns Time of the sample, e.g. `sc_now_ns()`. A time earlier than the current bucket
+ *        of a tier (a clock step back) is counted in that bucket.
+ */
+void rs_add(rs_store_t *store, int value, uint64_t time_ns);
+
+/**
+ * @brief Aggregate the samples of the trailing window of range_ns nanoseconds ending at the
+ *        latest sample, rounded out to the buckets it overlaps. The window is read from the
+ *        minute tier when it holds all of it (or all but part of the hour the window starts in),
+ *        so "last hour" just after the top of the hour is still 60 minutes; otherwise from the
+ *        hour buckets up to the first hour the minute tier holds whole, stitched onto its
+ *        minutes. History older than the hour tier holds is left out.
+ *
+ * @param store Store handle.
+ * @param range_ns Length of the range, not 0.
+ * @param aggregate Pointer to store the aggregate.
+ * @return int 0 on success, -1 on invalid arguments or if the store holds no sample.
+ */
+int rs_query(const rs_store_t *store, uint64_t range_ns, rs_aggregate_t *aggregate);
+
+/**
+ * @brief Get the period of the buckets of a tier.
+ *
+ * @param tier Tier.
+ * @return uint64_t Period in nanoseconds, 0 for an invalid tier.
+ */
+uint64_t rs_tier_period_ns(rs_tier_t tier);
+
+#endif // __ROLLUP_STORE_H__
@@ -0,0 +1,84 @@
+#include "sample_clock.h"
+#include <errno.h>
+#include <time.h>
+
+#define SC_NS_PER_SEC 1000000000ULL
+
+uint64_t
+sc_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * SC_NS_PER_SEC + (uint64_t)now.tv_nsec;
+}
+
+int
+sc_init(sc_clock_t *clock, double rate_hz) {
+    if (!clock || !(rate_hz > 0.0) || rate_hz > SC_MAX_RATE_HZ)
+        return -1;
+
+    clock->period_ns = (uint64_t)((double)SC_NS_PER_SEC / rate_hz + 0.5);
+    clock->start_ns = sc_now_ns();
+    clock->deadline_ns = clock->start_ns;
+    clock->ticks = 0;
+    clock->overruns = 0;
+    return 0;
+}
+
+/**
+ * @brief Sleep until the absolute monotonic time deadline_ns.
+ *
+ * @return int 0 on success, -1 with errno set if interrupted by a signal (EINTR) or on any other
+ *             failure, never retried here so that an error can not spin forever.
+ */
+static int
+sc_sleep_until(uint64_t deadline_ns) {
+#if defined(TIMER_ABSTIME) && !defined(__APPLE__)
+    struct timespec deadline = {
+        .tv_sec = (time_t)(deadline_ns / SC_NS_PER_SEC),
+        .tv_nsec = (long)(deadline_ns % SC_NS_PER_SEC),
+    };
+    // clock_nanosleep returns the error instead of setting errno
+    int result = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+    if (result != 0) {
+        errno = result;
+        return -1;
+    }
+#else
+    // No absolute sleep (macOS): sleep the remaining time, measured again after each wake up
+    uint64_t now;
+    while ((now = sc_now_ns()) < deadline_ns) {
+        uint64_t left = deadline_ns - now;
+        struct timespec rel = {
+            .tv_sec = (time_t)(left / SC_NS_PER_SEC),
+            .tv_nsec = (long)(left % SC_NS_PER_SEC),
+        };
+        if (nanosleep(&rel, NULL) != 0)
+            return -1;
+    }
+#endif
+    return 0;
+}
+
+int64_t
+sc_wait(sc_clock_t *clock, uint64_t *timestamp_ns) {
+    if (!clock || clock->period_ns == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (sc_sleep_until(clock->deadline_ns) != 0)
+        return -1;
+
+    uint64_t now = sc_now_ns();
+
+    // Skip the deadlines already passed instead of bursting through them
+    uint64_t late = (now > clock->deadline_ns) ? now - clock->deadline_ns : 0;
+    uint64_t missed = late / clock->period_ns;
+    clock->deadline_ns += (missed + 1) * clock->period_ns;
+    clock->overruns += missed;
+    clock->ticks++;
+
+    if (timestamp_ns)
+        *timestamp_ns = now;
+    return (int64_t)missed;
+}
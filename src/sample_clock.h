@@ -0,0 +1,50 @@
+#ifndef __SAMPLE_CLOCK_H__
+#define __SAMPLE_CLOCK_H__
+/*
+A drift-free sampling clock. Ticks are scheduled on absolute deadlines of the monotonic clock,
+start + k * period, so the time spent processing a sample does not stretch the period. A tick
+whose deadline has already passed by a whole period is not replayed, it is counted as an overrun
+and the clock moves on to the next deadline in phase.
+
+this module would be prefixed with `sc_`.
+*/
+#include <stdint.h>
+
+#define SC_MAX_RATE_HZ 1000000.0 // One tick per microsecond
+
+typedef struct {
+    uint64_t period_ns;   // Time between two ticks
+    uint64_t start_ns;    // Monotonic time of the first deadline
+    uint64_t deadline_ns; // Monotonic time of the next tick
+    uint64_t ticks;       // Ticks delivered
+    uint64_t overruns;    // Ticks missed because a deadline was already passed
+} sc_clock_t;
+
+/**
+ * @brief Read the monotonic clock.
+ *
+ * @return uint64_t Nanoseconds since an arbitrary fixed point.
+ */
+uint64_t sc_now_ns(void);
+
+/**
+ * @brief Initialize a clock ticking at rate_hz, the first tick is due immediately.
+ *
+ * @param clock Clock to initialize.
+ * @param rate_hz Ticks per second, in (0, SC_MAX_RATE_HZ].
+ * @return int 0 on success, -1 if the rate is out of range.
+ */
+int sc_init(sc_clock_t *clock, double rate_hz);
+
+/**
+ * @brief Sleep until the next tick.
+ *
+ * @param clock Clock.
+ * @param timestamp_ns Pointer to store the monotonic time of the wake up, may be NULL.
+ * @return int64_t Number of ticks missed before this one (added to `overruns`), or -1 if the
+ *         sleep was interrupted by a signal (errno is EINTR) or failed (any other errno); the
+ *         tick is then still pending.
+ */
+int64_t sc_wait(sc_clock_t *clock, uint64_t *timestamp_ns);
+
+#endif // __SAMPLE_CLOCK_H__
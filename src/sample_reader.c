@@ -0,0 +1,134 @@
+#include "sample_reader.h"
+#include <ctype.h>
+#include <limits.h>
+#include <string.h>
+
+int
+sr_parse_format(const char *name, sr_format_t *format) {
+    if (!name || !format)
+        return -1;
+
+    if (strcmp(name, "text") == 0)
+        *format = SR_FORMAT_TEXT;
+    else if (strcmp(name, "binary") == 0)
+        *format = SR_FORMAT_BINARY;
+    else
+        return -1;
+    return 0;
+}
+
+void
+sr_init(sr_reader_t *reader, FILE *stream, sr_format_t format) {
+    memset(reader, 0, sizeof(sr_reader_t));
+    reader->stream = stream;
+    reader->format = format;
+    reader->line = 1;
+}
+
+/**
+ * @brief Refill the chunk, keeping the unparsed tail at its start.
+ *
+ * @return bool true if new bytes were read.
+ */
+static bool
+sr_refill(sr_reader_t *reader) {
+    if (reader->eof)
+        return false;
+
+    size_t left = reader->chunk_len - reader->chunk_pos;
+    memmove(reader->chunk, reader->chunk + reader->chunk_pos, left);
+    reader->chunk_len = left;
+    reader->chunk_pos = 0;
+
+    size_t got = fread(reader->chunk + left, 1, SR_READ_CHUNK - left, reader->stream);
+    reader->chunk_len += got;
+    if (got == 0) {
+        reader->eof = true;
+        if (ferror(reader->stream)) {
+            fprintf(stderr, "Failed to read samples\n");
+            reader->error = true;
+        }
+    }
+    return got > 0;
+}
+
+static size_t
+sr_read_binary(sr_reader_t *reader, int *out, size_t max) {
+    size_t n = 0;
+    while (n < max) {
+        if (reader->chunk_pos == reader->chunk_len && !sr_refill(reader))
+            break;
+
+        size_t available = reader->chunk_len - reader->chunk_pos;
+        size_t take = (available < max - n) ? available : max - n;
+        const unsigned char *src = reader->chunk + reader->chunk_pos;
+        for (size_t i = 0; i < take; i++)
+            out[n + i] = src[i];
+        n += take;
+        reader->chunk_pos += take;
+    }
+    return n;
+}
+
+static size_t
+sr_read_text(sr_reader_t *reader, int *out, size_t max) {
+    size_t n = 0;
+    while (n < max && !reader->error) {
+        // Skip separators
+        while (reader->chunk_pos < reader->chunk_len &&
+               isspace(reader->chunk[reader->chunk_pos])) {
+            if (reader->chunk[reader->chunk_pos] == '\n')
+                reader->line++;
+            reader->chunk_pos++;
+        }
+
+        // A number may continue in the next chunk: parse only when it is followed by a separator
+        // or when the stream is exhausted
+        size_t end = reader->chunk_pos;
+        while (end < reader->chunk_len && !isspace(reader->chunk[end]))
+            end++;
+        if (end == reader->chunk_len && !reader->eof) {
+            if (reader->chunk_pos == 0 && end == SR_READ_CHUNK) {
+                fprintf(stderr, "Sample too long at line %ld\n", reader->line);
+                reader->error = true;
+                break;
+            }
+            if (!sr_refill(reader) && reader->chunk_pos == reader->chunk_len)
+                break;
+            continue;
+        }
+        if (end == reader->chunk_pos)
+            break; // nothing left
+
+        const unsigned char *p = reader->chunk + reader->chunk_pos;
+        size_t len = end - reader->chunk_pos;
+        bool negative = (p[0] == '-');
+        size_t i = (p[0] == '-' || p[0] == '+') ? 1 : 0;
+        long long value = 0;
+        bool valid = (i < len);
+        for (; i < len && valid; i++) {
+            valid = isdigit(p[i]) && value <= INT_MAX / 10;
+            value = value * 10 + (p[i] - '0');
+        }
+        if (!valid || value > INT_MAX) {
+            fprintf(stderr, "Invalid sample at line %ld: %.*s\n", reader->line, (int)len,
+                    (const char *)p);
+            reader->error = true;
+            break;
+        }
+
+        out[n++] = (int)(negative ? -value : value);
+        reader->chunk_pos = end;
+    }
+    return n;
+}
+
+size_t
+sr_read(sr_reader_t *reader, int *out, size_t max) {
+    if (!reader || !out || reader->error)
+        return 0;
+
+    if (reader->format == SR_FORMAT_BINARY)
+        return sr_read_binary(reader, out, max);
+    return sr_read_text(reader, out, max);
+}
@@ -0,0 +1,63 @@
+#ifndef __SAMPLE_READER_H__
+#define __SAMPLE_READER_H__
+/*
+A buffered reader of recorded heart rate samples, used to replay recorded sessions through the
+pipeline as fast as possible.
+
+Two formats are supported:
+* text: decimal integers separated by any whitespace (one sample per line typically).
+* binary: one unsigned byte per sample, every heart rate fits (see HR_ELEM_TYPE).
+
+this module would be prefixed with `sr_`.
+*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define SR_READ_CHUNK (64 * 1024) // Bytes read from the stream at once
+
+typedef enum {
+    SR_FORMAT_TEXT = 0,
+    SR_FORMAT_BINARY,
+} sr_format_t;
+
+typedef struct {
+    FILE *stream;
+    sr_format_t format;
+    unsigned char chunk[SR_READ_CHUNK];
+    size_t chunk_len; // Bytes available in chunk
+    size_t chunk_pos; // Next byte to parse in chunk
+    bool eof;         // The stream is exhausted
+    bool error;       // A read error or a malformed text sample was found
+    long line;        // Current line (text format), for error reports
+} sr_reader_t;
+
+/**
+ * @brief Parse a format name ("text" or "binary").
+ *
+ * @param name Format name.
+ * @param format Pointer to store the format.
+ * @return int 0 on success, -1 if the name is unknown.
+ */
+int sr_parse_format(const char *name, sr_format_t *format);
+
+/**
+ * @brief Initialize a reader over an open stream. The stream is not closed by the reader.
+ *
+ * @param reader Reader to initialize.
+ * @param stream Stream to read from, opened in binary mode for SR_FORMAT_BINARY.
+ * @param format Format of the samples.
+ */
+void sr_init(sr_reader_t *reader, FILE *stream, sr_format_t format);
+
+/**
+ * @brief Read up to max samples.
+ *
+ * @param reader Reader.
+ * @param out Array receiving the samples.
+ * @param max Maximum number of samples to read.
+ * @return size_t Number of samples read, 0 at the end of the stream or on error (see `error`).
+ */
+size_t sr_read(sr_reader_t *reader, int *out, size_t max);
+
+#endif // __SAMPLE_READER_H__
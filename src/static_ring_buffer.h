@@ -0,0 +1,108 @@
+#ifndef __STATIC_RING_BUFFER_H__
+#define __STATIC_RING_BUFFER_H__
+/*
+A ring buffer whose capacity and element type are fixed at compile time, for targets with no heap:
+the storage lives inline in the struct, so a buffer is a plain global, static or stack object with
+no allocation and nothing to fail. A zeroed buffer is empty, so a static one needs no
+initialization call and costs nothing at startup.
+
+SRB_DEFINE(name, type, capacity) generates the struct `name_t` and `static inline` functions
+`name_add`, `name_remove`, ... with the same semantics as the `rb_` ones: adding to a full buffer
+overwrites the oldest element. Indices never need a division: a power of two capacity is masked,
+any other one wraps with a compare and subtract.
+
+    SRB_DEFINE(hr_window, uint8_t, 64)
+    static hr_window_t window_g; // or = SRB_INIT
+    hr_window_add(&window_g, 72);
+
+Not thread-safe, unlike `rb_t`: there is no lock, a buffer belongs to one thread (or is guarded by
+its user, e.g. with interrupts masked). `static_ring_buffer.hpp` has the same buffer as a C++
+template, `srb::RingBuffer<T, N>`.
+
+this module would be prefixed with `srb_`.
+*/
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+#define SRB_STATIC_ASSERT(cond, msg) static_assert(cond, msg)
+#else
+#define SRB_STATIC_ASSERT(cond, msg) _Static_assert(cond, msg)
+#endif
+
+// Initializer of an empty buffer, the same as zero initialization
+#define SRB_INIT { { 0 }, 0, 0 }
+
+// Whether n is a power of two, a constant expression
+#define SRB_IS_POW2(n) (((n) & ((n) - 1)) == 0)
+
+/**
+ * @brief Define the buffer type `name_t`, holding up to `capacity` elements of `type`, and its
+ *        functions:
+ *        - void name_add(name_t *rb, type value): add, overwriting the oldest element if full.
+ *        - bool name_remove(name_t *rb, type *value): remove the oldest element, value may be
+ *          NULL; false if empty.
+ *        - bool name_get_at(const name_t *rb, size_t index, type *value): read the element at
+ *          index (0 is the oldest) without removing it; false if out of range.
+ *        - bool name_get_last(const name_t *rb, type *value): read the newest element.
+ *        - size_t name_count(const name_t *rb), bool name_is_empty(const name_t *rb),
+ *          bool name_is_full(const name_t *rb), size_t name_capacity(void).
+ *        - void name_clear(name_t *rb).
+ */
+#define SRB_DEFINE(name, type, capacity)                                                           \
+    SRB_STATIC_ASSERT((capacity) > 0, #name ": the capacity must be positive");                    \
+                                                                                                   \
+    typedef struct {                                                                               \
+        type data[capacity];                                                                       \
+        size_t head;  /* Index of the oldest element */                                            \
+        size_t count; /* Number of elements */                                                     \
+    } name##_t;                                                                                    \
+                                                                                                   \
+    /* Index i < 2 * capacity into the storage */                                                  \
+    static inline size_t name##_wrap(size_t i) {                                                   \
+        if (SRB_IS_POW2((size_t)(capacity)))                                                       \
+            return i & ((size_t)(capacity) - 1);                                                   \
+        return (i >= (size_t)(capacity)) ? i - (size_t)(capacity) : i;                             \
+    }                                                                                              \
+                                                                                                   \
+    static inline size_t name##_capacity(void) { return (size_t)(capacity); }                      \
+    static inline size_t name##_count(const name##_t *rb) { return rb->count; }                    \
+    static inline bool name##_is_empty(const name##_t *rb) { return rb->count == 0; }              \
+    static inline bool name##_is_full(const name##_t *rb) {                                        \
+        return rb->count == (size_t)(capacity);                                                    \
+    }                                                                                              \
+    static inline void name##_clear(name##_t *rb) {                                                \
+        rb->head = 0;                                                                              \
+        rb->count = 0;                                                                             \
+    }                                                                                              \
+                                                                                                   \
+    static inline void name##_add(name##_t *rb, type value) {                                      \
+        rb->data[name##_wrap(rb->head + rb->count)] = value;                                       \
+        if (rb->count == (size_t)(capacity))                                                       \
+            rb->head = name##_wrap(rb->head + 1); /* overwrote the oldest */                       \
+        else                                                                                       \
+            rb->count++;                                                                           \
+    }                                                                                              \
+                                                                                                   \
+    static inline bool name##_remove(name##_t *rb, type *value) {                                  \
+        if (rb->count == 0)                                                                        \
+            return false;                                                                          \
+        if (value)                                                                                 \
+            *value = rb->data[rb->head];                                                           \
+        rb->head = name##_wrap(rb->head + 1);                                                      \
+        rb->count--;                                                                               \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    static inline bool name##_get_at(const name##_t *rb, size_t index, type *value) {              \
+        if (index >= rb->count || !value)                                                          \
+            return false;                                                                          \
+        *value = rb->data[name##_wrap(rb->head + index)];                                          \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    static inline bool name##_get_last(const name##_t *rb, type *value) {                          \
+        return rb->count > 0 && name##_get_at(rb, rb->count - 1, value);                           \
+    }
+
+#endif // __STATIC_RING_BUFFER_H__
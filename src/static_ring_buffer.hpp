@@ -0,0 +1,83 @@
+#ifndef __STATIC_RING_BUFFER_HPP__
+#define __STATIC_RING_BUFFER_HPP__
+/*
+C++ flavour of `static_ring_buffer.h`: a ring buffer of N elements of T with inline storage and
+the `rb_` semantics (adding to a full buffer overwrites the oldest element). The constructor is
+constexpr, so a global or static buffer is constant initialized, with no allocation and no
+constructor run at startup, and a power of two N wraps its indices with a mask.
+
+    static srb::RingBuffer<uint8_t, 64> window;
+    window.add(72);
+
+Not thread-safe, a buffer belongs to one thread.
+
+this module would be prefixed with `srb_`.
+*/
+#include <cstddef>
+
+namespace srb {
+
+template <typename T, std::size_t N>
+class RingBuffer {
+    static_assert(N > 0, "the capacity must be positive");
+
+public:
+    constexpr RingBuffer() : data_(), head_(0), count_(0) {}
+
+    static constexpr std::size_t capacity() { return N; }
+    constexpr std::size_t size() const { return count_; }
+    constexpr bool empty() const { return count_ == 0; }
+    constexpr bool full() const { return count_ == N; }
+
+    void clear() {
+        head_ = 0;
+        count_ = 0;
+    }
+
+    // Add an element, overwriting the oldest one if the buffer is full
+    void add(const T &value) {
+        data_[wrap(head_ + count_)] = value;
+        if (count_ == N)
+            head_ = wrap(head_ + 1);
+        else
+            count_++;
+    }
+
+    // Remove the oldest element, false if empty
+    bool remove(T *value = nullptr) {
+        if (count_ == 0)
+            return false;
+        if (value)
+            *value = data_[head_];
+        head_ = wrap(head_ + 1);
+        count_--;
+        return true;
+    }
+
+    // Element at index, 0 being the oldest, without bounds checking
+    const T &operator[](std::size_t index) const { return data_[wrap(head_ + index)]; }
+
+    // Element at index without removing it, false if out of range
+    bool get_at(std::size_t index, T *value) const {
+        if (index >= count_ || !value)
+            return false;
+        *value = (*this)[index];
+        return true;
+    }
+
+    bool get_last(T *value) const { return count_ > 0 && get_at(count_ - 1, value); }
+
+private:
+    // Index i < 2 * N into the storage; the condition is a constant, only one branch is compiled
+    static constexpr std::size_t wrap(std::size_t i) {
+        return (N & (N - 1)) == 0 ? (i & (N - 1)) : (i >= N ? i - N : i);
+    }
+
+    T data_[N];
+    std::size_t head_;
+    std::size_t count_;
+};
+
+} // namespace srb
+
+#endif // __STATIC_RING_BUFFER_HPP__
@@ -0,0 +1,123 @@
+#include "gtest/gtest.h"
+#include <cmath>
+#include <string>
+#include <vector>
+extern "C" {
+#include "../src/anomaly_detector.h"
+}
+
+// Window statistics of samples, as rb_get_stats reports them
+static rb_stats_t
+window_of(const std::vector<int> &samples) {
+    rb_stats_t stats = {};
+    stats.count = samples.size();
+    for (int s : samples)
+        stats.sum += s;
+    stats.mean = (double)stats.sum / (double)stats.count;
+    for (int s : samples)
+        stats.variance += (s - stats.mean) * (s - stats.mean);
+    stats.variance /= (double)stats.count;
+    stats.stddev = std::sqrt(stats.variance);
+    return stats;
+}
+
+// Test: threshold alerts are raised once per episode, when the condition starts
+TEST(AnomalyDetectorTest, ThresholdsAreEdgeTriggered) {
+    ad_detector_t detector;
+    ad_config_t config = {};
+    config.jump_bpm = 1000.0; // thresholds only
+    ASSERT_EQ(ad_init(&detector, &config), 0);
+
+    ad_event_t events[AD_MAX_EVENTS];
+    const int rates[] = { 70, 130, 140, 125, 80, 45, 40, 60, 121 };
+    std::vector<ad_kind_t> raised;
+    for (int rate : rates) {
+        size_t n = ad_process(&detector, rate, 70.0, nullptr, 0, events);
+        for (size_t i = 0; i < n; i++)
+            raised.push_back(events[i].kind);
+    }
+    std::vector<ad_kind_t> expected = { AD_TACHYCARDIA, AD_BRADYCARDIA, AD_TACHYCARDIA };
+    EXPECT_EQ(raised, expected);
+    EXPECT_EQ(detector.counts[AD_TACHYCARDIA], 2u);
+    EXPECT_EQ(detector.counts[AD_BRADYCARDIA], 1u);
+}
+
+// Test: jumps are measured from the EMA of the previous samples
+TEST(AnomalyDetectorTest, JumpFromPreviousEma) {
+    ad_detector_t detector;
+    ASSERT_EQ(ad_init(&detector, nullptr), 0);
+    ad_event_t events[AD_MAX_EVENTS];
+
+    EXPECT_EQ(ad_process(&detector, 110, 110.0, nullptr, 1, events), 0u); // no EMA before
+    EXPECT_EQ(ad_process(&detector, 80, 100.0, nullptr, 2, events), 0u);  // 30 is not above
+    ASSERT_EQ(ad_process(&detector, 60, 90.0, nullptr, 3, events), 1u);
+    EXPECT_EQ(events[0].kind, AD_JUMP);
+    EXPECT_EQ(events[0].time_ns, 3u);
+    EXPECT_EQ(events[0].heart_rate, 60);
+    EXPECT_DOUBLE_EQ(events[0].ema, 90.0);
+    EXPECT_DOUBLE_EQ(events[0].value, 40.0);
+    EXPECT_DOUBLE_EQ(events[0].threshold, AD_DEFAULT_JUMP_BPM);
+}
+
+// Test: the z-score is taken against the other samples of the window
+TEST(AnomalyDetectorTest, OutlierZScore) {
+    ad_detector_t detector;
+    ad_config_t config = {};
+    config.jump_bpm = 1000.0;
+    config.z_min_samples = 10;
+    ASSERT_EQ(ad_init(&detector, &config), 0);
+    ad_event_t events[AD_MAX_EVENTS];
+
+    // 20 samples alternating 70 and 72: mean 71, stddev 1
+    std::vector<int> window;
+    for (int i = 0; i < 20; i++)
+        window.push_back(70 + 2 * (i % 2));
+
+    window.push_back(74); // z = 3, not beyond
+    rb_stats_t stats = window_of(window);
+    EXPECT_EQ(ad_process(&detector, 74, 71.0, &stats, 0, events), 0u);
+
+    window.back() = 76; // z = 5
+    stats = window_of(window);
+    ASSERT_EQ(ad_process(&detector, 76, 71.0, &stats, 0, events), 1u);
+    EXPECT_EQ(events[0].kind, AD_OUTLIER);
+    EXPECT_NEAR(events[0].value, 5.0, 1e-9);
+
+    window.back() = 66; // z = -5
+    stats = window_of(window);
+    ASSERT_EQ(ad_process(&detector, 66, 71.0, &stats, 0, events), 1u);
+    EXPECT_NEAR(events[0].value, -5.0, 1e-9);
+
+    // Too few other samples, or all equal: no z-score
+    std::vector<int> small(10, 70);
+    small.push_back(90);
+    stats = window_of(small);
+    EXPECT_EQ(ad_process(&detector, 90, 71.0, &stats, 0, events), 0u);
+    std::vector<int> flat(30, 70);
+    flat.push_back(90);
+    stats = window_of(flat);
+    EXPECT_EQ(ad_process(&detector, 90, 71.0, &stats, 0, events), 0u);
+}
+
+// Test: alerts are formatted as single JSON lines
+TEST(AnomalyDetectorTest, FormatEvent) {
+    ad_event_t event = { AD_TACHYCARDIA, 3000000000ULL, 150, 82.1, 150.0, 120.0 };
+    char line[AD_EVENT_JSON_SIZE];
+    ASSERT_GT(ad_format_event(&event, line, sizeof(line)), 0);
+    EXPECT_EQ(std::string(line), "{\"time_ns\":3000000000,\"alert\":\"tachycardia\",\"heart_rate\":"
+                                 "150,\"ema\":82.10,\"value\":150.00,\"threshold\":120.00}\n");
+    EXPECT_EQ(ad_format_event(&event, line, 10), -1);
+    EXPECT_STREQ(ad_kind_name((ad_kind_t)42), "unknown");
+}
+
+// Test: inconsistent thresholds are rejected
+TEST(AnomalyDetectorTest, InvalidConfig) {
+    ad_detector_t detector;
+    ad_config_t config = {};
+    config.bradycardia_bpm = 130;
+    EXPECT_EQ(ad_init(&detector, &config), -1);
+    config.bradycardia_bpm = 0;
+    config.z_score = -1.0;
+    EXPECT_EQ(ad_init(&detector, &config), -1);
+    EXPECT_EQ(ad_init(nullptr, nullptr), -1);
+}
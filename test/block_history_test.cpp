@@ -0,0 +1,139 @@
+#include "gtest/gtest.h"
+#include <climits>
+#include <random>
+#include <vector>
+extern "C" {
+#include "../src/block_history.h"
+}
+
+static std::vector<int>
+roundtrip(const std::vector<int> &values, size_t *size = nullptr) {
+    std::vector<uint8_t> encoded(BH_MAX_ENCODED(values.size()));
+    size_t encoded_size = bh_encode(values.data(), values.size(), encoded.data());
+    EXPECT_GT(encoded_size, 0u);
+    EXPECT_LE(encoded_size + BH_PADDING, encoded.size());
+    if (size)
+        *size = encoded_size;
+
+    std::vector<int> decoded(BH_BLOCK_SAMPLES);
+    decoded.resize(bh_decode(encoded.data(), decoded.data()));
+    return decoded;
+}
+
+// Test: blocks of every shape decode to the encoded values
+TEST(BlockCodecTest, Roundtrip) {
+    std::mt19937 rng(3);
+    std::vector<std::vector<int>> blocks = {
+        { 72 },
+        std::vector<int>(BH_BLOCK_SAMPLES, 60),
+        { INT_MIN, INT_MAX, 0, -1, INT_MAX, INT_MIN },
+        { 44, 185, 44, 185 },
+    };
+    for (size_t n : { (size_t)2, (size_t)37, (size_t)BH_BLOCK_SAMPLES }) {
+        std::vector<int> walk(n), uniform(n), wide(n);
+        int value = 80;
+        for (size_t i = 0; i < n; i++) {
+            value += (int)(rng() % 3) - 1;
+            walk[i] = value;
+            uniform[i] = 44 + (int)(rng() % 142);
+            wide[i] = (int)rng();
+        }
+        blocks.push_back(walk);
+        blocks.push_back(uniform);
+        blocks.push_back(wide);
+    }
+
+    for (const auto &block : blocks)
+        EXPECT_EQ(roundtrip(block), block);
+}
+
+// Test: slowly changing values pack into their delta width, noisy ones into their range width
+TEST(BlockCodecTest, PicksNarrowerEncoding) {
+    size_t size;
+    roundtrip(std::vector<int>(BH_BLOCK_SAMPLES, 60), &size);
+    EXPECT_EQ(size, (size_t)BH_HEADER_SIZE);
+
+    std::vector<int> walk(BH_BLOCK_SAMPLES);
+    for (int i = 0; i < BH_BLOCK_SAMPLES; i++)
+        walk[i] = 70 + (i % 4 < 2 ? i % 4 : 4 - i % 4); // steps of -1, 0 or 1: 2 bits
+    roundtrip(walk, &size);
+    EXPECT_EQ(size, BH_HEADER_SIZE + ((size_t)BH_BLOCK_SAMPLES - 1) * 2 / 8 + 1);
+
+    std::vector<int> noisy(BH_BLOCK_SAMPLES);
+    for (int i = 0; i < BH_BLOCK_SAMPLES; i++)
+        noisy[i] = (i % 2) ? 100 : 100 + 15; // deltas of 15 take 5 bits, the range 4
+    roundtrip(noisy, &size);
+    EXPECT_EQ(size, BH_HEADER_SIZE + (size_t)BH_BLOCK_SAMPLES * 4 / 8);
+}
+
+// Test: invalid blocks are not encoded
+TEST(BlockCodecTest, InvalidArguments) {
+    uint8_t out[BH_MAX_ENCODED(BH_BLOCK_SAMPLES + 1)];
+    int values[BH_BLOCK_SAMPLES + 1] = { 0 };
+    EXPECT_EQ(bh_encode(values, 0, out), 0u);
+    EXPECT_EQ(bh_encode(values, BH_BLOCK_SAMPLES + 1, out), 0u);
+    EXPECT_EQ(bh_encode(nullptr, 1, out), 0u);
+    EXPECT_EQ(bh_encode(values, 1, nullptr), 0u);
+}
+
+// Test: reads return the retained samples in order, across sealed and open blocks
+TEST(BlockHistoryTest, ReadsRetainedSamples) {
+    bh_history_t *history = bh_create(4 * BH_BLOCK_SAMPLES);
+    ASSERT_NE(history, nullptr);
+    std::vector<int> all;
+    int value = 90;
+    std::mt19937 rng(11);
+    for (int i = 0; i < 10 * BH_BLOCK_SAMPLES + 50; i++) {
+        value += (int)(rng() % 5) - 2;
+        all.push_back(value);
+        ASSERT_EQ(bh_add(history, value), 0);
+    }
+
+    bh_stats_t stats;
+    ASSERT_EQ(bh_get_stats(history, &stats), 0);
+    EXPECT_EQ(stats.blocks, 4u);
+    EXPECT_EQ(stats.samples, 4u * BH_BLOCK_SAMPLES + 50);
+    EXPECT_EQ(stats.first_seq, 6u * BH_BLOCK_SAMPLES);
+    EXPECT_GT(stats.bits_per_sample, 0.0);
+    EXPECT_LT(stats.bits_per_sample, 4.0);
+
+    std::vector<int> out(all.size());
+    EXPECT_EQ(bh_read(history, stats.first_seq, out.data(), out.size()), stats.samples);
+    for (size_t i = 0; i < stats.samples; i++)
+        ASSERT_EQ(out[i], all[stats.first_seq + i]) << i;
+
+    // Unaligned starts and short reads
+    for (uint64_t seq : { stats.first_seq + 5, stats.first_seq + 300, all.size() - 60 }) {
+        size_t n = bh_read(history, seq, out.data(), 100);
+        EXPECT_EQ(n, std::min<size_t>(100, all.size() - seq));
+        for (size_t i = 0; i < n; i++)
+            ASSERT_EQ(out[i], all[seq + i]) << seq << " " << i;
+    }
+
+    // Dropped or not yet added
+    EXPECT_EQ(bh_read(history, stats.first_seq - 1, out.data(), 10), 0u);
+    EXPECT_EQ(bh_read(history, all.size(), out.data(), 10), 0u);
+    bh_destroy(history);
+}
+
+// Test: an empty history and invalid arguments
+TEST(BlockHistoryTest, EmptyAndInvalid) {
+    bh_history_t *history = bh_create(0);
+    ASSERT_NE(history, nullptr);
+    bh_stats_t stats;
+    ASSERT_EQ(bh_get_stats(history, &stats), 0);
+    EXPECT_EQ(stats.samples, 0u);
+    EXPECT_EQ(stats.bits_per_sample, 0.0);
+    int out[4];
+    EXPECT_EQ(bh_read(history, 0, out, 4), 0u);
+    EXPECT_EQ(bh_read(history, 0, nullptr, 4), 0u);
+    EXPECT_EQ(bh_add(nullptr, 1), -1);
+    EXPECT_EQ(bh_get_stats(nullptr, &stats), -1);
+    EXPECT_EQ(bh_get_stats(history, nullptr), -1);
+
+    bh_add(history, 7);
+    EXPECT_EQ(bh_read(history, 0, out, 4), 1u);
+    EXPECT_EQ(out[0], 7);
+    bh_destroy(history);
+    bh_destroy(nullptr);
+}
@@ -1,4 +1,8 @@
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
 extern "C" {
 #include "../src/ring_buffer.h"
 #include "../src/heart_rate_gen.h"
@@ -27,6 +31,63 @@ TEST_F(HeartRateTest, GenerateHeartRateWithinRange) {
     }
 }
 
+// Test: a seeded generator context is reproducible and covers the whole range
+TEST_F(HeartRateTest, SeededGeneratorReproducible) {
+    hr_rng_t first, second;
+    hr_rng_seed(&first, 1234);
+    hr_rng_seed(&second, 1234);
+
+    std::vector<int> histogram(HR_MAX_HEART_RATE + 1, 0);
+    for (int i = 0; i < 100000; i++) {
+        int heart_rate = hr_generate_heart_rate_r(&first);
+        ASSERT_EQ(heart_rate, hr_generate_heart_rate_r(&second));
+        ASSERT_GE(heart_rate, HR_MIN_HEART_RATE);
+        ASSERT_LE(heart_rate, HR_MAX_HEART_RATE);
+        histogram[heart_rate]++;
+    }
+    for (int value = HR_MIN_HEART_RATE; value <= HR_MAX_HEART_RATE; value++)
+        EXPECT_GT(histogram[value], 0) << "value " << value;
+
+    hr_rng_seed(&second, 4321);
+    int same = 0;
+    for (int i = 0; i < 100; i++)
+        same += (hr_generate_heart_rate_r(&first) == hr_generate_heart_rate_r(&second));
+    EXPECT_LT(same, 20); // different seeds give different streams
+}
+
+// Test: batch generation matches the single value stream
+TEST_F(HeartRateTest, GenerateBatchMatchesSingle) {
+    hr_rng_t batch_rng, single_rng;
+    hr_rng_seed(&batch_rng, 99);
+    hr_rng_seed(&single_rng, 99);
+
+    std::vector<int> batch(1000);
+    hr_generate_batch_r(&batch_rng, batch.data(), batch.size());
+    for (int value : batch)
+        ASSERT_EQ(value, hr_generate_heart_rate_r(&single_rng));
+
+    // The thread generator replays exactly once seeded
+    hr_seed(7);
+    hr_generate_batch(batch.data(), batch.size());
+    hr_seed(7);
+    for (int value : batch)
+        ASSERT_EQ(value, hr_generate_heart_rate());
+}
+
+// Test: each thread has its own generator, seeding one thread does not affect another
+TEST_F(HeartRateTest, ThreadLocalGenerators) {
+    std::vector<int> main_values(100), thread_values(100);
+    std::thread worker([&thread_values]() {
+        hr_seed(5);
+        hr_generate_batch(thread_values.data(), thread_values.size());
+    });
+    worker.join();
+
+    hr_seed(5);
+    hr_generate_batch(main_values.data(), main_values.size());
+    EXPECT_EQ(main_values, thread_values);
+}
+
 // Test hr_update_buffer with valid and invalid heart rate values
 TEST_F(HeartRateTest, UpdateBufferValidValues) {
     hr_update_buffer(50);
@@ -47,6 +108,21 @@ TEST_F(HeartRateTest, UpdateBufferValidValues) {
     EXPECT_EQ(element, 150);
 }
 
+// Test hr_init_buffer: the compact storage holds the whole heart rate range
+TEST_F(HeartRateTest, InitBufferCompactStorage) {
+    rb_free_buffer();
+    hr_init_buffer(2, NULL);
+
+    hr_update_buffer(HR_MIN_HEART_RATE);
+    hr_update_buffer(HR_MAX_HEART_RATE);
+
+    int element;
+    EXPECT_EQ(rb_get_element_at(0, &element), 0);
+    EXPECT_EQ(element, HR_MIN_HEART_RATE);
+    EXPECT_EQ(rb_get_last_element(&element), 0);
+    EXPECT_EQ(element, HR_MAX_HEART_RATE);
+}
+
 TEST_F(HeartRateTest, UpdateBufferInvalidValues) {
     hr_update_buffer(10);  // Below minimum heart rate
     hr_update_buffer(200); // Above maximum heart rate
@@ -63,8 +139,26 @@ TEST_F(HeartRateTest, CalculateEMABasic) {
     double smoothing_factor = 0.5;
     double ema = hr_calculate_ema(smoothing_factor);
 
-    // EMA for the first value should be initialized to the first value
-    EXPECT_NEAR(ema, 100, 1e-3); // Expect EMA around the latest value (simple logic)
+    // The EMA starts at the first value and folds in every later one: 60, 70, 85
+    EXPECT_NEAR(ema, 85, 1e-3);
+
+    // No new value, no change
+    EXPECT_NEAR(hr_calculate_ema(smoothing_factor), 85, 1e-3);
+}
+
+// Test: the EMA of the default buffer restarts from the first sample of a re-initialized buffer
+TEST_F(HeartRateTest, CalculateEMARestartsAfterReinit) {
+    hr_update_buffer(60);
+    hr_update_buffer(80);
+    EXPECT_NEAR(hr_calculate_ema(0.5), 70, 1e-3);
+
+    rb_free_buffer();
+    EXPECT_DOUBLE_EQ(hr_calculate_ema(0.5), -1.0);
+    rb_init_buffer(10);
+    hr_update_buffer(100);
+    EXPECT_NEAR(hr_calculate_ema(0.5), 100, 1e-3);
+    hr_update_buffer(120);
+    EXPECT_NEAR(hr_calculate_ema(0.5), 110, 1e-3);
 }
 
 TEST_F(HeartRateTest, CalculateEMAWithEmptyBuffer) {
@@ -88,14 +182,195 @@ TEST_F(HeartRateTest, CalculateEMAEdgeCases) {
 
 // Test integration of heart rate generator and EMA calculation
 TEST_F(HeartRateTest, GenerateAndUpdateAndCalculateEMA) {
+    double expected = 0.0;
     for (int i = 0; i < 5; i++) {
         int heart_rate = hr_generate_heart_rate();
         hr_update_buffer(heart_rate);
+        expected = (i == 0) ? heart_rate : 0.5 * heart_rate + 0.5 * expected;
     }
 
     EXPECT_FALSE(rb_is_empty());
 
-    double ema = hr_calculate_ema(0.5);
-    EXPECT_GT(ema, HR_MIN_HEART_RATE);
-    EXPECT_LT(ema, HR_MAX_HEART_RATE); // EMA should be in a valid range
+    // Every sample of this buffer is folded in, none of the previous tests' buffers
+    EXPECT_NEAR(hr_calculate_ema(0.5), expected, 1e-9);
+}
+
+// Test: every EMA of a bank matches a scalar EMA with its smoothing factor
+TEST_F(HeartRateTest, EmaBankMatchesScalar) {
+    const double alphas[] = { HR_EMA_FAST, HR_EMA_MEDIUM, HR_EMA_SLOW };
+    hr_ema_t ema;
+    ASSERT_EQ(hr_ema_init(&ema, alphas, 3), 0);
+    EXPECT_FALSE(ema.primed);
+
+    double reference[3] = { 0 };
+    hr_seed(7);
+    for (int i = 0; i < 1000; i++) {
+        int sample = hr_generate_heart_rate();
+        hr_ema_update(&ema, sample);
+        for (int k = 0; k < 3; k++)
+            reference[k] = (i == 0) ? sample
+                                    : alphas[k] * sample + (1.0 - alphas[k]) * reference[k];
+    }
+    for (int k = 0; k < 3; k++)
+        EXPECT_DOUBLE_EQ(ema.value[k], reference[k]);
+    for (int k = 3; k < HR_EMA_MAX_ALPHAS; k++)
+        EXPECT_EQ(ema.value[k], 0.0); // padding untouched
+}
+
+TEST_F(HeartRateTest, EmaBankBatchMatchesSingle) {
+    const double alphas[] = { 0.5, 0.25 };
+    hr_ema_t single, batch;
+    ASSERT_EQ(hr_ema_init(&single, alphas, 2), 0);
+    ASSERT_EQ(hr_ema_init(&batch, alphas, 2), 0);
+
+    std::vector<int> samples(257);
+    hr_seed(11);
+    hr_generate_batch(samples.data(), samples.size());
+    for (int sample : samples)
+        hr_ema_update(&single, sample);
+    hr_ema_update_batch(&batch, samples.data(), 100);
+    hr_ema_update_batch(&batch, samples.data() + 100, samples.size() - 100);
+
+    EXPECT_DOUBLE_EQ(batch.value[0], single.value[0]);
+    EXPECT_DOUBLE_EQ(batch.value[1], single.value[1]);
+}
+
+TEST_F(HeartRateTest, EmaBankInvalidInit) {
+    hr_ema_t ema;
+    const double alphas[HR_EMA_MAX_ALPHAS + 1] = { 0.1, 0.0, 1.5 };
+    EXPECT_EQ(hr_ema_init(&ema, alphas, 0), -1);
+    EXPECT_EQ(hr_ema_init(&ema, alphas, HR_EMA_MAX_ALPHAS + 1), -1);
+    EXPECT_EQ(hr_ema_init(&ema, alphas, 2), -1);       // 0 is not a smoothing factor
+    EXPECT_EQ(hr_ema_init(&ema, alphas + 2, 1), -1);   // above 1
+    EXPECT_EQ(hr_ema_init(nullptr, alphas, 1), -1);
+    EXPECT_EQ(hr_ema_init(&ema, alphas, 1), 0);
+}
+
+// Test: contexts are independent, e.g. one per patient or per thread
+TEST_F(HeartRateTest, EmaBankIndependentContexts) {
+    const double alpha = HR_EMA_MEDIUM;
+    hr_ema_t first, second;
+    ASSERT_EQ(hr_ema_init(&first, &alpha, 1), 0);
+    ASSERT_EQ(hr_ema_init(&second, &alpha, 1), 0);
+    hr_ema_update(&first, 60);
+    hr_ema_update(&second, 120);
+    hr_ema_update(&first, 70);
+    EXPECT_DOUBLE_EQ(first.value[0], 61.0);
+    EXPECT_DOUBLE_EQ(second.value[0], 120.0);
+}
+
+// Test: a consumer falling behind still folds in every sample, in order
+TEST_F(HeartRateTest, EmaConsumeFoldsEverySample) {
+    const double alpha = HR_EMA_MEDIUM;
+    hr_ema_t consumed, reference;
+    ASSERT_EQ(hr_ema_init(&consumed, &alpha, 1), 0);
+    ASSERT_EQ(hr_ema_init(&reference, &alpha, 1), 0);
+
+    uint64_t cursor = 0, lost = 0;
+    hr_seed(3);
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i <= round % 7; i++) { // 1 to 7 samples between calls, buffer holds 10
+            int sample = hr_generate_heart_rate();
+            hr_update_buffer(sample);
+            hr_ema_update(&reference, sample);
+        }
+        hr_ema_consume_r(&consumed, rb_default(), &cursor, &lost);
+        EXPECT_EQ(lost, 0u);
+        EXPECT_DOUBLE_EQ(consumed.value[0], reference.value[0]);
+    }
+}
+
+// Test: samples overwritten before the consumer caught up are reported
+TEST_F(HeartRateTest, EmaConsumeReportsLostSamples) {
+    const double alpha = HR_EMA_FAST;
+    hr_ema_t ema;
+    ASSERT_EQ(hr_ema_init(&ema, &alpha, 1), 0);
+
+    uint64_t cursor = 0, lost = 0;
+    for (int i = 0; i < 25; i++)
+        hr_update_buffer(60 + i);
+    EXPECT_EQ(hr_ema_consume_r(&ema, rb_default(), &cursor, &lost), 10u);
+    EXPECT_EQ(lost, 15u); // buffer of 10
+    EXPECT_EQ(cursor, 25u);
+
+    EXPECT_EQ(hr_ema_consume_r(&ema, rb_default(), &cursor, &lost), 0u);
+    EXPECT_EQ(lost, 0u);
+}
+
+// Test: the fixed point EMA stays within its documented error bound of the double EMA
+TEST_F(HeartRateTest, FixedPointEmaErrorBound) {
+    const struct {
+        uint32_t num, den; // α = num / den, den a power of two for the shift form
+        unsigned shift;
+    } cases[] = { { 1, 2, 1 }, { 1, 8, 3 }, { 1, 128, 7 }, { 3, 10, 0 }, { 1, 10, 0 }, { 1, 100, 0 } };
+
+    hr_rng_t rng;
+    hr_rng_seed(&rng, 11);
+    std::vector<int> samples(20000);
+    hr_generate_batch_r(&rng, samples.data(), samples.size());
+
+    for (const auto &c : cases) {
+        hr_ema_fix_t fixed;
+        if (c.shift) {
+            ASSERT_EQ(hr_ema_fix_init_shift(&fixed, c.shift), 0);
+        } else {
+            ASSERT_EQ(hr_ema_fix_init_ratio(&fixed, c.num, c.den), 0);
+        }
+
+        const double alpha = (double)c.num / c.den;
+        hr_ema_t reference;
+        ASSERT_EQ(hr_ema_init(&reference, &alpha, 1), 0);
+
+        // Rounding error, plus the effect of a rounded α
+        double alpha_fixed = HR_FIX_TO_DOUBLE(fixed.alpha);
+        double bound = (0.5 / HR_FIX_ONE +
+                        std::fabs(alpha_fixed - alpha) * (HR_MAX_HEART_RATE - HR_MIN_HEART_RATE)) /
+                       alpha_fixed;
+        double worst = 0.0;
+        for (int sample : samples) {
+            hr_ema_fix_update(&fixed, sample);
+            hr_ema_update(&reference, sample);
+            worst = std::max(worst, std::fabs(HR_FIX_TO_DOUBLE(fixed.value) - reference.value[0]));
+        }
+        EXPECT_LE(worst, bound) << c.num << "/" << c.den;
+        EXPECT_LT(worst, 0.02) << c.num << "/" << c.den; // well below a beat per minute
+    }
+}
+
+// Test: fixed point rounding is to nearest, ties away from zero, the same up and down
+TEST_F(HeartRateTest, FixedPointEmaRounding) {
+    hr_ema_fix_t ema;
+    ASSERT_EQ(hr_ema_fix_init_shift(&ema, HR_FIX_FRAC_BITS), 0); // α is one unit
+    hr_ema_fix_update(&ema, 100);
+    EXPECT_EQ(ema.value, 100 * HR_FIX_ONE);
+    hr_ema_fix_update(&ema, 101); // + 1 unit exactly
+    EXPECT_EQ(ema.value, 100 * HR_FIX_ONE + 1);
+
+    ASSERT_EQ(hr_ema_fix_init_shift(&ema, 1), 0);
+    ema.value = 1; // ties: (0 - 1) / 2 and (2 - 1) / 2
+    ema.primed = true;
+    hr_ema_fix_update(&ema, 0);
+    EXPECT_EQ(ema.value, 0); // 1 - 0.5 rounded away from zero
+    ema.value = -1;
+    hr_ema_fix_update(&ema, 0);
+    EXPECT_EQ(ema.value, 0); // -1 + 0.5
+
+    // Batch and single updates agree, and a constant input is approached until a step rounds to
+    // 0, within half a unit / α
+    hr_ema_fix_t batch, single;
+    ASSERT_EQ(hr_ema_fix_init_ratio(&batch, 1, 10), 0);
+    ASSERT_EQ(hr_ema_fix_init_ratio(&single, 1, 10), 0);
+    EXPECT_EQ(batch.alpha, (HR_FIX_ONE + 5) / 10);
+    std::vector<int> samples(300, 72);
+    samples[0] = 150;
+    hr_ema_fix_update_batch(&batch, samples.data(), samples.size());
+    for (int sample : samples)
+        hr_ema_fix_update(&single, sample);
+    EXPECT_EQ(batch.value, single.value);
+    EXPECT_LE(std::abs(batch.value - 72 * HR_FIX_ONE), 5);
+
+    EXPECT_EQ(hr_ema_fix_init_shift(&ema, HR_FIX_FRAC_BITS + 1), -1);
+    EXPECT_EQ(hr_ema_fix_init_ratio(&ema, 0, 10), -1);
+    EXPECT_EQ(hr_ema_fix_init_ratio(&ema, 11, 10), -1);
+    EXPECT_EQ(hr_ema_fix_init_ratio(&ema, 1, 1u << 31), -1); // rounds to 0
 }
@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+extern "C" {
+#include "../src/latency_histogram.h"
+}
+
+// Test fixture class
+class LatencyHistogramTest : public ::testing::Test {
+  protected:
+    lh_histogram_t histogram;
+
+    void SetUp() override { lh_init(&histogram); }
+};
+
+TEST_F(LatencyHistogramTest, Empty) {
+    EXPECT_EQ(histogram.total, 0u);
+    EXPECT_EQ(lh_percentile(&histogram, 50.0), 0u);
+    EXPECT_EQ(lh_mean(&histogram), 0.0);
+}
+
+TEST_F(LatencyHistogramTest, SmallValuesAreExact) {
+    for (uint64_t value = 0; value < LH_SUB_BUCKETS; value++)
+        lh_record(&histogram, value);
+    EXPECT_EQ(lh_percentile(&histogram, 0.0), 0u);
+    EXPECT_EQ(lh_percentile(&histogram, 50.0), LH_SUB_BUCKETS / 2 - 1);
+    EXPECT_EQ(lh_percentile(&histogram, 100.0), LH_SUB_BUCKETS - 1);
+    EXPECT_DOUBLE_EQ(lh_mean(&histogram), (LH_SUB_BUCKETS - 1) / 2.0);
+}
+
+TEST_F(LatencyHistogramTest, ExtremeValues) {
+    lh_record(&histogram, UINT64_MAX);
+    lh_record(&histogram, 1);
+    EXPECT_EQ(histogram.min, 1u);
+    EXPECT_EQ(histogram.max, UINT64_MAX);
+    EXPECT_EQ(lh_percentile(&histogram, 100.0), UINT64_MAX);
+    EXPECT_EQ(lh_percentile(&histogram, 10.0), 1u);
+}
+
+// Test: percentiles are within the bucket precision of the exact ones
+TEST_F(LatencyHistogramTest, PercentilesWithinPrecision) {
+    std::mt19937_64 rng(42);
+    std::lognormal_distribution<double> latency(9.0, 1.5); // ~8us median, long tail
+    std::vector<uint64_t> values;
+    for (int i = 0; i < 100000; i++) {
+        uint64_t value = (uint64_t)latency(rng);
+        values.push_back(value);
+        lh_record(&histogram, value);
+    }
+    std::sort(values.begin(), values.end());
+
+    const double precision = 1.0 / (LH_SUB_BUCKETS / 2);
+    for (double p : { 1.0, 25.0, 50.0, 90.0, 99.0, 99.9, 100.0 }) {
+        size_t rank = std::max<size_t>(1, (size_t)(p / 100.0 * values.size() + 0.5));
+        uint64_t exact = values[rank - 1];
+        uint64_t reported = lh_percentile(&histogram, p);
+        EXPECT_GE(reported, exact) << "p" << p;
+        EXPECT_LE((double)reported, (double)exact * (1.0 + precision) + 1.0) << "p" << p;
+    }
+    EXPECT_EQ(histogram.max, values.back());
+}
+
+TEST_F(LatencyHistogramTest, Merge) {
+    lh_histogram_t other;
+    lh_init(&other);
+    for (uint64_t value = 1; value <= 1000; value++)
+        lh_record(value % 2 ? &histogram : &other, value * 1000);
+
+    lh_merge(&histogram, &other);
+    EXPECT_EQ(histogram.total, 1000u);
+    EXPECT_EQ(histogram.min, 1000u);
+    EXPECT_EQ(histogram.max, 1000000u);
+    EXPECT_DOUBLE_EQ(lh_mean(&histogram), 500500.0);
+
+    uint64_t median = lh_percentile(&histogram, 50.0);
+    EXPECT_GE(median, 500000u);
+    EXPECT_LE(median, 500000u * 1.04);
+}
@@ -0,0 +1,182 @@
+#include "gtest/gtest.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+extern "C" {
+#include "../src/output_writer.h"
+}
+
+// Test fixture class, the writer output goes to a temporary file read back after ow_destroy
+class OutputWriterTest : public ::testing::Test {
+  protected:
+    FILE *stream = nullptr;
+
+    void SetUp() override {
+        stream = tmpfile();
+        ASSERT_NE(stream, nullptr);
+    }
+
+    void TearDown() override { fclose(stream); }
+
+    std::string Contents() {
+        std::string content;
+        rewind(stream);
+        char chunk[4096];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), stream)) > 0)
+            content.append(chunk, n);
+        return content;
+    }
+};
+
+TEST_F(OutputWriterTest, ParseFormat) {
+    ow_format_t format;
+    EXPECT_EQ(ow_parse_format("text", &format), 0);
+    EXPECT_EQ(format, OW_FORMAT_TEXT);
+    EXPECT_EQ(ow_parse_format("binary", &format), 0);
+    EXPECT_EQ(format, OW_FORMAT_BINARY);
+    EXPECT_EQ(ow_parse_format("json", &format), -1);
+}
+
+TEST_F(OutputWriterTest, InvalidConfig) {
+    ow_config_t config = {};
+    EXPECT_EQ(ow_create(&config), nullptr); // no stream
+    config.stream = stream;
+    config.format = (ow_format_t)7;
+    EXPECT_EQ(ow_create(&config), nullptr);
+    EXPECT_EQ(ow_create(nullptr), nullptr);
+    ow_destroy(nullptr); // no effect
+}
+
+TEST_F(OutputWriterTest, TextFormat) {
+    ow_config_t config = {};
+    config.stream = stream;
+    config.timestamps = true;
+    ow_writer_t *writer = ow_create(&config);
+    ASSERT_NE(writer, nullptr);
+
+    ow_record_t first = { 1500000000ULL, 72, 72.0 };
+    ow_record_t second = { 2000000000ULL, 80, 72.8 };
+    EXPECT_TRUE(ow_write(writer, &first));
+    EXPECT_TRUE(ow_write(writer, &second));
+    ow_destroy(writer);
+
+    EXPECT_EQ(Contents(), "[1.500000] New Heart Rate: 72, Current EMA: 72.00\n"
+                          "[2.000000] New Heart Rate: 80, Current EMA: 72.80\n");
+}
+
+TEST_F(OutputWriterTest, TextFormatWithoutTimestamps) {
+    ow_config_t config = {};
+    config.stream = stream;
+    ow_writer_t *writer = ow_create(&config);
+    ASSERT_NE(writer, nullptr);
+    ow_record_t record = { 5, 60, 61.25 };
+    EXPECT_TRUE(ow_write(writer, &record));
+    ow_destroy(writer);
+
+    EXPECT_EQ(Contents(), "New Heart Rate: 60, Current EMA: 61.25\n");
+}
+
+TEST_F(OutputWriterTest, BinaryFormat) {
+    ow_config_t config = {};
+    config.stream = stream;
+    config.format = OW_FORMAT_BINARY;
+    ow_writer_t *writer = ow_create(&config);
+    ASSERT_NE(writer, nullptr);
+    ow_record_t record = { 0x0102030405060708ULL, 185, 100.5 };
+    EXPECT_TRUE(ow_write(writer, &record));
+    ow_destroy(writer);
+
+    std::string content = Contents();
+    ASSERT_EQ(content.size(), (size_t)OW_BINARY_RECORD_SIZE);
+    const unsigned char *bytes = (const unsigned char *)content.data();
+    for (int i = 0; i < 8; i++)
+        EXPECT_EQ(bytes[i], 8 - i); // little endian timestamp
+    uint32_t ema_bits = 0;
+    for (int i = 0; i < 4; i++)
+        ema_bits |= (uint32_t)bytes[8 + i] << (8 * i);
+    float ema;
+    memcpy(&ema, &ema_bits, sizeof(ema));
+    EXPECT_FLOAT_EQ(ema, 100.5f);
+    EXPECT_EQ(bytes[12], 185);
+}
+
+// Test: a blocking writer keeps every record, in order, through many queue wraps
+TEST_F(OutputWriterTest, BlockingKeepsEverything) {
+    ow_config_t config = {};
+    config.stream = stream;
+    config.format = OW_FORMAT_BINARY;
+    config.capacity = 8;
+    config.block_when_full = true;
+    ow_writer_t *writer = ow_create(&config);
+    ASSERT_NE(writer, nullptr);
+
+    const int records = 2000;
+    for (int i = 0; i < records; i++) {
+        ow_record_t record = { (uint64_t)i, 44 + i % 100, 0.0 };
+        ASSERT_TRUE(ow_write(writer, &record));
+    }
+    EXPECT_EQ(ow_dropped(writer), 0u);
+    ow_destroy(writer);
+
+    std::string content = Contents();
+    ASSERT_EQ(content.size(), (size_t)records * OW_BINARY_RECORD_SIZE);
+    for (int i = 0; i < records; i++) {
+        const unsigned char *bytes =
+            (const unsigned char *)content.data() + (size_t)i * OW_BINARY_RECORD_SIZE;
+        ASSERT_EQ(bytes[0] | bytes[1] << 8 | bytes[2] << 16, i);
+        ASSERT_EQ(bytes[12], 44 + i % 100);
+    }
+}
+
+// Test: an idle consumer is woken by the next record, without waiting for ow_destroy
+TEST_F(OutputWriterTest, WakesOnRecordAfterIdle) {
+    ow_config_t config = {};
+    config.stream = stream;
+    config.format = OW_FORMAT_BINARY;
+    ow_writer_t *writer = ow_create(&config);
+    ASSERT_NE(writer, nullptr);
+
+    for (int i = 1; i <= 5; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20)); // the consumer goes to sleep
+        ow_record_t record = { (uint64_t)i, 70, 70.0 };
+        ASSERT_TRUE(ow_write(writer, &record));
+
+        // The file size is read without touching the stream position the writer uses
+        struct stat st = {};
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (fstat(fileno(stream), &st) == 0 && st.st_size < i * OW_BINARY_RECORD_SIZE &&
+               std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        ASSERT_EQ(st.st_size, i * OW_BINARY_RECORD_SIZE);
+    }
+    ow_destroy(writer);
+}
+
+// Test: a non blocking writer drops what does not fit and accounts for it
+TEST_F(OutputWriterTest, DroppingAccountsForEverything) {
+    ow_config_t config = {};
+    config.stream = stream;
+    config.capacity = 2;
+    ow_writer_t *writer = ow_create(&config);
+    ASSERT_NE(writer, nullptr);
+
+    const int records = 20000;
+    int queued = 0;
+    for (int i = 0; i < records; i++) {
+        ow_record_t record = { (uint64_t)i, 70, 70.0 };
+        queued += ow_write(writer, &record) ? 1 : 0;
+    }
+    EXPECT_EQ(ow_dropped(writer), (uint64_t)(records - queued));
+    ow_destroy(writer);
+
+    std::string content = Contents();
+    size_t lines = 0;
+    for (char c : content)
+        lines += (c == '\n');
+    EXPECT_EQ(lines, (size_t)queued);
+}
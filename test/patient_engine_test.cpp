@@ -0,0 +1,143 @@
+#include "gtest/gtest.h"
+#include <vector>
+extern "C" {
+#include "../src/heart_rate_gen.h"
+#include "../src/patient_engine.h"
+}
+
+// Test: every patient ends with the EMAs of its own sample stream, processed in order
+TEST(PatientEngineTest, MatchesSequentialReference) {
+    const size_t patients = 200, batch = 16, ticks = 50;
+    pe_config_t config = {};
+    config.patients = patients;
+    config.workers = 4;
+    config.buffer_size = 64;
+    config.batch = batch;
+    config.seed = 42;
+    pe_engine_t *engine = pe_create(&config);
+    ASSERT_NE(engine, nullptr);
+    EXPECT_EQ(pe_workers(engine), 4u);
+
+    pe_stats_t stats;
+    ASSERT_EQ(pe_run(engine, ticks / 2, &stats), 0);
+    ASSERT_EQ(pe_run(engine, ticks - ticks / 2, &stats), 0); // runs continue
+    EXPECT_EQ(stats.ticks, ticks - ticks / 2);
+    EXPECT_EQ(stats.samples, patients * batch * (ticks - ticks / 2));
+    EXPECT_EQ(stats.lost, 0u);
+    EXPECT_GT(stats.samples_per_second, 0.0);
+
+    const double alphas[] = { HR_EMA_FAST, HR_EMA_MEDIUM, HR_EMA_SLOW };
+    for (size_t p = 0; p < patients; p++) {
+        hr_rng_t rng;
+        hr_rng_seed(&rng, 42 + p);
+        hr_ema_t reference;
+        hr_ema_init(&reference, alphas, 3);
+        std::vector<int> samples(batch);
+        for (size_t t = 0; t < ticks; t++) {
+            hr_generate_batch_r(&rng, samples.data(), batch);
+            hr_ema_update_batch(&reference, samples.data(), batch);
+        }
+
+        double ema[3];
+        ASSERT_EQ(pe_get_ema(engine, p, ema), 0);
+        for (int i = 0; i < 3; i++)
+            ASSERT_DOUBLE_EQ(ema[i], reference.value[i]) << "patient " << p;
+    }
+    pe_destroy(engine);
+}
+
+// Test: the result does not depend on the number of workers nor on who processed a chunk
+TEST(PatientEngineTest, IndependentOfWorkers) {
+    std::vector<std::vector<double>> results;
+    for (size_t workers : { 1, 3, 8 }) {
+        pe_config_t config = {};
+        config.patients = 1000;
+        config.workers = workers;
+        config.buffer_size = 32;
+        config.seed = 7;
+        config.pin = true;
+        pe_engine_t *engine = pe_create(&config);
+        ASSERT_NE(engine, nullptr);
+        ASSERT_EQ(pe_run(engine, 20, nullptr), 0);
+
+        std::vector<double> emas;
+        for (size_t p = 0; p < config.patients; p++) {
+            double ema[3];
+            ASSERT_EQ(pe_get_ema(engine, p, ema), 0);
+            emas.insert(emas.end(), ema, ema + 3);
+        }
+        results.push_back(emas);
+        pe_destroy(engine);
+    }
+    EXPECT_EQ(results[0], results[1]);
+    EXPECT_EQ(results[0], results[2]);
+}
+
+// Test: replayed patients read the recording from their own offset, a batch larger than the
+// buffer loses samples
+TEST(PatientEngineTest, ReplayAndLostSamples) {
+    std::vector<int> recording(100, 70);
+    for (size_t i = 50; i < 100; i++)
+        recording[i] = 120;
+    const double alpha = 1.0; // the EMA is the last sample
+    pe_config_t config = {};
+    config.patients = 2;
+    config.workers = 2;
+    config.buffer_size = 8;
+    config.batch = 10;
+    config.alphas = &alpha;
+    config.alpha_count = 1;
+    config.replay = recording.data();
+    config.replay_len = recording.size();
+    pe_engine_t *engine = pe_create(&config);
+    ASSERT_NE(engine, nullptr);
+    EXPECT_EQ(pe_workers(engine), 1u); // one chunk of patients
+
+    double ema;
+    EXPECT_EQ(pe_get_ema(engine, 0, &ema), -1); // no sample yet
+    pe_stats_t stats;
+    ASSERT_EQ(pe_run(engine, 1, &stats), 0);
+    EXPECT_EQ(stats.lost, 2u * 2u);
+    ASSERT_EQ(pe_get_ema(engine, 0, &ema), 0);
+    EXPECT_EQ(ema, 70.0);
+    ASSERT_EQ(pe_get_ema(engine, 1, &ema), 0); // starts half way through the recording
+    EXPECT_EQ(ema, 120.0);
+
+    ASSERT_EQ(pe_run(engine, 5, &stats), 0); // patient 1 wraps around to the start
+    ASSERT_EQ(pe_get_ema(engine, 0, &ema), 0);
+    EXPECT_EQ(ema, 120.0);
+    ASSERT_EQ(pe_get_ema(engine, 1, &ema), 0);
+    EXPECT_EQ(ema, 70.0);
+    pe_destroy(engine);
+}
+
+// Test: invalid configurations and arguments are rejected
+TEST(PatientEngineTest, InvalidUse) {
+    pe_config_t config = {};
+    config.buffer_size = 8;
+    EXPECT_EQ(pe_create(&config), nullptr); // no patient
+    config.patients = 4;
+    config.buffer_size = 0;
+    EXPECT_EQ(pe_create(&config), nullptr);
+    config.buffer_size = 8;
+    const double alpha = 2.0;
+    config.alphas = &alpha;
+    config.alpha_count = 1;
+    EXPECT_EQ(pe_create(&config), nullptr);
+    config.alphas = nullptr;
+    const int recording[] = { 70 };
+    config.replay = recording;
+    EXPECT_EQ(pe_create(&config), nullptr); // empty recording
+    EXPECT_EQ(pe_create(nullptr), nullptr);
+
+    config.replay = nullptr;
+    pe_engine_t *engine = pe_create(&config);
+    ASSERT_NE(engine, nullptr);
+    double ema[3];
+    EXPECT_EQ(pe_get_ema(engine, 4, ema), -1);
+    EXPECT_EQ(pe_get_ema(engine, 0, nullptr), -1);
+    EXPECT_EQ(pe_run(nullptr, 1, nullptr), -1);
+    EXPECT_EQ(pe_workers(nullptr), 0u);
+    pe_destroy(engine);
+    pe_destroy(nullptr);
+}
@@ -1,4 +1,16 @@
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
 extern "C" { // This allows C++ to link with C code
 #include "../src/ring_buffer.h"
 }
@@ -149,3 +161,1260 @@ TEST_F(RingBufferTest, GetLastElement) {
 TEST_F(RingBufferTest, GetLastElementNullPointer) {
     EXPECT_EQ(rb_get_last_element(nullptr), -1); // Should fail when passed a null pointer
 }
+
+// Test fixture for the handle based API
+class RingBufferHandleTest: public ::testing::Test {
+  protected:
+    void SetUp() override {
+        rb = rb_create(5);
+        ASSERT_NE(rb, nullptr);
+    }
+
+    void TearDown() override {
+        rb_destroy(rb);
+    }
+
+    rb_t *rb = nullptr;
+};
+
+// Test: invalid sizes are rejected
+TEST_F(RingBufferHandleTest, CreateInvalidSize) {
+    EXPECT_EQ(rb_create(0), nullptr);
+    EXPECT_EQ(rb_create(-3), nullptr);
+}
+
+// Test: basic FIFO and overwrite behavior through a handle
+TEST_F(RingBufferHandleTest, AddRemoveOverwrite) {
+    EXPECT_TRUE(rb_is_empty_r(rb));
+    for (int i = 1; i <= 6; i++)
+        rb_add_element_r(rb, i); // 6 overwrites 1
+    EXPECT_TRUE(rb_is_full_r(rb));
+    EXPECT_EQ(rb_count_r(rb), 5u);
+    EXPECT_EQ(rb_size_r(rb), 5u);
+
+    int element;
+    EXPECT_EQ(rb_get_last_element_r(rb, &element), 0);
+    EXPECT_EQ(element, 6);
+    EXPECT_EQ(rb_get_element_at_r(rb, 0, &element), 0);
+    EXPECT_EQ(element, 2);
+
+    EXPECT_TRUE(rb_remove_element_r(rb, &element));
+    EXPECT_EQ(element, 2);
+    EXPECT_EQ(rb_count_r(rb), 4u);
+}
+
+// Test: independent instances do not share state with each other or the default instance
+TEST_F(RingBufferHandleTest, IndependentInstances) {
+    rb_t *other = rb_create(3);
+    ASSERT_NE(other, nullptr);
+    rb_init_buffer(4);
+
+    rb_add_element_r(rb, 1);
+    rb_add_element_r(other, 2);
+    rb_add_element(3);
+
+    int element;
+    EXPECT_EQ(rb_get_last_element_r(rb, &element), 0);
+    EXPECT_EQ(element, 1);
+    EXPECT_EQ(rb_get_last_element_r(other, &element), 0);
+    EXPECT_EQ(element, 2);
+    EXPECT_EQ(rb_get_last_element_r(rb_default(), &element), 0);
+    EXPECT_EQ(element, 3);
+
+    rb_free_buffer();
+    EXPECT_EQ(rb_default(), nullptr);
+    rb_destroy(other);
+}
+
+// Test: NULL handles are handled gracefully
+TEST_F(RingBufferHandleTest, NullHandle) {
+    int element;
+    rb_add_element_r(nullptr, 1);
+    EXPECT_FALSE(rb_remove_element_r(nullptr, &element));
+    EXPECT_FALSE(rb_is_empty_r(nullptr));
+    EXPECT_EQ(rb_get_element_at_r(nullptr, 0, &element), -1);
+    EXPECT_EQ(rb_count_r(nullptr), 0u);
+    rb_destroy(nullptr);
+}
+
+// Test fixture for the lock-free single-producer/single-consumer mode
+class RingBufferSpscTest: public ::testing::Test {
+  protected:
+    void SetUp() override {
+        rb_config_t config = {};
+        config.size = 1000; // rounded up to 1024
+        config.mode = RB_MODE_SPSC;
+        rb = rb_create_ex(&config);
+        ASSERT_NE(rb, nullptr);
+    }
+
+    void TearDown() override {
+        rb_destroy(rb);
+    }
+
+    rb_t *rb = nullptr;
+};
+
+// Test: the capacity is rounded up to a power of two
+TEST_F(RingBufferSpscTest, PowerOfTwoCapacity) {
+    EXPECT_EQ(rb_size_r(rb), 1024u);
+    EXPECT_TRUE(rb_is_empty_r(rb));
+}
+
+// Test: single threaded FIFO and overwrite behavior matches the locked mode
+TEST_F(RingBufferSpscTest, FifoAndOverwrite) {
+    for (int i = 0; i < 1024 + 3; i++)
+        rb_add_element_r(rb, i); // 0, 1, 2 are overwritten
+    EXPECT_TRUE(rb_is_full_r(rb));
+    EXPECT_EQ(rb_count_r(rb), 1024u);
+
+    int element;
+    EXPECT_EQ(rb_get_last_element_r(rb, &element), 0);
+    EXPECT_EQ(element, 1026);
+    EXPECT_EQ(rb_get_element_at_r(rb, 1, &element), 0);
+    EXPECT_EQ(element, 4);
+    EXPECT_EQ(rb_get_element_at_r(rb, 1024, &element), -1);
+
+    for (int i = 3; i < 1024 + 3; i++) {
+        ASSERT_TRUE(rb_remove_element_r(rb, &element));
+        ASSERT_EQ(element, i);
+    }
+    EXPECT_FALSE(rb_remove_element_r(rb, &element));
+    EXPECT_TRUE(rb_is_empty_r(rb));
+}
+
+// Test: a producer thread that never outruns the consumer delivers every element in order
+TEST_F(RingBufferSpscTest, ProducerConsumerLossless) {
+    const int total = 100000;
+    std::thread producer([this, total]() {
+        for (int i = 0; i < total; i++) {
+            while (rb_is_full_r(rb))
+                std::this_thread::yield();
+            rb_add_element_r(rb, i);
+        }
+    });
+
+    int expected = 0;
+    while (expected < total) {
+        int element;
+        if (rb_remove_element_r(rb, &element)) {
+            ASSERT_EQ(element, expected);
+            expected++;
+        }
+    }
+    producer.join();
+    EXPECT_TRUE(rb_is_empty_r(rb));
+}
+
+// Test: with a free running producer the consumer may lose the oldest elements, but it must never
+// see a duplicated, reordered or torn element
+TEST_F(RingBufferSpscTest, ProducerConsumerOverwrite) {
+    const int total = 100000;
+    std::atomic<bool> done(false);
+    std::thread producer([this, total, &done]() {
+        for (int i = 0; i < total; i++)
+            rb_add_element_r(rb, i);
+        done.store(true);
+    });
+
+    int previous = -1;
+    int received = 0;
+    for (;;) {
+        bool producer_done = done.load();
+        int element;
+        while (rb_remove_element_r(rb, &element)) {
+            ASSERT_GT(element, previous);
+            ASSERT_LT(element, total);
+            previous = element;
+            received++;
+        }
+        if (producer_done)
+            break;
+    }
+    producer.join();
+    EXPECT_EQ(previous, total - 1); // the newest element is never lost
+    EXPECT_GT(received, 0);
+}
+
+// Test fixture for the lock-free multi-producer/multi-consumer mode
+class RingBufferMpmcTest: public ::testing::Test {
+  protected:
+    void Create(int size) {
+        rb_config_t config = {};
+        config.size = size;
+        config.mode = RB_MODE_MPMC;
+        rb = rb_create_ex(&config);
+        ASSERT_NE(rb, nullptr);
+    }
+
+    void TearDown() override {
+        rb_destroy(rb);
+    }
+
+    rb_t *rb = nullptr;
+};
+
+// Test: single threaded FIFO and overwrite behavior matches the locked mode
+TEST_F(RingBufferMpmcTest, FifoAndOverwrite) {
+    Create(5); // rounded up to 8
+    EXPECT_EQ(rb_size_r(rb), 8u);
+    EXPECT_TRUE(rb_is_empty_r(rb));
+
+    for (int i = 0; i < 10; i++)
+        rb_add_element_r(rb, i); // 0 and 1 are overwritten
+    EXPECT_TRUE(rb_is_full_r(rb));
+
+    int element;
+    EXPECT_EQ(rb_get_last_element_r(rb, &element), 0);
+    EXPECT_EQ(element, 9);
+    EXPECT_EQ(rb_get_element_at_r(rb, 0, &element), 0);
+    EXPECT_EQ(element, 2);
+
+    for (int i = 2; i < 10; i++) {
+        ASSERT_TRUE(rb_remove_element_r(rb, &element));
+        ASSERT_EQ(element, i);
+    }
+    EXPECT_FALSE(rb_remove_element_r(rb, &element));
+}
+
+// Test: several producers and consumers, no element is lost or duplicated when nothing overflows
+TEST_F(RingBufferMpmcTest, ProducersConsumersLossless) {
+    const int producers = 4, consumers = 4, per_producer = 25000;
+    Create(producers * per_producer);
+
+    std::vector<std::atomic<int>> seen(producers * per_producer);
+    std::atomic<int> received(0);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++)
+        threads.emplace_back([this, p, per_producer]() {
+            for (int i = 0; i < per_producer; i++)
+                rb_add_element_r(rb, p * per_producer + i);
+        });
+    for (int c = 0; c < consumers; c++)
+        threads.emplace_back([this, &seen, &received, producers, per_producer]() {
+            while (received.load() < producers * per_producer) {
+                int element;
+                if (rb_remove_element_r(rb, &element)) {
+                    seen[element]++;
+                    received++;
+                }
+            }
+        });
+    for (auto &thread : threads)
+        thread.join();
+
+    for (int i = 0; i < producers * per_producer; i++)
+        ASSERT_EQ(seen[i].load(), 1) << "element " << i;
+    EXPECT_TRUE(rb_is_empty_r(rb));
+}
+
+// Test: producers kept below the capacity, with slots reused over many laps, never overwrite even
+// while consumers are between claiming a slot and handing it back
+TEST_F(RingBufferMpmcTest, ProducersConsumersBelowCapacity) {
+    const int producers = 4, consumers = 4, per_producer = 25000, size = 64;
+    Create(size);
+
+    std::vector<std::atomic<int>> seen(producers * per_producer);
+    std::atomic<int> produced(0), received(0);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++)
+        threads.emplace_back([this, p, per_producer, size, &produced, &received]() {
+            for (int i = 0; i < per_producer; i++) {
+                // Reserve room first, so the buffer never holds more than `size` elements
+                int n = produced.load();
+                while (n - received.load() >= size || !produced.compare_exchange_weak(n, n + 1)) {
+                    std::this_thread::yield();
+                    n = produced.load();
+                }
+                rb_add_element_r(rb, p * per_producer + i);
+            }
+        });
+    for (int c = 0; c < consumers; c++)
+        threads.emplace_back([this, &seen, &received, producers, per_producer]() {
+            while (received.load() < producers * per_producer) {
+                int element;
+                if (rb_remove_element_r(rb, &element)) {
+                    seen[element]++;
+                    received++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    for (auto &thread : threads)
+        thread.join();
+
+    for (int i = 0; i < producers * per_producer; i++)
+        ASSERT_EQ(seen[i].load(), 1) << "element " << i;
+#if RB_ENABLE_METRICS
+    rb_metrics_t metrics;
+    ASSERT_EQ(rb_get_metrics_r(rb, &metrics), 0);
+    EXPECT_EQ(metrics.overwrites, 0u);
+#endif
+}
+
+// Test: with overwrites, every consumer sees each producer's elements in order and nothing twice
+TEST_F(RingBufferMpmcTest, ProducersConsumersOverwrite) {
+    const int producers = 4, consumers = 2, per_producer = 25000;
+    Create(64);
+
+    std::vector<std::atomic<int>> seen(producers * per_producer);
+    std::atomic<int> done_producers(0);
+    std::atomic<bool> ordered(true);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++)
+        threads.emplace_back([this, p, per_producer, &done_producers]() {
+            for (int i = 0; i < per_producer; i++)
+                rb_add_element_r(rb, p * per_producer + i);
+            done_producers++;
+        });
+    for (int c = 0; c < consumers; c++)
+        threads.emplace_back([this, &seen, &done_producers, &ordered, producers, per_producer]() {
+            std::vector<int> last(producers, -1);
+            for (;;) {
+                bool finished = done_producers.load() == producers;
+                int element;
+                while (rb_remove_element_r(rb, &element)) {
+                    int producer = element / per_producer;
+                    if (element <= last[producer])
+                        ordered = false;
+                    last[producer] = element;
+                    seen[element]++;
+                }
+                if (finished)
+                    break;
+            }
+        });
+    for (auto &thread : threads)
+        thread.join();
+
+    EXPECT_TRUE(ordered.load());
+    for (int i = 0; i < producers * per_producer; i++)
+        ASSERT_LE(seen[i].load(), 1) << "element " << i;
+}
+
+// Test: bulk add keeps FIFO order and overwrites like repeated single adds
+TEST_F(RingBufferHandleTest, AddElementsBulk) {
+    const int first[] = { 1, 2, 3 };
+    EXPECT_EQ(rb_add_elements_r(rb, first, 3), 3u);
+    const int second[] = { 4, 5, 6, 7 }; // wraps around and overwrites 1 and 2
+    EXPECT_EQ(rb_add_elements_r(rb, second, 4), 4u);
+    EXPECT_TRUE(rb_is_full_r(rb));
+
+    int out[5];
+    EXPECT_EQ(rb_remove_elements_r(rb, out, 10), 5u);
+    const int expected[] = { 3, 4, 5, 6, 7 };
+    for (int i = 0; i < 5; i++)
+        EXPECT_EQ(out[i], expected[i]);
+    EXPECT_TRUE(rb_is_empty_r(rb));
+    EXPECT_EQ(rb_remove_elements_r(rb, out, 1), 0u);
+}
+
+// Test: a batch larger than the buffer keeps only its newest elements
+TEST_F(RingBufferHandleTest, AddElementsLargerThanBuffer) {
+    rb_add_element_r(rb, 100);
+    int batch[12];
+    for (int i = 0; i < 12; i++)
+        batch[i] = i;
+    EXPECT_EQ(rb_add_elements_r(rb, batch, 12), 12u);
+
+    int out[5];
+    EXPECT_EQ(rb_remove_elements_r(rb, out, 5), 5u);
+    for (int i = 0; i < 5; i++)
+        EXPECT_EQ(out[i], 7 + i);
+}
+
+// Test: partial bulk removal, and removal without an output array
+TEST_F(RingBufferHandleTest, RemoveElementsPartial) {
+    for (int i = 0; i < 4; i++)
+        rb_add_element_r(rb, i);
+    EXPECT_EQ(rb_remove_elements_r(rb, nullptr, 2), 2u);
+
+    int out[2];
+    EXPECT_EQ(rb_remove_elements_r(rb, out, 2), 2u);
+    EXPECT_EQ(out[0], 2);
+    EXPECT_EQ(out[1], 3);
+}
+
+// Test: peek exposes the content as one span, then two spans once it wraps around
+TEST_F(RingBufferHandleTest, PeekSpans) {
+    rb_span_t spans[2];
+    EXPECT_EQ(rb_peek_r(rb, spans), 0);
+    rb_peek_done_r(rb);
+
+    const int first[] = { 1, 2, 3 };
+    rb_add_elements_r(rb, first, 3);
+    ASSERT_EQ(rb_peek_r(rb, spans), 1);
+    EXPECT_EQ(spans[0].len, 3u);
+    EXPECT_EQ(((const int *)spans[0].data)[0], 1);
+    EXPECT_EQ(spans[1].len, 0u);
+    rb_peek_done_r(rb);
+
+    const int second[] = { 4, 5, 6, 7 };
+    rb_add_elements_r(rb, second, 4);
+    ASSERT_EQ(rb_peek_r(rb, spans), 2);
+    std::vector<int> content;
+    for (int s = 0; s < 2; s++)
+        content.insert(content.end(), (const int *)spans[s].data,
+                       (const int *)spans[s].data + spans[s].len);
+    rb_peek_done_r(rb);
+    EXPECT_EQ(content, std::vector<int>({ 3, 4, 5, 6, 7 }));
+}
+
+// Test: bulk operations in a lock-free mode, peek is not supported there
+TEST_F(RingBufferSpscTest, BulkOperations) {
+    std::vector<int> batch(1500);
+    for (int i = 0; i < 1500; i++)
+        batch[i] = i;
+    EXPECT_EQ(rb_add_elements_r(rb, batch.data(), batch.size()), 1500u);
+
+    std::vector<int> out(2000);
+    EXPECT_EQ(rb_remove_elements_r(rb, out.data(), out.size()), 1024u);
+    EXPECT_EQ(out[0], 1500 - 1024);
+    EXPECT_EQ(out[1023], 1499);
+
+    rb_span_t spans[2];
+    EXPECT_EQ(rb_peek_r(rb, spans), -1);
+}
+
+// Test: window statistics follow adds, removes, overwrites and bulk operations
+TEST(RingBufferStatsTest, MatchesBruteForce) {
+    rb_config_t config = {};
+    config.size = 16;
+    config.track_stats = true;
+    rb_t *rb = rb_create_ex(&config);
+    ASSERT_NE(rb, nullptr);
+
+    rb_stats_t stats;
+    EXPECT_EQ(rb_get_stats_r(rb, &stats), -1); // empty
+
+    std::mt19937 rng(42);
+    std::deque<int> model;
+    for (int step = 0; step < 5000; step++) {
+        int action = rng() % 10;
+        if (action < 6) {
+            int value = (int)(rng() % 200) - 50;
+            rb_add_element_r(rb, value);
+            model.push_back(value);
+        } else if (action < 8) {
+            if (rb_remove_element_r(rb, nullptr))
+                model.pop_front();
+        } else if (action == 8) {
+            int batch[20];
+            size_t n = rng() % 20;
+            for (size_t i = 0; i < n; i++) {
+                batch[i] = (int)(rng() % 200);
+                model.push_back(batch[i]);
+            }
+            rb_add_elements_r(rb, batch, n);
+        } else {
+            size_t n = rb_remove_elements_r(rb, nullptr, rng() % 5);
+            model.erase(model.begin(), model.begin() + n);
+        }
+        while (model.size() > 16)
+            model.pop_front();
+
+        if (model.empty()) {
+            EXPECT_EQ(rb_get_stats_r(rb, &stats), -1);
+            continue;
+        }
+        ASSERT_EQ(rb_get_stats_r(rb, &stats), 0);
+        double sum = 0, sum_sq = 0;
+        for (int v : model) {
+            sum += v;
+            sum_sq += (double)v * v;
+        }
+        double mean = sum / model.size();
+        ASSERT_EQ(stats.count, model.size());
+        ASSERT_EQ(stats.sum, (int64_t)sum);
+        ASSERT_EQ(stats.min, *std::min_element(model.begin(), model.end()));
+        ASSERT_EQ(stats.max, *std::max_element(model.begin(), model.end()));
+        ASSERT_NEAR(stats.mean, mean, 1e-9);
+        ASSERT_NEAR(stats.variance, sum_sq / model.size() - mean * mean, 1e-6);
+        ASSERT_NEAR(stats.stddev, std::sqrt(stats.variance), 1e-9);
+    }
+    rb_destroy(rb);
+}
+
+// Test: statistics must be requested at creation and are only available in locked mode
+TEST(RingBufferStatsTest, RequiresTracking) {
+    rb_t *rb = rb_create(4);
+    rb_add_element_r(rb, 1);
+    rb_stats_t stats;
+    EXPECT_EQ(rb_get_stats_r(rb, &stats), -1);
+    rb_destroy(rb);
+
+    rb_config_t config = {};
+    config.size = 4;
+    config.mode = RB_MODE_SPSC;
+    config.track_stats = true;
+    EXPECT_EQ(rb_create_ex(&config), nullptr);
+}
+
+// Test: percentiles follow adds, removes and overwrites, and match the sorted window
+TEST(RingBufferPercentileTest, MatchesSortedWindow) {
+    for (rb_elem_t type : { RB_ELEM_UINT8, RB_ELEM_INT16 }) {
+        rb_config_t config = {};
+        config.size = 50;
+        config.elem_type = type;
+        config.track_percentiles = true;
+        rb_t *rb = rb_create_ex(&config);
+        ASSERT_NE(rb, nullptr);
+
+        int value;
+        EXPECT_EQ(rb_percentile_r(rb, 50.0, &value), -1); // empty
+
+        std::mt19937 rng(7);
+        std::deque<int> model;
+        const double percentiles[] = { 0.0, 10.0, 25.0, 50.0, 90.0, 99.5, 100.0 };
+        for (int step = 0; step < 3000; step++) {
+            int action = rng() % 10;
+            if (action < 7) {
+                int sample = (type == RB_ELEM_UINT8) ? (int)(rng() % 256)
+                                                     : (int)(rng() % 65536) - 32768;
+                rb_add_element_r(rb, sample);
+                model.push_back(sample);
+                if (model.size() > 50)
+                    model.pop_front();
+            } else if (rb_remove_element_r(rb, nullptr)) {
+                model.pop_front();
+            }
+            if (model.empty())
+                continue;
+
+            std::vector<int> sorted(model.begin(), model.end());
+            std::sort(sorted.begin(), sorted.end());
+            int values[7];
+            ASSERT_EQ(rb_percentiles_r(rb, percentiles, values, 7), 0);
+            for (int i = 0; i < 7; i++) {
+                size_t rank = (size_t)std::ceil(percentiles[i] / 100.0 * sorted.size());
+                ASSERT_EQ(values[i], sorted[rank ? rank - 1 : 0]) << "p" << percentiles[i];
+            }
+        }
+
+        // Percentiles imply the window statistics
+        rb_stats_t stats;
+        EXPECT_EQ(rb_get_stats_r(rb, &stats), 0);
+        EXPECT_EQ(rb_percentile_r(rb, 100.5, &value), -1);
+        EXPECT_EQ(rb_percentile_r(rb, -1.0, &value), -1);
+        rb_destroy(rb);
+    }
+}
+
+// Test: the median of a small window, and configurations without a bounded value range
+TEST(RingBufferPercentileTest, MedianAndRequirements) {
+    rb_config_t config = {};
+    config.size = 5;
+    config.elem_type = RB_ELEM_UINT8;
+    config.track_percentiles = true;
+    rb_t *rb = rb_create_ex(&config);
+    ASSERT_NE(rb, nullptr);
+    for (int sample : { 72, 185, 70, 71, 44 })
+        rb_add_element_r(rb, sample);
+    int value;
+    ASSERT_EQ(rb_percentile_r(rb, 50.0, &value), 0);
+    EXPECT_EQ(value, 71); // the spikes do not move it
+    rb_add_element_r(rb, 180); // evicts 72
+    ASSERT_EQ(rb_percentile_r(rb, 50.0, &value), 0);
+    EXPECT_EQ(value, 71);
+    rb_destroy(rb);
+
+    rb = rb_create(4);
+    rb_add_element_r(rb, 1);
+    EXPECT_EQ(rb_percentile_r(rb, 50.0, &value), -1);
+    rb_destroy(rb);
+
+    config.elem_type = RB_ELEM_INT32;
+    EXPECT_EQ(rb_create_ex(&config), nullptr);
+    config.elem_type = RB_ELEM_UINT8;
+    config.mode = RB_MODE_SPSC;
+    EXPECT_EQ(rb_create_ex(&config), nullptr);
+}
+
+// Test: narrow element types store the same values in less memory and reject what does not fit
+TEST(RingBufferElemTypeTest, NarrowTypes) {
+    const struct {
+        rb_elem_t type;
+        int min, max;
+    } cases[] = { { RB_ELEM_UINT8, 0, 255 }, { RB_ELEM_INT16, -32768, 32767 } };
+
+    for (const auto &c : cases) {
+        for (rb_mode_t mode : { RB_MODE_LOCKED, RB_MODE_SPSC }) {
+            rb_config_t config = {};
+            config.size = 4;
+            config.mode = mode;
+            config.elem_type = c.type;
+            config.track_stats = (mode == RB_MODE_LOCKED);
+            rb_t *rb = rb_create_ex(&config);
+            ASSERT_NE(rb, nullptr);
+
+            rb_add_element_r(rb, c.min);
+            rb_add_element_r(rb, c.max);
+            rb_add_element_r(rb, c.max + 1); // rejected
+            rb_add_element_r(rb, c.min - 1); // rejected
+            const int batch[] = { 100, c.max + 1 };
+            EXPECT_EQ(rb_add_elements_r(rb, batch, 2), 0u); // rejected as a whole
+            EXPECT_EQ(rb_add_elements_r(rb, batch, 1), 1u);
+            EXPECT_EQ(rb_count_r(rb), 3u);
+
+            int element;
+            EXPECT_EQ(rb_get_element_at_r(rb, 1, &element), 0);
+            EXPECT_EQ(element, c.max);
+            EXPECT_EQ(rb_get_last_element_r(rb, &element), 0);
+            EXPECT_EQ(element, 100);
+
+            if (mode == RB_MODE_LOCKED) {
+                rb_stats_t stats;
+                ASSERT_EQ(rb_get_stats_r(rb, &stats), 0);
+                EXPECT_EQ(stats.min, c.min);
+                EXPECT_EQ(stats.max, c.max);
+            }
+
+            int out[3];
+            EXPECT_EQ(rb_remove_elements_r(rb, out, 3), 3u);
+            EXPECT_EQ(out[0], c.min);
+            EXPECT_EQ(out[1], c.max);
+            EXPECT_EQ(out[2], 100);
+            rb_destroy(rb);
+        }
+    }
+}
+
+// Test: peek exposes the narrow storage directly
+TEST(RingBufferElemTypeTest, PeekNarrow) {
+    rb_config_t config = {};
+    config.size = 3;
+    config.elem_type = RB_ELEM_UINT8;
+    rb_t *rb = rb_create_ex(&config);
+    ASSERT_NE(rb, nullptr);
+
+    rb_add_element_r(rb, 60);
+    const int batch[] = { 70, 80, 90 }; // wraps around and overwrites 60
+    rb_add_elements_r(rb, batch, 3);
+    rb_span_t spans[2];
+    ASSERT_EQ(rb_peek_r(rb, spans), 2);
+    EXPECT_EQ(spans[0].len, 2u);
+    EXPECT_EQ(((const uint8_t *)spans[0].data)[0], 70);
+    EXPECT_EQ(((const uint8_t *)spans[1].data)[0], 90);
+    rb_peek_done_r(rb);
+    rb_destroy(rb);
+
+    // MPMC slots carry a sequence number anyway, narrow types are not offered there
+    config.mode = RB_MODE_MPMC;
+    EXPECT_EQ(rb_create_ex(&config), nullptr);
+}
+
+#ifndef _WIN32
+// Test fixture for file backed buffers
+class RingBufferFileTest: public ::testing::Test {
+  protected:
+    void SetUp() override {
+        path = ::testing::TempDir() + "ring_buffer_file_test.bin";
+        std::remove(path.c_str());
+    }
+
+    void TearDown() override {
+        std::remove(path.c_str());
+    }
+
+    rb_t *Open(int size, rb_elem_t elem_type = RB_ELEM_INT32) {
+        rb_config_t config = {};
+        config.size = size;
+        config.elem_type = elem_type;
+        config.track_stats = true;
+        config.path = path.c_str();
+        return rb_create_ex(&config);
+    }
+
+    // Header fields, see rb_file_header_t: 4 x u32, size, commit, then two {head, count, first_seq}
+    // slots, the committed one being state[commit & 1]
+    uint64_t ReadField(size_t offset) {
+        std::ifstream file(path, std::ios::binary);
+        uint64_t value = 0;
+        file.seekg(offset);
+        file.read((char *)&value, sizeof(value));
+        return value;
+    }
+
+    void WriteField(size_t offset, uint64_t value) {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(offset);
+        file.write((const char *)&value, sizeof(value));
+    }
+
+    static size_t StateOffset(uint64_t commit) { return 32 + (commit & 1) * 3 * sizeof(uint64_t); }
+
+    static const size_t kCommitOffset = 24;
+
+    std::string path;
+};
+
+// Test: a reopened buffer resumes with the content left by the previous instance
+TEST_F(RingBufferFileTest, ReattachAfterRestart) {
+    rb_t *rb = Open(4);
+    ASSERT_NE(rb, nullptr);
+    EXPECT_TRUE(rb_is_empty_r(rb));
+    for (int i = 1; i <= 6; i++)
+        rb_add_element_r(rb, i * 10); // 10 and 20 are overwritten
+    rb_remove_element_r(rb, nullptr);  // 30 is removed
+    EXPECT_EQ(rb_sync_r(rb), 0);
+    rb_destroy(rb);
+
+    rb = Open(4);
+    ASSERT_NE(rb, nullptr);
+    EXPECT_EQ(rb_count_r(rb), 3u);
+    int element;
+    EXPECT_EQ(rb_get_element_at_r(rb, 0, &element), 0);
+    EXPECT_EQ(element, 40);
+    EXPECT_EQ(rb_get_last_element_r(rb, &element), 0);
+    EXPECT_EQ(element, 60);
+
+    // Statistics are rebuilt from the resumed window
+    rb_stats_t stats;
+    ASSERT_EQ(rb_get_stats_r(rb, &stats), 0);
+    EXPECT_EQ(stats.min, 40);
+    EXPECT_EQ(stats.max, 60);
+
+    rb_add_element_r(rb, 70);
+    EXPECT_TRUE(rb_is_full_r(rb));
+    rb_destroy(rb);
+}
+
+// Test: a file of another geometry is refused, an inconsistent one is reset
+TEST_F(RingBufferFileTest, HeaderValidation) {
+    rb_t *rb = Open(4);
+    ASSERT_NE(rb, nullptr);
+    rb_add_element_r(rb, 1);
+    rb_destroy(rb);
+
+    EXPECT_EQ(Open(8), nullptr);
+    EXPECT_EQ(Open(4, RB_ELEM_UINT8), nullptr);
+
+    // Corrupt the count of the committed window
+    WriteField(StateOffset(ReadField(kCommitOffset)) + sizeof(uint64_t), 99);
+    rb = Open(4);
+    ASSERT_NE(rb, nullptr);
+    EXPECT_TRUE(rb_is_empty_r(rb));
+    rb_destroy(rb);
+}
+
+// Test: a process killed halfway through a header update reopens the last committed window
+TEST_F(RingBufferFileTest, TornHeaderUpdate) {
+    rb_t *rb = Open(4);
+    ASSERT_NE(rb, nullptr);
+    for (int i = 1; i <= 3; i++)
+        rb_add_element_r(rb, i * 10);
+    rb_destroy(rb);
+
+    // The next window was being written to the free slot, head moved but not count, and the
+    // commit word was never stored
+    uint64_t commit = ReadField(kCommitOffset);
+    WriteField(StateOffset(commit + 1), 1);
+    WriteField(StateOffset(commit + 1) + sizeof(uint64_t), 99);
+
+    rb = Open(4);
+    ASSERT_NE(rb, nullptr);
+    ASSERT_EQ(rb_count_r(rb), 3u);
+    int element;
+    EXPECT_EQ(rb_get_element_at_r(rb, 0, &element), 0);
+    EXPECT_EQ(element, 10);
+    EXPECT_EQ(rb_get_last_element_r(rb, &element), 0);
+    EXPECT_EQ(element, 30);
+
+    // Updates resume from the committed window, over the torn slot
+    rb_add_element_r(rb, 40);
+    EXPECT_EQ(ReadField(kCommitOffset), commit + 1);
+    rb_add_element_r(rb, 50);
+    rb_destroy(rb);
+
+    rb = Open(4);
+    ASSERT_NE(rb, nullptr);
+    EXPECT_EQ(rb_count_r(rb), 4u);
+    EXPECT_EQ(rb_get_element_at_r(rb, 0, &element), 0);
+    EXPECT_EQ(element, 20);
+    rb_destroy(rb);
+}
+
+// Test: a process killed while overwriting a full buffer, after the element stores but before
+// the commit, reopens the window without the overwritten elements, never with the new values in
+// the slots of the old ones
+TEST_F(RingBufferFileTest, CrashWhileOverwriting) {
+    rb_t *rb = Open(4);
+    ASSERT_NE(rb, nullptr);
+    for (int i = 1; i <= 4; i++)
+        rb_add_element_r(rb, i * 10);
+    rb_add_element_r(rb, 50); // overwrites 10
+    rb_destroy(rb);
+
+    // Undo the last commit, as if the process died right before it
+    WriteField(kCommitOffset, ReadField(kCommitOffset) - 1);
+    rb = Open(4);
+    ASSERT_NE(rb, nullptr);
+    ASSERT_EQ(rb_count_r(rb), 3u);
+    int element;
+    for (size_t i = 0; i < 3; i++) {
+        EXPECT_EQ(rb_get_element_at_r(rb, i, &element), 0);
+        EXPECT_EQ(element, 20 + 10 * (int)i);
+    }
+
+    // Same for a batch overwriting the two oldest elements of a full buffer
+    rb_add_element_r(rb, 50);
+    int batch[] = { 60, 70 };
+    rb_add_elements_r(rb, batch, 2);
+    rb_destroy(rb);
+
+    WriteField(kCommitOffset, ReadField(kCommitOffset) - 1);
+    rb = Open(4);
+    ASSERT_NE(rb, nullptr);
+    ASSERT_EQ(rb_count_r(rb), 2u);
+    EXPECT_EQ(rb_get_element_at_r(rb, 0, &element), 0);
+    EXPECT_EQ(element, 40);
+    EXPECT_EQ(rb_get_last_element_r(rb, &element), 0);
+    EXPECT_EQ(element, 50);
+    rb_destroy(rb);
+}
+
+// Test: a file is attached to one buffer at a time
+TEST_F(RingBufferFileTest, ExclusiveAttach) {
+    rb_t *rb = Open(4);
+    ASSERT_NE(rb, nullptr);
+    rb_add_element_r(rb, 72);
+    EXPECT_EQ(Open(4), nullptr);
+    rb_destroy(rb);
+
+    rb = Open(4);
+    ASSERT_NE(rb, nullptr);
+    EXPECT_EQ(rb_count_r(rb), 1u);
+    rb_destroy(rb);
+}
+
+// Test: a file that is not a buffer file is never overwritten
+TEST_F(RingBufferFileTest, ForeignFile) {
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << std::string(256, 'x');
+    }
+    EXPECT_EQ(Open(4), nullptr);
+}
+#endif // _WIN32
+
+#ifndef _WIN32
+// Test: a mirrored buffer exposes any window as one contiguous region
+TEST(RingBufferMirrorTest, ContiguousWraparound) {
+    rb_config_t config = {};
+    config.size = 10;
+    config.mirror = true;
+    config.track_stats = true;
+    rb_t *rb = rb_create_ex(&config);
+    ASSERT_NE(rb, nullptr);
+
+    // The capacity is rounded up to whole pages
+    size_t size = rb_size_r(rb);
+    EXPECT_GE(size, 10u);
+    EXPECT_EQ(size * sizeof(int) % 4096, 0u);
+
+    std::vector<int> batch(size + size / 2);
+    for (size_t i = 0; i < batch.size(); i++)
+        batch[i] = (int)i;
+    rb_add_elements_r(rb, batch.data(), size / 2);
+    rb_remove_elements_r(rb, nullptr, size / 2);
+    rb_add_elements_r(rb, batch.data(), batch.size()); // wraps around and overwrites
+
+    rb_span_t spans[2];
+    ASSERT_EQ(rb_peek_r(rb, spans), 1);
+    ASSERT_EQ(spans[0].len, size);
+    const int *window = (const int *)spans[0].data;
+    for (size_t i = 0; i < size; i++)
+        ASSERT_EQ(window[i], (int)(size / 2 + i));
+    rb_peek_done_r(rb);
+
+    int element;
+    EXPECT_EQ(rb_get_element_at_r(rb, (int)size - 1, &element), 0);
+    EXPECT_EQ(element, (int)batch.back());
+
+    std::vector<int> out(size);
+    EXPECT_EQ(rb_remove_elements_r(rb, out.data(), size), size);
+    EXPECT_EQ(out[0], (int)(size / 2));
+    EXPECT_EQ(out[size - 1], (int)batch.back());
+    rb_destroy(rb);
+}
+
+// Test: the SPSC mode and narrow elements work on a mirrored storage too
+TEST(RingBufferMirrorTest, SpscNarrow) {
+    rb_config_t config = {};
+    config.size = 100;
+    config.mode = RB_MODE_SPSC;
+    config.elem_type = RB_ELEM_UINT8;
+    config.mirror = true;
+    rb_t *rb = rb_create_ex(&config);
+    ASSERT_NE(rb, nullptr);
+    size_t size = rb_size_r(rb);
+    EXPECT_EQ(size & (size - 1), 0u); // still a power of two
+
+    for (size_t i = 0; i < size + 7; i++)
+        rb_add_element_r(rb, (int)(i % 200));
+    int element;
+    EXPECT_EQ(rb_get_last_element_r(rb, &element), 0);
+    EXPECT_EQ(element, (int)((size + 6) % 200));
+    EXPECT_TRUE(rb_remove_element_r(rb, &element));
+    EXPECT_EQ(element, 7 % 200);
+    rb_destroy(rb);
+
+    config.mode = RB_MODE_MPMC;
+    config.elem_type = RB_ELEM_INT32;
+    EXPECT_EQ(rb_create_ex(&config), nullptr);
+}
+#endif // _WIN32
+
+// Appends the consumed elements to a std::vector
+static void
+collect(const int *elements, size_t n, void *arg) {
+    static_cast<std::vector<int> *>(arg)->insert(static_cast<std::vector<int> *>(arg)->end(),
+                                                 elements, elements + n);
+}
+
+// Test: a cursor sees every element once, in order, across wraps and chunks
+TEST(RingBufferConsumeTest, EveryElementOnce) {
+    for (rb_elem_t type : { RB_ELEM_INT32, RB_ELEM_INT16, RB_ELEM_UINT8 }) {
+        rb_config_t config = {};
+        config.size = 1000;
+        config.elem_type = type;
+        rb_t *rb = rb_create_ex(&config);
+        ASSERT_NE(rb, nullptr);
+
+        std::vector<int> seen;
+        uint64_t cursor = 0, lost = 0;
+        int next = 0;
+        for (int round = 0; round < 10; round++) {
+            for (int i = 0; i < 300 + round * 50; i++, next++)
+                rb_add_element_r(rb, next % 200);
+            rb_consume_since_r(rb, &cursor, collect, &seen, &lost);
+            EXPECT_EQ(lost, 0u);
+        }
+        ASSERT_EQ(seen.size(), (size_t)next);
+        for (int i = 0; i < next; i++)
+            ASSERT_EQ(seen[i], i % 200);
+        EXPECT_EQ(cursor, (uint64_t)next);
+
+        // Nothing new
+        EXPECT_EQ(rb_consume_since_r(rb, &cursor, collect, &seen, &lost), 0u);
+        rb_destroy(rb);
+    }
+}
+
+// Test: elements overwritten or removed before the cursor reached them are reported as lost
+TEST(RingBufferConsumeTest, ReportsLost) {
+    rb_t *rb = rb_create(4);
+    std::vector<int> seen;
+    uint64_t cursor = 0, lost = 0;
+    for (int i = 0; i < 10; i++)
+        rb_add_element_r(rb, i);
+    EXPECT_EQ(rb_consume_since_r(rb, &cursor, collect, &seen, &lost), 4u);
+    EXPECT_EQ(lost, 6u);
+    EXPECT_EQ(seen, std::vector<int>({ 6, 7, 8, 9 }));
+
+    rb_add_element_r(rb, 10);
+    int element;
+    EXPECT_TRUE(rb_remove_element_r(rb, &element)); // removed, not yet seen by the cursor
+    EXPECT_TRUE(rb_remove_element_r(rb, &element));
+    seen.clear();
+    EXPECT_EQ(rb_consume_since_r(rb, &cursor, collect, &seen, &lost), 1u);
+    EXPECT_EQ(lost, 0u); // 6 and 7 were seen already, 10 is still there
+    rb_add_element_r(rb, 11);
+    EXPECT_EQ(rb_consume_since_r(rb, &cursor, collect, &seen, &lost), 1u);
+    EXPECT_EQ(seen, std::vector<int>({ 10, 11 }));
+    rb_destroy(rb);
+}
+
+// Test: a cursor from a previous life of the buffer restarts at the oldest element
+TEST(RingBufferConsumeTest, StaleCursorAndInvalidUse) {
+    rb_t *rb = rb_create(4);
+    rb_add_element_r(rb, 1);
+    rb_add_element_r(rb, 2);
+    std::vector<int> seen;
+    uint64_t cursor = 100, lost = 1;
+    EXPECT_EQ(rb_consume_since_r(rb, &cursor, collect, &seen, &lost), 2u);
+    EXPECT_EQ(lost, 0u);
+    EXPECT_EQ(cursor, 2u);
+
+    EXPECT_EQ(rb_consume_since_r(rb, nullptr, collect, &seen, &lost), 0u);
+    EXPECT_EQ(rb_consume_since_r(rb, &cursor, nullptr, &seen, &lost), 0u);
+    EXPECT_EQ(rb_consume_since_r(nullptr, &cursor, collect, &seen, &lost), 0u);
+    rb_destroy(rb);
+
+    rb_config_t config = {};
+    config.size = 4;
+    config.mode = RB_MODE_SPSC;
+    rb = rb_create_ex(&config);
+    rb_add_element_r(rb, 1);
+    cursor = 0;
+    EXPECT_EQ(rb_consume_since_r(rb, &cursor, collect, &seen, &lost), 0u);
+    rb_destroy(rb);
+}
+
+// Test: a snapshot copies the newest elements oldest first, across the wrap point
+TEST(RingBufferSnapshotTest, CopiesWindow) {
+    for (bool mirror : { false, true }) {
+        rb_config_t config = {};
+        config.size = 1024;
+        config.mirror = mirror;
+        rb_t *rb = rb_create_ex(&config);
+        ASSERT_NE(rb, nullptr);
+        std::vector<int> out(2048, -1);
+        EXPECT_EQ(rb_snapshot_r(rb, out.data(), out.size()), 0u);
+
+        for (int i = 0; i < 1500; i++)
+            rb_add_element_r(rb, i);
+        size_t size = rb_size_r(rb);
+        ASSERT_EQ(rb_snapshot_r(rb, out.data(), out.size()), size);
+        for (size_t i = 0; i < size; i++)
+            ASSERT_EQ(out[i], (int)(1500 - size + i));
+
+        ASSERT_EQ(rb_snapshot_r(rb, out.data(), 10), 10u);
+        for (int i = 0; i < 10; i++)
+            EXPECT_EQ(out[i], 1490 + i);
+        rb_destroy(rb);
+    }
+}
+
+// Test: narrow storage types and invalid use
+TEST(RingBufferSnapshotTest, NarrowTypesAndInvalidUse) {
+    rb_config_t config = {};
+    config.size = 5;
+    config.elem_type = RB_ELEM_UINT8;
+    rb_t *rb = rb_create_ex(&config);
+    for (int i = 0; i < 7; i++)
+        rb_add_element_r(rb, 250 + i % 6);
+    int out[5];
+    ASSERT_EQ(rb_snapshot_r(rb, out, 5), 5u);
+    EXPECT_EQ(std::vector<int>(out, out + 5), std::vector<int>({ 252, 253, 254, 255, 250 }));
+    EXPECT_EQ(rb_snapshot_r(rb, nullptr, 5), 0u);
+    EXPECT_EQ(rb_snapshot_r(rb, out, 0), 0u);
+    EXPECT_EQ(rb_snapshot_r(nullptr, out, 5), 0u);
+    rb_destroy(rb);
+
+    config.elem_type = RB_ELEM_INT32;
+    config.mode = RB_MODE_SPSC;
+    rb = rb_create_ex(&config);
+    rb_add_element_r(rb, 1);
+    EXPECT_EQ(rb_snapshot_r(rb, out, 5), 0u);
+    rb_destroy(rb);
+}
+
+// Test: snapshots taken while a writer adds and removes are never torn: the elements are
+// consecutive values, as added
+TEST(RingBufferSnapshotTest, NeverTornUnderWrites) {
+    rb_t *rb = rb_create(256);
+    std::atomic<bool> stop(false);
+    std::thread writer([&]() {
+        int next = 0, chunk[37];
+        while (!stop.load()) {
+            for (int &value : chunk)
+                value = next++;
+            rb_add_elements_r(rb, chunk, 37);
+            rb_add_element_r(rb, next++);
+            rb_remove_elements_r(rb, nullptr, 3);
+        }
+    });
+
+    std::vector<int> out(256);
+    size_t snapshots = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+    while (std::chrono::steady_clock::now() < deadline) {
+        size_t n = rb_snapshot_r(rb, out.data(), out.size());
+        snapshots++;
+        for (size_t i = 1; i < n; i++)
+            ASSERT_EQ(out[i], out[i - 1] + 1) << "torn snapshot at " << i;
+    }
+    stop = true;
+    writer.join();
+    EXPECT_GT(snapshots, 0u);
+    rb_destroy(rb);
+}
+
+// Test: a wait on an empty buffer times out, a zero timeout does not block
+TEST(RingBufferWaitTest, TimesOut) {
+    rb_t *rb = rb_create(4);
+    int element = -1;
+    EXPECT_EQ(rb_wait_remove_r(rb, &element, 0), ETIMEDOUT);
+
+    auto begin = std::chrono::steady_clock::now();
+    EXPECT_EQ(rb_wait_remove_r(rb, &element, 50), ETIMEDOUT);
+    EXPECT_GE(std::chrono::steady_clock::now() - begin, std::chrono::milliseconds(50));
+    EXPECT_EQ(element, -1);
+
+    rb_add_element_r(rb, 7);
+    EXPECT_EQ(rb_wait_remove_r(rb, &element, 0), 0);
+    EXPECT_EQ(element, 7);
+    EXPECT_EQ(rb_wait_for_count_r(rb, 1, 10), ETIMEDOUT);
+    rb_destroy(rb);
+}
+
+// Test: a blocked consumer receives every element added by a producer, in order
+TEST(RingBufferWaitTest, WakesOnAdd) {
+    rb_t *rb = rb_create(64);
+    const int total = 10000;
+    std::vector<int> seen;
+    std::thread consumer([&]() {
+        int element;
+        while ((int)seen.size() < total && rb_wait_remove_r(rb, &element, -1) == 0)
+            seen.push_back(element);
+    });
+    // Pace the producer so that the buffer never overwrites an element not yet consumed
+    for (int i = 0; i < total; i++) {
+        while (rb_count_r(rb) == 64)
+            std::this_thread::yield();
+        rb_add_element_r(rb, i);
+    }
+    consumer.join();
+    ASSERT_EQ(seen.size(), (size_t)total);
+    for (int i = 0; i < total; i++)
+        ASSERT_EQ(seen[i], i);
+    rb_destroy(rb);
+}
+
+// Test: waiting for a count returns once a bulk add reaches it
+TEST(RingBufferWaitTest, WaitForCount) {
+    rb_t *rb = rb_create(16);
+    std::atomic<int> result(-1);
+    std::thread waiter([&]() { result = rb_wait_for_count_r(rb, 10, 5000); });
+    const int first[] = { 1, 2, 3, 4, 5 };
+    rb_add_elements_r(rb, first, 5);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(result.load(), -1);
+    rb_add_elements_r(rb, first, 5);
+    waiter.join();
+    EXPECT_EQ(result.load(), 0);
+    EXPECT_EQ(rb_count_r(rb), 10u);
+    rb_destroy(rb);
+}
+
+// Test: shutdown wakes every waiter, the remaining elements can still be drained
+TEST(RingBufferWaitTest, ShutdownWakesWaiters) {
+    rb_t *rb = rb_create(8);
+    std::vector<std::thread> waiters;
+    std::atomic<int> cancelled(0);
+    for (int i = 0; i < 4; i++)
+        waiters.emplace_back([&, i]() {
+            int element;
+            int ret = (i % 2) ? rb_wait_remove_r(rb, &element, -1)
+                              : rb_wait_for_count_r(rb, 8, -1);
+            if (ret == ECANCELED)
+                cancelled++;
+        });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    rb_shutdown_r(rb);
+    for (auto &waiter : waiters)
+        waiter.join();
+    EXPECT_EQ(cancelled.load(), 4);
+
+    rb_add_element_r(rb, 3);
+    int element;
+    EXPECT_EQ(rb_wait_remove_r(rb, &element, -1), 0);
+    EXPECT_EQ(element, 3);
+    EXPECT_EQ(rb_wait_remove_r(rb, &element, -1), ECANCELED);
+    rb_destroy(rb);
+}
+
+// Test: invalid handles, counts and modes are rejected
+TEST(RingBufferWaitTest, InvalidUse) {
+    int element;
+    EXPECT_EQ(rb_wait_remove_r(nullptr, &element, 0), EINVAL);
+    EXPECT_EQ(rb_wait_for_count_r(nullptr, 1, 0), EINVAL);
+    rb_shutdown_r(nullptr);
+
+    rb_t *rb = rb_create(4);
+    EXPECT_EQ(rb_wait_for_count_r(rb, 5, 0), EINVAL);
+    EXPECT_EQ(rb_wait_for_count_r(rb, 0, 0), 0);
+    rb_destroy(rb);
+
+    rb_config_t config = {};
+    config.size = 4;
+    config.mode = RB_MODE_SPSC;
+    rb = rb_create_ex(&config);
+    EXPECT_EQ(rb_wait_remove_r(rb, &element, 0), EINVAL);
+    EXPECT_EQ(rb_wait_for_count_r(rb, 1, 0), EINVAL);
+    rb_destroy(rb);
+}
+
+#if RB_ENABLE_METRICS
+// Test: the locked mode counts adds, removes, overwrites (single and bulk) and empty reads
+TEST(RingBufferMetricsTest, LockedCounters) {
+    rb_t *rb = rb_create(4);
+    for (int i = 0; i < 6; i++)
+        rb_add_element_r(rb, i); // 2 overwrites
+    int element;
+    EXPECT_TRUE(rb_remove_element_r(rb, &element));
+
+    int batch[10] = { 0 };
+    EXPECT_EQ(rb_add_elements_r(rb, batch, 10), 10u); // 3 left, 10 added: 9 dropped
+    EXPECT_EQ(rb_remove_elements_r(rb, batch, 10), 4u);
+    EXPECT_FALSE(rb_remove_element_r(rb, &element));
+    EXPECT_EQ(rb_get_last_element_r(rb, &element), -1);
+
+    rb_metrics_t metrics;
+    ASSERT_EQ(rb_get_metrics_r(rb, &metrics), 0);
+    EXPECT_EQ(metrics.adds, 16u);
+    EXPECT_EQ(metrics.removes, 5u);
+    EXPECT_EQ(metrics.overwrites, 11u);
+    EXPECT_EQ(metrics.empty_reads, 2u);
+    EXPECT_EQ(metrics.adds, metrics.removes + metrics.overwrites + rb_count_r(rb));
+    EXPECT_GE(metrics.lock_acquisitions, 11u);
+    EXPECT_LE(metrics.lock_wait_max_ns, metrics.lock_wait_ns);
+    rb_destroy(rb);
+
+    EXPECT_EQ(rb_get_metrics_r(nullptr, &metrics), -1);
+}
+
+// Test: the lock-free modes derive adds and removes from their indices
+TEST(RingBufferMetricsTest, LockFreeCounters) {
+    for (rb_mode_t mode : { RB_MODE_SPSC, RB_MODE_MPMC }) {
+        rb_config_t config = {};
+        config.size = 8;
+        config.mode = mode;
+        rb_t *rb = rb_create_ex(&config);
+        ASSERT_NE(rb, nullptr);
+
+        for (int i = 0; i < 20; i++)
+            rb_add_element_r(rb, i); // 12 overwrites
+        int element;
+        for (int i = 0; i < 3; i++)
+            EXPECT_TRUE(rb_remove_element_r(rb, &element));
+        while (rb_remove_element_r(rb, &element)) {
+        }
+
+        rb_metrics_t metrics;
+        ASSERT_EQ(rb_get_metrics_r(rb, &metrics), 0);
+        EXPECT_EQ(metrics.adds, 20u);
+        EXPECT_EQ(metrics.overwrites, 12u);
+        EXPECT_EQ(metrics.removes, 8u);
+        EXPECT_EQ(metrics.empty_reads, 1u);
+        EXPECT_EQ(metrics.lock_acquisitions, 0u);
+        rb_destroy(rb);
+    }
+}
+
+// Test: threads fighting for the lock are seen as contended acquisitions
+TEST(RingBufferMetricsTest, LockContention) {
+    rb_t *rb = rb_create(64);
+    const int threads = 4, per_thread = 20000;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++)
+        workers.emplace_back([rb]() {
+            for (int i = 0; i < per_thread; i++)
+                rb_add_element_r(rb, i);
+        });
+    for (auto &worker : workers)
+        worker.join();
+
+    rb_metrics_t metrics;
+    ASSERT_EQ(rb_get_metrics_r(rb, &metrics), 0);
+    EXPECT_EQ(metrics.adds, (uint64_t)threads * per_thread);
+    EXPECT_EQ(metrics.lock_acquisitions, (uint64_t)threads * per_thread);
+    EXPECT_LE(metrics.lock_contended, metrics.lock_acquisitions);
+    if (metrics.lock_contended > 0) {
+        EXPECT_GT(metrics.lock_wait_ns, 0u);
+    }
+    rb_destroy(rb);
+}
+#endif // RB_ENABLE_METRICS
@@ -0,0 +1,179 @@
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+extern "C" {
+#include "../src/rollup_store.h"
+}
+
+static const uint64_t kSecond = 1000000000ULL;
+
+// Test: an empty store and invalid arguments are rejected
+TEST(RollupStoreTest, EmptyAndInvalid) {
+    rs_store_t *store = rs_create(NULL);
+    ASSERT_NE(store, nullptr);
+    rs_aggregate_t aggregate;
+    EXPECT_EQ(rs_query(store, RS_HOUR_NS, &aggregate), -1);
+
+    rs_add(store, 70, 0);
+    EXPECT_EQ(rs_query(store, 0, &aggregate), -1);
+    EXPECT_EQ(rs_query(store, RS_HOUR_NS, nullptr), -1);
+    EXPECT_EQ(rs_query(nullptr, RS_HOUR_NS, &aggregate), -1);
+    rs_add(nullptr, 70, 0);
+    rs_destroy(store);
+    rs_destroy(nullptr);
+
+    EXPECT_EQ(rs_tier_period_ns(RS_TIER_MINUTE), RS_MINUTE_NS);
+    EXPECT_EQ(rs_tier_period_ns(RS_TIER_HOUR), RS_HOUR_NS);
+    EXPECT_EQ(rs_tier_period_ns(RS_TIERS), 0u);
+}
+
+// Test: queries match a brute force aggregate over the same bucket aligned range
+TEST(RollupStoreTest, MatchesBruteForce) {
+    rs_config_t config = { 90, 6 };
+    rs_store_t *store = rs_create(&config);
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> value(40, 180);
+
+    // 10 hours at one sample every 5 seconds, with a pause of 20 minutes
+    std::vector<std::pair<uint64_t, int>> samples;
+    for (uint64_t t = 0; t < 10 * 3600; t += 5) {
+        if (t >= 4 * 3600 && t < 4 * 3600 + 1200)
+            continue;
+        samples.push_back({ t * kSecond, value(rng) });
+        rs_add(store, samples.back().second, samples.back().first);
+    }
+
+    const uint64_t ranges[] = { RS_MINUTE_NS, 30 * RS_MINUTE_NS, 90 * RS_MINUTE_NS, RS_HOUR_NS,
+                                3 * RS_HOUR_NS, 45 * kSecond, 100 * RS_MINUTE_NS, 24 * RS_HOUR_NS };
+    for (uint64_t range : ranges) {
+        rs_aggregate_t aggregate;
+        ASSERT_EQ(rs_query(store, range, &aggregate), 0);
+        EXPECT_LE(aggregate.start_ns, samples.back().first);
+        EXPECT_GT(aggregate.end_ns, samples.back().first);
+
+        int lo = 1000, hi = -1;
+        uint64_t count = 0;
+        double sum = 0.0;
+        for (const auto &sample : samples) {
+            if (sample.first < aggregate.start_ns || sample.first >= aggregate.end_ns)
+                continue;
+            lo = std::min(lo, sample.second);
+            hi = std::max(hi, sample.second);
+            sum += sample.second;
+            count++;
+        }
+        EXPECT_EQ(aggregate.count, count) << range;
+        EXPECT_EQ(aggregate.min, lo) << range;
+        EXPECT_EQ(aggregate.max, hi) << range;
+        EXPECT_NEAR(aggregate.mean, sum / (double)count, 1e-9) << range;
+    }
+    rs_destroy(store);
+}
+
+// Test: trailing windows are read from the minute tier while it holds them, and stitched onto
+// hour buckets beyond
+TEST(RollupStoreTest, TierSelection) {
+    rs_config_t config = { 120, 48 };
+    rs_store_t *store = rs_create(&config);
+    for (uint64_t t = 0; t < 5 * 3600; t += 10)
+        rs_add(store, 60 + (int)(t % 50), t * kSecond);
+    // Last sample at 4:59:50, the minute tier holds minutes 179 to 299
+
+    // Window from 3:29:50, rounded out to minute 209
+    rs_aggregate_t aggregate;
+    ASSERT_EQ(rs_query(store, 90 * RS_MINUTE_NS, &aggregate), 0);
+    EXPECT_EQ(aggregate.tier, RS_TIER_MINUTE);
+    EXPECT_EQ(aggregate.start_ns, 209 * RS_MINUTE_NS);
+    EXPECT_EQ(aggregate.end_ns, 300 * RS_MINUTE_NS);
+    EXPECT_EQ(aggregate.count, 91u * 6u);
+
+    // Window from 1:59:50: hour buckets 1 and 2, then the minutes from 3:00
+    ASSERT_EQ(rs_query(store, 3 * RS_HOUR_NS, &aggregate), 0);
+    EXPECT_EQ(aggregate.tier, RS_TIER_HOUR);
+    EXPECT_EQ(aggregate.start_ns, RS_HOUR_NS);
+    EXPECT_EQ(aggregate.end_ns, 5 * RS_HOUR_NS);
+    EXPECT_EQ(aggregate.count, 4u * 360u);
+
+    // Window from 2:29:50: the minute tier misses only part of hour 2, it answers alone
+    ASSERT_EQ(rs_query(store, 150 * RS_MINUTE_NS, &aggregate), 0);
+    EXPECT_EQ(aggregate.tier, RS_TIER_MINUTE);
+    EXPECT_EQ(aggregate.start_ns, 179 * RS_MINUTE_NS);
+    EXPECT_EQ(aggregate.count, 121u * 6u);
+
+    // Less than a minute is the current minute
+    ASSERT_EQ(rs_query(store, 10 * kSecond, &aggregate), 0);
+    EXPECT_EQ(aggregate.tier, RS_TIER_MINUTE);
+    EXPECT_EQ(aggregate.count, 6u);
+
+    // Beyond every sample, everything
+    ASSERT_EQ(rs_query(store, 100 * RS_HOUR_NS, &aggregate), 0);
+    EXPECT_EQ(aggregate.tier, RS_TIER_HOUR);
+    EXPECT_EQ(aggregate.start_ns, 0u);
+    EXPECT_EQ(aggregate.count, 5u * 360u);
+    rs_destroy(store);
+}
+
+// Test: just after the top of the hour, the last hour is the trailing 60 minutes, not the few
+// seconds of the new hour bucket
+TEST(RollupStoreTest, TrailingWindowAfterBoundary) {
+    rs_store_t *store = rs_create(NULL);
+    // One sample a second: 70 until 3:00:00, then 130
+    for (uint64_t t = 0; t <= 3 * 3600 + 5; t++)
+        rs_add(store, t < 3 * 3600 ? 70 : 130, t * kSecond);
+
+    // Window (2:00:05, 3:00:05], rounded out to minutes 120 to 180
+    rs_aggregate_t aggregate;
+    ASSERT_EQ(rs_query(store, RS_HOUR_NS, &aggregate), 0);
+    EXPECT_EQ(aggregate.tier, RS_TIER_MINUTE);
+    EXPECT_EQ(aggregate.start_ns, 2 * RS_HOUR_NS);
+    EXPECT_EQ(aggregate.count, 3606u);
+    EXPECT_DOUBLE_EQ(aggregate.mean, (3600.0 * 70 + 6.0 * 130) / 3606.0);
+    EXPECT_EQ(aggregate.min, 70);
+    EXPECT_EQ(aggregate.max, 130);
+
+    // Window (3:00:04, 3:00:05], the current minute
+    ASSERT_EQ(rs_query(store, kSecond, &aggregate), 0);
+    EXPECT_EQ(aggregate.count, 6u);
+    EXPECT_DOUBLE_EQ(aggregate.mean, 130.0);
+
+    // Last 24 hours: everything, from the minute tier's 2 hours and the hour buckets before
+    ASSERT_EQ(rs_query(store, 24 * RS_HOUR_NS, &aggregate), 0);
+    EXPECT_EQ(aggregate.count, 3u * 3600u + 6u);
+    EXPECT_DOUBLE_EQ(aggregate.mean, (3.0 * 3600 * 70 + 6.0 * 130) / (3.0 * 3600 + 6.0));
+    rs_destroy(store);
+}
+
+// Test: the rings keep their capacity of closed buckets, older ones are dropped
+TEST(RollupStoreTest, BoundedHistory) {
+    rs_config_t config = { 10, 2 };
+    rs_store_t *store = rs_create(&config);
+    for (uint64_t t = 0; t < 6 * 3600; t += 60)
+        rs_add(store, (int)(t / 3600), t * kSecond);
+
+    rs_aggregate_t aggregate;
+    ASSERT_EQ(rs_query(store, 24 * RS_HOUR_NS, &aggregate), 0);
+    EXPECT_EQ(aggregate.tier, RS_TIER_HOUR);
+    EXPECT_EQ(aggregate.start_ns, 3 * RS_HOUR_NS);
+    EXPECT_EQ(aggregate.count, 3u * 60u);
+    EXPECT_EQ(aggregate.min, 3);
+    EXPECT_EQ(aggregate.max, 5);
+
+    ASSERT_EQ(rs_query(store, 11 * RS_MINUTE_NS, &aggregate), 0);
+    EXPECT_EQ(aggregate.tier, RS_TIER_MINUTE);
+    EXPECT_EQ(aggregate.count, 11u);
+    rs_destroy(store);
+}
+
+// Test: a sample older than the current bucket is counted in it
+TEST(RollupStoreTest, ClockStepBack) {
+    rs_store_t *store = rs_create(NULL);
+    rs_add(store, 60, 5 * RS_MINUTE_NS);
+    rs_add(store, 100, 2 * RS_MINUTE_NS);
+    rs_aggregate_t aggregate;
+    ASSERT_EQ(rs_query(store, RS_MINUTE_NS, &aggregate), 0);
+    EXPECT_EQ(aggregate.count, 2u);
+    EXPECT_EQ(aggregate.start_ns, 4 * RS_MINUTE_NS); // the window starts at minute 4
+    EXPECT_DOUBLE_EQ(aggregate.mean, 80.0);
+    rs_destroy(store);
+}
@@ -0,0 +1,58 @@
+#include "gtest/gtest.h"
+#include <chrono>
+#include <thread>
+extern "C" {
+#include "../src/sample_clock.h"
+}
+
+TEST(SampleClockTest, InitRejectsInvalidRate) {
+    sc_clock_t clock;
+    EXPECT_EQ(sc_init(&clock, 0.0), -1);
+    EXPECT_EQ(sc_init(&clock, -5.0), -1);
+    EXPECT_EQ(sc_init(&clock, SC_MAX_RATE_HZ * 2), -1);
+    EXPECT_EQ(sc_init(nullptr, 1.0), -1);
+    EXPECT_EQ(sc_init(&clock, 250.0), 0);
+    EXPECT_EQ(clock.period_ns, 4000000u);
+}
+
+TEST(SampleClockTest, TicksOnAbsoluteDeadlines) {
+    sc_clock_t clock;
+    ASSERT_EQ(sc_init(&clock, 500.0), 0);
+
+    const int ticks = 50;
+    uint64_t last = 0;
+    uint64_t missed = 0;
+    for (int i = 0; i < ticks; i++) {
+        uint64_t timestamp;
+        int64_t result = sc_wait(&clock, &timestamp);
+        ASSERT_GE(result, 0);
+        missed += (uint64_t)result;
+        // Never woken before the deadline of the tick
+        EXPECT_GE(timestamp, clock.start_ns + (clock.ticks + clock.overruns - 1) * clock.period_ns);
+        last = timestamp;
+    }
+    EXPECT_EQ(clock.ticks, (uint64_t)ticks);
+    EXPECT_EQ(clock.overruns, missed);
+
+    // Deadlines stay in phase with the start whatever the time spent between waits
+    EXPECT_EQ(clock.deadline_ns, clock.start_ns + (clock.ticks + clock.overruns) * clock.period_ns);
+    EXPECT_GE(last - clock.start_ns, (uint64_t)(ticks - 1) * clock.period_ns);
+}
+
+TEST(SampleClockTest, CountsOverruns) {
+    sc_clock_t clock;
+    ASSERT_EQ(sc_init(&clock, 1000.0), 0);
+    ASSERT_GE(sc_wait(&clock, nullptr), 0); // first tick is due immediately
+    uint64_t before = clock.overruns;       // non zero if the test thread was preempted
+
+    // Stall for several periods, the missed ticks are counted and not burst through
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    uint64_t timestamp;
+    int64_t missed = sc_wait(&clock, &timestamp);
+    EXPECT_GE(missed, 8);
+    EXPECT_EQ(clock.overruns - before, (uint64_t)missed);
+    EXPECT_EQ(clock.ticks, 2u);
+
+    // The next deadline is after the late tick, the following wait does not burst
+    EXPECT_GT(clock.deadline_ns, timestamp);
+}
@@ -0,0 +1,98 @@
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+extern "C" {
+#include "../src/sample_reader.h"
+}
+
+// Test fixture class, each test writes its input to a temporary stream
+class SampleReaderTest : public ::testing::Test {
+  protected:
+    FILE *stream = nullptr;
+    sr_reader_t reader;
+
+    void TearDown() override {
+        if (stream)
+            fclose(stream);
+    }
+
+    void Open(const std::string &content, sr_format_t format) {
+        stream = tmpfile();
+        ASSERT_NE(stream, nullptr);
+        fwrite(content.data(), 1, content.size(), stream);
+        rewind(stream);
+        sr_init(&reader, stream, format);
+    }
+
+    std::vector<int> ReadAll(size_t batch) {
+        std::vector<int> all;
+        std::vector<int> buf(batch);
+        size_t n;
+        while ((n = sr_read(&reader, buf.data(), batch)) > 0)
+            all.insert(all.end(), buf.begin(), buf.begin() + n);
+        return all;
+    }
+};
+
+TEST_F(SampleReaderTest, ParseFormat) {
+    sr_format_t format;
+    EXPECT_EQ(sr_parse_format("text", &format), 0);
+    EXPECT_EQ(format, SR_FORMAT_TEXT);
+    EXPECT_EQ(sr_parse_format("binary", &format), 0);
+    EXPECT_EQ(format, SR_FORMAT_BINARY);
+    EXPECT_EQ(sr_parse_format("csv", &format), -1);
+}
+
+TEST_F(SampleReaderTest, TextSamples) {
+    Open("60\n 70\t80\r\n\n-5 +90", SR_FORMAT_TEXT);
+    std::vector<int> expected = {60, 70, 80, -5, 90};
+    EXPECT_EQ(ReadAll(2), expected);
+    EXPECT_FALSE(reader.error);
+}
+
+TEST_F(SampleReaderTest, TextSamplesAcrossChunks) {
+    // Numbers straddle the chunk boundaries
+    std::string content;
+    std::vector<int> expected;
+    for (int i = 0; content.size() < 3 * SR_READ_CHUNK; i++) {
+        int value = 40 + (i * 37) % 150;
+        content += std::to_string(value) + (i % 3 ? " " : "\n");
+        expected.push_back(value);
+    }
+    Open(content, SR_FORMAT_TEXT);
+    EXPECT_EQ(ReadAll(1000), expected);
+    EXPECT_FALSE(reader.error);
+}
+
+TEST_F(SampleReaderTest, TextInvalidSample) {
+    Open("60\n7x0\n80\n", SR_FORMAT_TEXT);
+    std::vector<int> expected = {60};
+    EXPECT_EQ(ReadAll(10), expected);
+    EXPECT_TRUE(reader.error);
+    EXPECT_EQ(reader.line, 2);
+}
+
+TEST_F(SampleReaderTest, TextOverflow) {
+    Open("99999999999\n", SR_FORMAT_TEXT);
+    EXPECT_TRUE(ReadAll(10).empty());
+    EXPECT_TRUE(reader.error);
+}
+
+TEST_F(SampleReaderTest, BinarySamples) {
+    std::string content;
+    std::vector<int> expected;
+    for (int i = 0; i < 2 * SR_READ_CHUNK + 17; i++) {
+        content.push_back((char)(i % 256));
+        expected.push_back(i % 256);
+    }
+    Open(content, SR_FORMAT_BINARY);
+    EXPECT_EQ(ReadAll(4096), expected);
+    EXPECT_FALSE(reader.error);
+}
+
+TEST_F(SampleReaderTest, EmptyInput) {
+    Open("", SR_FORMAT_TEXT);
+    EXPECT_TRUE(ReadAll(10).empty());
+    EXPECT_FALSE(reader.error);
+}
@@ -0,0 +1,105 @@
+#include "gtest/gtest.h"
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <type_traits>
+#include "../src/static_ring_buffer.hpp"
+extern "C" {
+#include "../src/static_ring_buffer.h"
+}
+
+SRB_DEFINE(ring8, int, 8) // power of two, masked
+SRB_DEFINE(ring5, int, 5) // wrapped with a compare
+SRB_DEFINE(bytes64, uint8_t, 64)
+
+// Static buffers need no initialization call
+static ring5_t ring5_g;
+static bytes64_t bytes64_g = SRB_INIT;
+static constexpr srb::RingBuffer<int, 4> empty_g;
+static_assert(empty_g.empty() && empty_g.capacity() == 4, "constant initialized");
+static_assert(sizeof(srb::RingBuffer<uint8_t, 64>) == 64 + 2 * sizeof(size_t), "inline storage");
+static_assert(sizeof(bytes64_t) == 64 + 2 * sizeof(size_t), "inline storage");
+
+// Run the same random operations on a C buffer, a C++ buffer and a std::deque
+template <typename C, typename Add, typename Remove, typename GetAt, typename Count>
+static void
+check_against_model(C *c, size_t capacity, Add add, Remove remove, GetAt get_at, Count count) {
+    srb::RingBuffer<int, 8> pow2;
+    srb::RingBuffer<int, 5> odd;
+    std::deque<int> model;
+    std::mt19937 rng(3);
+    for (int step = 0; step < 5000; step++) {
+        if (rng() % 3 != 0) {
+            int value = (int)(rng() % 1000);
+            add(c, value);
+            if (capacity == 8)
+                pow2.add(value);
+            else
+                odd.add(value);
+            model.push_back(value);
+            if (model.size() > capacity)
+                model.pop_front();
+        } else {
+            int value = -1, cpp = -1;
+            bool removed = remove(c, &value);
+            bool cpp_removed = (capacity == 8) ? pow2.remove(&cpp) : odd.remove(&cpp);
+            ASSERT_EQ(removed, !model.empty());
+            ASSERT_EQ(cpp_removed, !model.empty());
+            if (removed) {
+                ASSERT_EQ(value, model.front());
+                ASSERT_EQ(cpp, model.front());
+                model.pop_front();
+            }
+        }
+
+        ASSERT_EQ(count(c), model.size());
+        ASSERT_EQ((capacity == 8) ? pow2.size() : odd.size(), model.size());
+        for (size_t i = 0; i < model.size(); i++) {
+            int value;
+            ASSERT_TRUE(get_at(c, i, &value));
+            ASSERT_EQ(value, model[i]);
+            ASSERT_EQ((capacity == 8) ? pow2[i] : odd[i], model[i]);
+        }
+    }
+}
+
+// Test: power of two and other capacities behave like the rb_ buffer, overwriting the oldest
+TEST(StaticRingBufferTest, MatchesModel) {
+    ring8_t ring8 = SRB_INIT;
+    check_against_model(&ring8, 8, ring8_add, ring8_remove, ring8_get_at, ring8_count);
+    check_against_model(&ring5_g, 5, ring5_add, ring5_remove, ring5_get_at, ring5_count);
+}
+
+// Test: full/empty, last element, bounds and clear
+TEST(StaticRingBufferTest, Basics) {
+    EXPECT_EQ(bytes64_capacity(), 64u);
+    EXPECT_TRUE(bytes64_is_empty(&bytes64_g));
+    uint8_t value;
+    EXPECT_FALSE(bytes64_get_last(&bytes64_g, &value));
+    EXPECT_FALSE(bytes64_remove(&bytes64_g, nullptr));
+
+    for (int i = 0; i < 70; i++)
+        bytes64_add(&bytes64_g, (uint8_t)(100 + i));
+    EXPECT_TRUE(bytes64_is_full(&bytes64_g));
+    ASSERT_TRUE(bytes64_get_at(&bytes64_g, 0, &value));
+    EXPECT_EQ(value, 106); // the first 6 were overwritten
+    ASSERT_TRUE(bytes64_get_last(&bytes64_g, &value));
+    EXPECT_EQ(value, 169);
+    EXPECT_FALSE(bytes64_get_at(&bytes64_g, 64, &value));
+    bytes64_clear(&bytes64_g);
+    EXPECT_EQ(bytes64_count(&bytes64_g), 0u);
+
+    srb::RingBuffer<uint8_t, 3> cpp;
+    EXPECT_FALSE(cpp.get_last(&value));
+    for (int i = 1; i <= 4; i++)
+        cpp.add((uint8_t)i);
+    EXPECT_TRUE(cpp.full());
+    ASSERT_TRUE(cpp.get_last(&value));
+    EXPECT_EQ(value, 4);
+    EXPECT_TRUE(cpp.remove());
+    ASSERT_TRUE(cpp.get_at(0, &value));
+    EXPECT_EQ(value, 3);
+    EXPECT_FALSE(cpp.get_at(2, &value));
+    cpp.clear();
+    EXPECT_TRUE(cpp.empty());
+}